@@ -6,7 +6,15 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <unordered_map>
+#include <memory_resource>
+#include <string_view>
+#include <cstdint>
+#include <cassert>
+#include <atomic>
+#include <iosfwd>
 #include "glm/glm.hpp"
+#include "result.h"
 
 #define SIN_45 0.70710678118654752440084436210485
 #define COS_30 0.86602540378443864676372317075294
@@ -18,13 +26,23 @@
 #define MAX_POINT_LIGHTS 36
 #define smoothingConstant 0.2f
 
-extern std::map <std::string, int> numberTerms;
-static bool organic;
+// Element ids are atomic numbers, slot 0 holds the lone pair placeholder
+#define ELEMENT_TABLE_SIZE 119
+#define LONE_PAIR 0
+#define HYDROGEN 1
+#define CARBON 6
+#define CHLORINE 17
+#define BROMINE 35
 
 struct BondedElement;
 struct Element;
 struct Substituent;
 struct BondingOrbital;
+struct ModelingContext;
+struct StructureCache;
+struct StructureState;
+struct Formula;
+struct MoleculeStore;
 // struct FunctionalGroup;
 // struct RGroupConnection;
 
@@ -33,7 +51,7 @@ struct BondingOrbital;
  * These should be constant after startup as the data
  * comes from recorded research and are not subject to change.
  * Element data is loaded in in DataParsing.cpp at startup
- * and kept in an extern map for later access
+ * and kept in the extern elementTable, indexed by atomic number
  */
 struct Element {
 	int atomicNumber;
@@ -83,6 +101,44 @@ struct Element {
 	}
 };
 
+// Flat, immutable (after startup) table of elements indexed by atomic number
+extern Element elementTable[ELEMENT_TABLE_SIZE];
+
+/**
+ * Counts deep copies of the object it's a member of
+ * Copies increment a global counter, moves don't, so the owner
+ * keeps its implicit copy and move operations.
+ * Used to benchmark how many atoms the pipeline copies.
+ */
+struct CopyCounter {
+	static std::atomic<uint64_t> copies;
+
+	CopyCounter() {}
+	CopyCounter(const CopyCounter &) {
+		copies.fetch_add(1, std::memory_order_relaxed);
+	}
+	CopyCounter(CopyCounter &&) noexcept {}
+	CopyCounter &operator=(const CopyCounter &) {
+		copies.fetch_add(1, std::memory_order_relaxed);
+		return *this;
+	}
+	CopyCounter &operator=(CopyCounter &&) noexcept {
+		return *this;
+	}
+};
+
+/**
+ * A bond from an atom to one of its neighbours
+ * Each neighbour appears once, higher order bonds
+ * are recorded in the order instead of being repeated
+ */
+struct Bond {
+	uint32_t uid; // The neighbour's unique id
+	uint8_t order = 1;
+	bool resonance = false; // Part of a delocalized (resonance/aromatic) system
+	float averageOrder = 0; // Order averaged over the resonance contributors, 0 if not averaged
+};
+
 /**
  * Data structure used to represent an atom in a compound
  * Includes information about the element, how its bonded
@@ -90,16 +146,17 @@ struct Element {
  */
 struct BondedElement {
 public:
-	Element base;
+	uint8_t elementId = LONE_PAIR;
 	int loneElectrons;
 	int bondedElectrons;
 	int id = 0;
-	std::vector<uint32_t> neighbours;
+	std::vector<Bond> bonds;
 	glm::vec3 position;
 	glm::vec3 vanDerWaalsPosition;
 	glm::mat4 rotation = glm::mat4();
 	int numberOfBonds;
 	std::vector<glm::mat4> cylinderModels;
+	CopyCounter copyCounter;
 
 	/**
 	 * Construct a new BondedElement (represents an atom)
@@ -108,25 +165,108 @@ public:
 	 * @param _bondedElectrons the number of bonded electrons
 	 * @param _base the element of the atom
 	 */
-	BondedElement(int _loneElectrons, int _bondedElectrons, Element _base) {
+	BondedElement(int _loneElectrons, int _bondedElectrons, const Element &_base) {
 		uid = generateUID();
-		base = _base;
+		// Ids are stored in a byte, so anything outside the table would wrap
+		assert(_base.atomicNumber >= 0 && _base.atomicNumber < ELEMENT_TABLE_SIZE);
+		elementId = (uint8_t)_base.atomicNumber;
 		loneElectrons = _loneElectrons;
 		bondedElectrons = _bondedElectrons;
-		if(base.periodNumber == 1) {
-			numberOfBonds = 2 - base.valenceNumber;
+		if(_base.periodNumber == 1) {
+			numberOfBonds = 2 - _base.valenceNumber;
 		}
 		else {
-			numberOfBonds = 8 - base.valenceNumber;
+			numberOfBonds = 8 - _base.valenceNumber;
 		}
 		if(numberOfBonds < 1) {
 			numberOfBonds = 1;
 		}
+		bonds.reserve(numberOfBonds);
 	}
 
 	BondedElement() {}
 
-	uint32_t getUID() {
+	/**
+	 * Get the element data for this atom
+	 * 
+	 * @return the entry in the element table
+	 */
+	const Element &base() const {
+		return elementTable[elementId];
+	}
+
+	/**
+	 * Get the order of the bond to another atom
+	 * 
+	 * @param neighbour the other atom's unique id
+	 * @return the bond order, 0 if the atoms aren't bonded
+	 */
+	int bondOrder(uint32_t neighbour) const {
+		for(const Bond &b : bonds) {
+			if(b.uid == neighbour) {
+				return b.order;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * Get the sum of the orders of all this atom's bonds
+	 * 
+	 * @return the total bond order
+	 */
+	int totalBondOrder() const {
+		int total = 0;
+		for(const Bond &b : bonds) {
+			total += b.order;
+		}
+		return total;
+	}
+
+	/**
+	 * Record a bond to another atom, raising the bond's
+	 * order if the atoms are already bonded
+	 * Electron counts are left to the caller
+	 * 
+	 * @param neighbour the other atom's unique id
+	 */
+	void addBond(uint32_t neighbour) {
+		for(Bond &b : bonds) {
+			if(b.uid == neighbour) {
+				b.order++;
+				return;
+			}
+		}
+		bonds.push_back(Bond{neighbour});
+	}
+
+	/**
+	 * Reverse addBond, lowering the bond's order and
+	 * dropping it once the order reaches 0
+	 * 
+	 * @param neighbour the other atom's unique id
+	 */
+	void removeBond(uint32_t neighbour) {
+		for(auto it = bonds.begin(); it != bonds.end(); it++) {
+			if(it->uid == neighbour) {
+				if(--it->order == 0) {
+					bonds.erase(it);
+				}
+				return;
+			}
+		}
+	}
+
+	/**
+	 * Get the number of atoms copied (not moved) so far
+	 * 
+	 * @return the copy count
+	 */
+	static uint64_t copyCount() {
+		return CopyCounter::copies.load(std::memory_order_relaxed);
+	}
+
+	uint32_t getUID() const {
 		return uid;
 	}
 
@@ -142,7 +282,8 @@ public:
 	}
 
 private:
-	static uint32_t maxUID;
+	// Shared by every builder thread
+	static std::atomic<uint32_t> maxUID;
 	uint32_t uid;
 
 	/**
@@ -151,8 +292,7 @@ private:
 	 * @return the new id
 	 */
 	uint32_t generateUID() {
-		maxUID++;
-		return maxUID;
+		return maxUID.fetch_add(1, std::memory_order_relaxed) + 1;
 	}
 };
 
@@ -166,104 +306,101 @@ private:
  * 
  * Contains data about the component atoms, parent substituent
  * if it exists, and where it connects to its parent 
+ * Components are allocated from a memory resource so substituents
+ * built for a single request can live in that request's arena
  */
 struct Substituent {
-	std::vector<BondedElement> components;
+	std::pmr::vector<BondedElement> components;
 	Substituent *parent;
 	int connectionPoint;
 
-	/**
-	 * Copy this substituent while generating new unique ids
-	 * for the atoms
-	 * 
-	 * @return the cloned substituent 
-	 */
-	Substituent duplicate() {
-		Substituent newSub;
-		std::vector<uint32_t> oldComponentIds;
-		for(BondedElement b : components) {
-			oldComponentIds.push_back(b.getUID());
-		}
-		std::vector<BondedElement> refreshComponents = this->components;
-		newSub.parent = this->parent;
-		newSub.connectionPoint = this->connectionPoint;
-
-		for(int i = 0; i < this->components.size(); i++) {
-			refreshComponents[i].refreshUID();
-			newSub.components.push_back(refreshComponents[i]);
-		}
-
-		for(int i = 0; i < newSub.components.size(); i++) {
-			for(int n = 0; n < newSub.components[i].neighbours.size(); n++) {
-				for(int c = 0; c < oldComponentIds.size(); c++) {
-					if(oldComponentIds[c]==newSub.components[i].neighbours[n]) {
-						newSub.components[i].neighbours[n] = newSub.components[c].getUID();
-					}
-				}
-			}
-		}
+	Substituent() {}
 
-		return newSub;
-	}
+	explicit Substituent(std::pmr::memory_resource *arena) : components(arena) {}
 };
 
-// /**
-//  * WIP for organic compound functional groups
-//  */
-// struct FunctionalGroup {
-// 	std::vector<BondedElement> components;
-// 	std::vector<RGroupConnection> rPorts;
-
-// 	struct RGroupConnection {
-// 		bool primary;
-// 		std::vector<uint32_t> bondingAtoms;
-// 	};
-
-	
-// };
-
 extern std::vector<BondedElement> VSEPRModel;
-extern std::vector<std::vector<glm::vec3>> configurations;
 std::vector<BondedElement> VSEPRMain();
-bool containsUID(uint32_t id, std::vector<uint32_t> list);
-BondedElement findNeighbour(uint32_t key, std::vector<BondedElement> group);
-void setUpMap();
-std::vector<BondedElement> mutateModel(std::vector<BondedElement> model = std::vector<BondedElement>());
+std::vector<BondedElement> mutateModel(std::vector<BondedElement> model = std::vector<BondedElement>(), bool organic = false);
+bool pollModel(std::vector<BondedElement> &model, MoleculeStore &store, unsigned int &version);
 void readyFrameUpdate();
 
 // ------------------------------ Chemistry utilities ------------------------------ //
 
 // Atom state
-int getFormalCharge(BondedElement b);
-int checkStability(BondedElement b);
-bool checkBondedElementValidity(BondedElement e);
+int getFormalCharge(const BondedElement &b);
+int checkStability(const BondedElement &b);
+bool checkBondedElementValidity(const BondedElement &e);
 bool bond(BondedElement &a, BondedElement &b);
-void bondSafe(BondedElement &a, BondedElement &b);
+[[nodiscard]] BuildError bondSafe(BondedElement &a, BondedElement &b);
 bool shiftBond(BondedElement &receiver, BondedElement &donor);
+void undoShiftBond(BondedElement &receiver, BondedElement &donor);
 
 // Structure state
-int countElectrons(std::vector<BondedElement> structure);
-int getTotalFormalCharge(std::vector<BondedElement> structure);
-std::vector<BondedElement> optimizeFormalCharge(std::vector<BondedElement> structure);
+int countElectrons(const std::vector<BondedElement> &structure);
+int getTotalFormalCharge(const std::vector<BondedElement> &structure);
+void optimizeFormalCharge(std::vector<BondedElement> &structure);
+void optimizeFormalCharge(StructureState &state);
 
 // General
-Element searchElements(std::string symbol);
-int findInstances(std::vector<uint32_t> v, uint32_t key);
-bool checkStringComponent(std::string main, std::string check);
-bool checkForDigits(std::string main);
-int findLastComponent(std::string main, std::string check);
-int findNumberTerm(std::string name);
+int findElementId(std::string_view symbol);
+Element searchElements(std::string_view symbol);
+bool checkStringComponent(std::string_view main, std::string_view check);
+bool checkForDigits(std::string_view main);
 
 // Positioning
-std::vector<BondedElement> generateCylinders(std::vector<BondedElement> structure);
-std::vector<BondedElement> averageCenterPositions(std::vector<BondedElement> structure);
-std::vector<BondedElement> centerPositions(std::vector<BondedElement> structure);
+void generateCylinders(std::vector<BondedElement> &structure);
+void averageCenterPositions(std::vector<BondedElement> &structure);
+void centerPositions(std::vector<BondedElement> &structure);
+void embedStructure(std::vector<BondedElement> &structure);
+void placeStructure(std::vector<BondedElement> &structure, unsigned int threads = 1);
+void positionAtoms(Substituent &structure, bool cyclo, std::pmr::memory_resource *arena);
+[[nodiscard]] BuildError fillInHydrogens(Substituent &structure);
 
 // ------------------------------ Main structure predicting functions ------------------------------ //
-std::vector<Element> readFormula(std::string formulaFull);
-std::vector<BondedElement> constructLewisStructure(std::vector<Element> formula);
-std::vector<BondedElement> interpretOrganic(std::string in);
+Result<std::vector<BondedElement>> constructLewisStructure(const ModelingContext &context, const Formula &formula);
+Result<std::vector<BondedElement>> solveLewisBonds(const Formula &formula);
+Result<std::vector<BondedElement>> solveLewisStructure(const ModelingContext &context, const Formula &formula);
+Result<std::vector<BondedElement>> interpretOrganic(const ModelingContext &context, const std::string &in);
+
+/**
+ * The outcome of building one line of input
+ */
+struct BuildResult {
+	std::vector<BondedElement> structure;
+	bool organic = false;
+	bool placed = true; // False while only the bonds are known (see finishBuild)
+	BuildError error; // Shown instead of the structure if set
+};
+
+bool isOrganicName(const std::string &input);
+std::string normalizeName(const std::string &name);
+std::string_view findCommonName(std::string_view input);
+BuildResult bondFromName(const ModelingContext &context, const std::string &name);
+BuildResult bondFromFormula(const ModelingContext &context, const Formula &comp);
+BuildResult bondFromSmiles(std::string_view smiles);
+void finishBuild(BuildResult &result, bool relax = true, unsigned int threads = 1);
+BuildResult buildFromName(const ModelingContext &context, const std::string &name, bool relax = true, unsigned int threads = 1);
+BuildResult buildFromFormula(const ModelingContext &context, const Formula &comp, bool relax = true, unsigned int threads = 1);
+BuildResult buildFromSmiles(std::string_view smiles, bool relax = true, unsigned int threads = 1);
+BuildResult buildFromInput(const ModelingContext &context, const std::string &input, bool relax = true, unsigned int threads = 1);
+std::string formatStructureTable(const std::vector<BondedElement> &structure);
+/**
+ * The lines of a batch that couldn't be built, by reason
+ */
+struct BatchFailures {
+	int counts[BUILD_ERROR_COUNT] = {};
+
+	int total() const {
+		int sum = 0;
+		for(int count : counts) {
+			sum += count;
+		}
+		return sum;
+	}
+};
 
-static std::map<std::string, Substituent> functionalGroups;
+int runBatch(const ModelingContext &context, StructureCache &cache, std::istream &in, std::ostream &out, unsigned int threads = 0, bool smiles = false, BatchFailures *failures = nullptr);
+int batchMain(const char *path, bool smiles = false);
 
 #endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Number of heap allocations made by the calling thread so far
+// Only defined when built with VSEPR_ALLOCATION_REPORT
+uint64_t heapAllocationCount();
+
+/**
+ * Counts the heap allocations made by the current thread
+ * between construction and a call to count().
+ * Used to report the allocator traffic of a single request.
+ */
+struct AllocationScope {
+	uint64_t start;
+
+	AllocationScope() {
+		start = heapAllocationCount();
+	}
+
+	uint64_t count() const {
+		return heapAllocationCount() - start;
+	}
+};
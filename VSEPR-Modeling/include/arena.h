@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory_resource>
+#include <cstddef>
+
+// Bytes reserved up front for each request before the arena falls back to the heap
+#define ARENA_INITIAL_SIZE (32 * 1024)
+
+/**
+ * Monotonic memory arena for a single structure build
+ * Scratch containers used while building a structure allocate
+ * from here instead of the global heap. Nothing is freed until
+ * the arena goes out of scope at the end of the request, where
+ * everything is released in one go.
+ */
+class BuildArena {
+public:
+	BuildArena() : resource(buffer, sizeof(buffer)) {}
+
+	BuildArena(const BuildArena &) = delete;
+	BuildArena &operator=(const BuildArena &) = delete;
+
+	std::pmr::memory_resource *get() {
+		return &resource;
+	}
+
+private:
+	alignas(std::max_align_t) std::byte buffer[ARENA_INITIAL_SIZE];
+	std::pmr::monotonic_buffer_resource resource;
+};
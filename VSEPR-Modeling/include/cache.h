@@ -0,0 +1,85 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include "VSEPR.h"
+#include "formula.h"
+#include "canonical.h"
+
+#define STRUCTURE_CACHE_SIZE 1024
+
+/**
+ * Bounded, thread-safe LRU cache of finished structures
+ * (positions and cylinder transforms included)
+ *
+ * Formulas are keyed on the composition they parse to, so e.g.
+ * "OH2" and "OHH" share an entry. The key keeps the order elements
+ * first appear in because the builder takes the first atom as the
+ * central one and lists the rest in that order.
+ * Names are keyed on their normalized spelling (see normalizeName)
+ * and SMILES strings on the string as written. Trivial names
+ * (see commonNames.def) use the key of the input they stand for.
+ *
+ * Entries are shared, immutable BuildResults, so a hit never
+ * copies the structure. Failed builds aren't cached. Whether
+ * organic structures are relaxed (see buildFromInput) is fixed per
+ * cache, so every entry of one cache has the same kind of geometry.
+ *
+ * Finished structures are also indexed by their canonical key
+ * (see canonicalKey), so spellings of the same molecule in different
+ * notations, e.g. "2-methylpropane" and "smiles:CC(C)C", share one
+ * entry. The key is taken as soon as an input is bonded, so a new
+ * spelling of a cached molecule is never placed or relaxed. Different
+ * molecules can share a key, so an entry is only shared once the two
+ * bond graphs are matched atom for atom (see sameMolecule).
+ */
+struct StructureCache {
+	typedef std::shared_ptr<const BuildResult> Entry;
+
+	explicit StructureCache(size_t capacity = STRUCTURE_CACHE_SIZE, bool relax = true) : capacity(capacity), relax(relax) {}
+
+	Entry build(const ModelingContext &context, const std::string &input);
+
+	uint64_t hits() const {
+		return hitCount.load(std::memory_order_relaxed);
+	}
+
+	uint64_t misses() const {
+		return missCount.load(std::memory_order_relaxed);
+	}
+
+	uint64_t shared() const {
+		return sharedCount.load(std::memory_order_relaxed);
+	}
+
+	size_t size();
+
+	static std::string formulaKey(const Formula &comp);
+
+private:
+	size_t capacity;
+	bool relax;
+	std::mutex accessMutex;
+	// Most recently used first
+	std::list<std::pair<std::string, Entry>> entries;
+	std::unordered_map<std::string, std::list<std::pair<std::string, Entry>>::iterator> index;
+	std::atomic<uint64_t> hitCount{0};
+	std::atomic<uint64_t> missCount{0};
+	std::atomic<uint64_t> sharedCount{0};
+	// The bond graph of a cached molecule and its entry, which it expires with
+	struct KnownMolecule {
+		CanonicalGraph graph;
+		std::weak_ptr<const BuildResult> entry;
+	};
+	// Canonical key -> the first molecule cached with that key
+	std::unordered_map<MoleculeKey, KnownMolecule, MoleculeKeyHash> molecules;
+
+	Entry find(const std::string &key);
+	Entry findMolecule(const std::string &key, const CanonicalGraph &molecule);
+	Entry insert(const std::string &key, CanonicalGraph &&molecule, const Entry &entry);
+	void link(const std::string &key, const Entry &entry);
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "VSEPR.h"
+
+/**
+ * 128-bit identity of a molecule's bond graph
+ * Equal for any two structures that are the same molecule however
+ * they were entered (formula, name or SMILES) and whatever order
+ * their atoms are in, so it can key caches and dedup batch work.
+ */
+struct MoleculeKey {
+	uint64_t high = 0;
+	uint64_t low = 0;
+
+	friend bool operator==(const MoleculeKey &lhs, const MoleculeKey &rhs) {
+		return lhs.high == rhs.high && lhs.low == rhs.low;
+	}
+
+	friend bool operator!=(const MoleculeKey &lhs, const MoleculeKey &rhs) {
+		return !(lhs == rhs);
+	}
+
+	std::string toString() const;
+};
+
+struct MoleculeKeyHash {
+	size_t operator()(const MoleculeKey &key) const {
+		return key.low;
+	}
+};
+
+/**
+ * The bond graph a canonical key was taken from
+ * Kept alongside the key to confirm that two structures with the
+ * same key are the same molecule (see sameMolecule)
+ */
+struct CanonicalGraph {
+	MoleculeKey key;
+	std::vector<uint64_t> labels;  // Each atom's final refinement label
+	std::vector<uint32_t> offsets; // Atom i's neighbours are targets[offsets[i]] ... targets[offsets[i+1] - 1]
+	std::vector<uint32_t> targets;
+	std::vector<uint8_t> codes;    // Each bond's order as hashed, parallel to targets
+
+	size_t size() const {
+		return labels.size();
+	}
+};
+
+CanonicalGraph canonicalGraph(const std::vector<BondedElement> &structure);
+MoleculeKey canonicalKey(const std::vector<BondedElement> &structure);
+bool sameMolecule(const CanonicalGraph &a, const CanonicalGraph &b);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "VSEPR.h"
+
+// Conformers kept, lowest energy first
+#define CONFORMER_LIMIT 10
+// Most candidates relaxed. Torsion grids with more points than this are sampled instead
+#define CONFORMER_CANDIDATES 120
+// Angles tried about each rotatable bond, evenly spaced from the starting one
+#define CONFORMER_TORSION_STEPS 3
+// Candidates tried per torsion combination when there are rings to pucker
+#define CONFORMER_RING_SAMPLES 15
+// How far (A) ring atoms are moved off a flattened ring's plane to pucker it
+#define CONFORMER_PUCKER 0.5
+// Largest nudge (A) given to each coordinate of a candidate, so rings can pucker different ways
+#define CONFORMER_JITTER 0.3
+// Conformers more than this far (kcal/mol) above the lowest are dropped
+#define CONFORMER_ENERGY_WINDOW 10.0
+// Conformers whose heavy atoms are within this RMSD (A) of each other count as one
+#define CONFORMER_RMSD 0.3
+// Conformers this close (kcal/mol) in energy whose sorted atom distances also match are symmetry copies or mirror images
+#define CONFORMER_ENERGY_TOLERANCE 0.01
+// Structures with more atoms than this are only relaxed, not searched
+#define CONFORMER_MAX_ATOMS 256
+
+/**
+ * A single bond that can be turned without breaking a ring
+ * moving lists the atoms on the b side, which turn with it
+ */
+struct RotatableBond {
+	uint32_t a;
+	uint32_t b;
+	std::vector<uint32_t> moving;
+};
+
+/**
+ * One relaxed geometry of a structure
+ */
+struct Conformer {
+	double energy = 0;
+	std::vector<double> coordinates;         // The relaxed van der Waals positions
+	std::vector<BondedElement> structure;    // The atoms with both coordinate sets filled in
+};
+
+/**
+ * Called with the conformers found so far, lowest energy first,
+ * every time the set changes, and once more with the final set
+ * Calls are never concurrent, but may come from any worker thread.
+ */
+typedef std::function<void(const std::vector<Conformer> &)> ConformerSink;
+
+std::vector<RotatableBond> findRotatableBonds(const std::vector<BondedElement> &structure);
+double conformerDistance(const std::vector<BondedElement> &structure, const std::vector<double> &a, const std::vector<double> &b);
+std::vector<Conformer> generateConformers(const std::vector<BondedElement> &structure, unsigned int threads = 0, size_t limit = CONFORMER_LIMIT, const ConformerSink &sink = ConformerSink(), const std::atomic<bool> *cancelled = nullptr);
+void publishConformers(const std::vector<Conformer> &conformers);
+bool stepConformer(int step);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "VSEPR.h"
+#include "fragments.h"
+#include "glm/glm.hpp"
+
+/**
+ * Lookup tables used while building structures
+ * A context is filled in once and only read afterwards, so any
+ * number of threads can build structures against the same one.
+ * Builders keep all of their working state in locals and never
+ * write to the context.
+ *
+ * The element and symbol tables are flat arrays indexed by
+ * atomic number / symbol hash (see data.h). They are loaded
+ * exactly once, while the default context is created.
+ */
+struct ModelingContext {
+	// Prebuilt substituent and parent chain templates
+	FragmentLibrary fragments;
+};
+
+/**
+ * Get the process-wide context, loading the periodic table
+ * and building the tables on first use
+ * Safe to call from several threads; throws if the periodic
+ * table data can't be read
+ *
+ * @return the shared read-only context
+ */
+const ModelingContext &defaultContext();
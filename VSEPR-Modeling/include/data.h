@@ -1,8 +1,15 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <cstdint>
 
 #define DATA_TABLE_PATH "periodicTableData.csv"
+#define SYMBOL_TABLE_SIZE (26 * 27)
+
+// Element symbol -> atomic number, indexed by symbolHash()
+extern uint8_t symbolTable[SYMBOL_TABLE_SIZE];
 
 // Loads periodic table data
-void parseCSV(std::string path);
\ No newline at end of file
+void parseCSV(std::string path);
+int symbolHash(std::string_view symbol);
\ No newline at end of file
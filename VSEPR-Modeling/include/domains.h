@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+// Most electron domains around one atom (a pentagonal bipyramid, AX7)
+#define MAX_DOMAINS 7
+
+/**
+ * Ideal arrangement of the electron domains around an atom with
+ * a given number of bonded neighbours and lone pairs (AXnEm),
+ * from linear (AX2) to pentagonal bipyramidal (AX7)
+ * Directions are unit vectors in the atom's own frame, bonded
+ * neighbours first, then lone pairs. Lone pairs take the slots
+ * VSEPR theory gives them, e.g. equatorial in a trigonal bipyramid
+ * and trans in an octahedron.
+ * Everything is worked out at compile time (see DomainGeometry.cpp),
+ * including the rotation that turns a cylinder, which points along
+ * +y, onto each direction, so placing atoms, lone pairs and sticks
+ * takes no trig or normalizing.
+ */
+struct DomainGeometry {
+	uint8_t domains = 0;
+	float directions[MAX_DOMAINS][3] = {};
+	float frames[MAX_DOMAINS][4] = {};     // Quaternions (w, x, y, z) turning +y onto each direction
+	float cylinders[MAX_DOMAINS][16] = {}; // The same rotations as column-major matrices
+
+	glm::vec3 direction(int slot) const {
+		return glm::vec3(directions[slot][0], directions[slot][1], directions[slot][2]);
+	}
+
+	glm::quat frame(int slot) const {
+		return glm::quat(frames[slot][0], frames[slot][1], frames[slot][2], frames[slot][3]);
+	}
+
+	glm::mat4 cylinder(int slot) const {
+		return glm::make_mat4(cylinders[slot]);
+	}
+};
+
+const DomainGeometry *domainGeometry(int bonding, int lonePairs);
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "VSEPR.h"
+#include "spatial.h"
+
+// Bond stretch constant (kcal/mol/A^2), about UFF's for a C-C single bond
+#define FORCE_FIELD_BOND_K 700.0
+// Angle bend constant (kcal/mol) of k (cos t - cos t0)^2
+#define FORCE_FIELD_ANGLE_K 100.0
+// Barriers (kcal/mol) about a bond, shared by every torsion about it
+#define FORCE_FIELD_TORSION_SP3 2.0
+#define FORCE_FIELD_TORSION_SP2 10.0
+#define FORCE_FIELD_TORSION_CONJUGATED 5.0
+#define FORCE_FIELD_TORSION_MIXED 1.0
+// Depth of the van der Waals well (kcal/mol)
+#define FORCE_FIELD_VDW_WELL 0.1
+// Van der Waals pairs are cut off past this many contact distances
+#define FORCE_FIELD_VDW_CUTOFF 1.5
+// Closer than this many contact distances the repulsion grows linearly
+// (in r^2), so overlapping starting geometries don't overflow
+#define FORCE_FIELD_VDW_INNER 0.6
+// Extra distance (A) kept in the pair list, rebuilt once an atom moves half of it
+#define FORCE_FIELD_PAIR_SKIN 1.5
+// Nonbonded pairs evaluated together, enough to fill the widest vector registers
+#define FORCE_FIELD_LANES 8
+// Largest nudge (A) given to each coordinate before relaxing a template
+#define FORCE_FIELD_JITTER 0.1
+// L-BFGS correction pairs kept
+#define FORCE_FIELD_HISTORY 8
+// Furthest (A) any atom moves in one step
+#define FORCE_FIELD_MAX_STEP 0.3
+// Stop once the root mean square gradient is smaller (kcal/mol/A)
+#define FORCE_FIELD_GRADIENT_TOLERANCE 0.05
+#define FORCE_FIELD_MAX_ITERATIONS 2000
+
+struct BondTerm {
+	uint32_t a;
+	uint32_t b;
+	double rest;
+	double k;
+};
+
+struct AngleTerm {
+	uint32_t a;
+	uint32_t centre;
+	uint32_t b;
+	double cosRest;
+	double k;
+};
+
+/**
+ * barrier/2 (1 - phase cos(periodicity phi)) about the bond b-c
+ */
+struct TorsionTerm {
+	uint32_t a;
+	uint32_t b;
+	uint32_t c;
+	uint32_t d;
+	double barrier;
+	int periodicity;
+	int phase;
+};
+
+/**
+ * The van der Waals pairs close enough to interact, kept in
+ * parallel arrays so the kernel can run over them in lanes
+ * Holds every pair within the cutoff plus FORCE_FIELD_PAIR_SKIN,
+ * so it's only rebuilt once an atom has moved half the skin
+ * since the coordinates it was built from. Rebuilds find the pairs
+ * with a cell list (see spatial.h) instead of trying every pair.
+ */
+struct NonbondedList {
+	std::vector<uint32_t> first;
+	std::vector<uint32_t> second;
+	std::vector<double> contact2; // Squared contact distance of each pair
+	std::vector<double> built;    // The coordinates the list was built from
+	CellList cells;               // Grid the pairs are found with, kept between builds
+
+	size_t size() const {
+		return first.size();
+	}
+};
+
+/**
+ * A UFF-style energy model of one structure, with bond stretch,
+ * angle bend, torsion and van der Waals terms
+ * Rest lengths are sums of covalent radii (interpolated for
+ * averaged resonance orders) and contact distances sums of van der
+ * Waals radii, both from the periodic table data. Rest angles are
+ * the angles between the domains of each atom's VSEPR arrangement
+ * (see domains.h), the closest one to the starting geometry for
+ * atoms with more than one (e.g. axial and equatorial). Atoms 1-2
+ * and 1-3 apart have no van der Waals term.
+ * The model is built for one of the two coordinate sets of a
+ * structure: the real van der Waals positions, in A, or the
+ * ball-and-stick positions, where every bond to a heavy atom is
+ * getStickDistance() long. The stick model is the real one scaled
+ * by lengthScale, with its energies kept in kcal/mol.
+ * Read only once built, so several threads can minimize against it.
+ */
+struct ForceField {
+	size_t atoms = 0;
+	double lengthScale = 1.0;
+	std::vector<BondTerm> bonds;
+	std::vector<AngleTerm> angles;
+	std::vector<TorsionTerm> torsions;
+	std::vector<double> contact;          // Half the contact distance of each atom
+	std::vector<uint32_t> excludedOffsets; // CSR list of the atoms 1-2 or 1-3 apart from each atom
+	std::vector<uint32_t> excluded;
+
+	ForceField() {}
+	ForceField(const std::vector<BondedElement> &structure, bool sticks);
+
+	void buildPairs(const double *coordinates, NonbondedList &pairs) const;
+	double evaluate(const double *coordinates, double *gradient, NonbondedList &pairs) const;
+};
+
+/**
+ * How a minimization ended
+ */
+struct MinimizeResult {
+	double energy = 0;
+	int iterations = 0;
+	bool converged = false;
+};
+
+MinimizeResult minimizeEnergy(const ForceField &field, std::vector<double> &coordinates, NonbondedList &pairs, int maxIterations = FORCE_FIELD_MAX_ITERATIONS);
+MinimizeResult minimizeEnergy(const ForceField &field, std::vector<double> &coordinates, int maxIterations = FORCE_FIELD_MAX_ITERATIONS);
+std::vector<double> readCoordinates(const std::vector<BondedElement> &structure, bool sticks);
+void writeCoordinates(const std::vector<double> &coordinates, std::vector<BondedElement> &structure, bool sticks);
+void relaxStructure(std::vector<BondedElement> &structure);
+void relaxSticks(std::vector<BondedElement> &structure);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Number of atoms of one element in a formula
+ */
+struct ElementCount {
+	uint8_t elementId; // Atomic number, index into elementTable
+	uint32_t count;
+};
+
+/**
+ * Composition of a chemical formula
+ * One entry per distinct element, in the order each element
+ * first appears, so the first entry is the central atom
+ * for the Lewis builder. Atoms are never expanded into
+ * individual Element records.
+ */
+struct Formula {
+	std::vector<ElementCount> counts;
+	int charge = 0;
+
+	bool empty() const {
+		return counts.empty();
+	}
+
+	/**
+	 * Get the total number of atoms
+	 *
+	 * @return the atom count
+	 */
+	uint64_t atomCount() const {
+		uint64_t total = 0;
+		for(const ElementCount &c : counts) {
+			total += c.count;
+		}
+		return total;
+	}
+};
+
+bool parseFormula(std::string_view text, Formula &formula);
+Formula readFormula(std::string_view text);
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include "VSEPR.h"
+#include "glm/glm.hpp"
+
+// Alkyl chains up to this many carbons are built once with the context,
+// longer ones are built for the request that needs them
+#define FRAGMENT_TEMPLATE_MAX 20
+
+/**
+ * One atom of a fragment template, placed and with its
+ * electron counts filled in
+ */
+struct FragmentAtom {
+	uint8_t elementId;
+	int loneElectrons;
+	int bondedElectrons;
+	int id;
+	glm::vec3 position;
+	glm::vec3 vanDerWaalsPosition;
+	glm::mat4 rotation;
+};
+
+/**
+ * A bond of a fragment template to another of its atoms,
+ * by local index
+ */
+struct FragmentBond {
+	uint16_t target;
+	uint8_t order;
+};
+
+/**
+ * Pre-positioned, pre-hydrogenated piece of a molecule
+ * (an alkyl chain, cyclo group or functional group)
+ * Atoms are numbered locally: chain atoms first, then hydrogens
+ * in the order of the atom they belong to. Bonds are stored in CSR
+ * form, each atom's bonds to other heavy atoms before its hydrogens.
+ *
+ * Templates for substituents leave the first atom one bond short
+ * for the connection to the parent chain.
+ */
+struct FragmentTemplate {
+	std::vector<FragmentAtom> atoms;
+	std::vector<uint32_t> bondOffsets;
+	std::vector<FragmentBond> bonds;
+
+	FragmentTemplate() {}
+	FragmentTemplate(const BondedElement *structure, size_t count);
+
+	Substituent instantiate(std::pmr::memory_resource *arena, const uint8_t *removedHydrogens = nullptr) const;
+
+	/**
+	 * Count the hydrogens bonded to an atom
+	 *
+	 * @param atom the atom's local index
+	 * @return the number of hydrogens
+	 */
+	int hydrogenCount(size_t atom) const {
+		int count = 0;
+		for(uint32_t b = bondOffsets[atom]; b < bondOffsets[atom + 1]; b++) {
+			count += atoms[bonds[b].target].elementId == HYDROGEN;
+		}
+		return count;
+	}
+
+	/**
+	 * Count the bonds from an atom to other heavy atoms
+	 *
+	 * @param atom the atom's local index
+	 * @return the number of bonds that aren't to hydrogens
+	 */
+	int heavyDegree(size_t atom) const {
+		return bondOffsets[atom + 1] - bondOffsets[atom] - hydrogenCount(atom);
+	}
+};
+
+/**
+ * Every fragment an organic name can be assembled from,
+ * built once with the context and only read afterwards
+ */
+struct FragmentLibrary {
+	// Alkyl chains indexed by [attached to a parent][cyclo][number of carbons]
+	std::vector<FragmentTemplate> chains[2][2];
+	// Functional groups by their name prefix, e.g. "chloro"
+	std::map<std::string, FragmentTemplate, std::less<>> groups;
+
+	/**
+	 * Find a prebuilt alkyl chain
+	 *
+	 * @param length the number of carbons
+	 * @param cyclo whether the chain is a ring
+	 * @param attached whether it's a substituent rather than the parent chain
+	 * @return the template, null if it isn't prebuilt
+	 */
+	const FragmentTemplate *chain(int length, bool cyclo, bool attached) const {
+		const std::vector<FragmentTemplate> &built = chains[attached][cyclo];
+		if(length < 0 || length >= (int)built.size() || built[length].atoms.empty()) {
+			return nullptr;
+		}
+		return &built[length];
+	}
+
+	const FragmentTemplate *group(std::string_view name) const {
+		auto it = groups.find(name);
+		return it == groups.end() ? nullptr : &it->second;
+	}
+};
+
+Result<FragmentTemplate> buildChainTemplate(int length, bool cyclo, bool attached);
+void buildFragmentLibrary(ModelingContext &context);
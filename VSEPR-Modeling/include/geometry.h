@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+#include "VSEPR.h"
+
+// Distances shared by the structure builder and the renderer
+extern const float atomDistance;
+extern const float stickSetWidth;
+
+// Get atom distances
+float getSphereDistance(const std::vector<BondedElement> &model, int index, int order);
+float getSphereDistance(const BondedElement &a, const BondedElement &b, int order);
+float getStickDistance();
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string_view>
+#include <memory_resource>
+#include <vector>
+
+// Most locants a single substituent prefix can list (e.g. 2,2,3,3-tetramethyl)
+#define MAX_LOCANTS 8
+
+enum NameTokenType {
+	TOKEN_LOCANTS,            // "2,2"
+	TOKEN_MULTIPLIER,         // "di", "tri", "bis"...
+	TOKEN_CYCLO,              // "cyclo"
+	TOKEN_GROUP,              // Functional group prefix, e.g. "chloro"
+	TOKEN_STEM,               // Chain length stem, e.g. "meth", "pent"
+	TOKEN_SUBSTITUENT_SUFFIX, // "yl"
+	TOKEN_PARENT_SUFFIX       // "ane", "ene", "yne"
+};
+
+/**
+ * A piece of an IUPAC name
+ * text is a slice of the name that was tokenized, nothing is copied
+ */
+struct NameToken {
+	NameTokenType type;
+	std::string_view text;
+};
+
+/**
+ * One substituent prefix or the parent chain of a name,
+ * assembled from its tokens
+ */
+struct NameGroup {
+	int locants[MAX_LOCANTS];
+	int locantCount = 0;
+	std::string_view multiplier;
+	std::string_view stem;
+	bool cyclo = false;
+	bool functionalGroup = false; // stem is a group prefix, not a chain length
+	bool parent = false;
+};
+
+int chainLength(std::string_view stem);
+size_t multiplierPrefix(std::string_view word, int &value);
+bool tokenizeName(std::string_view name, std::pmr::vector<NameToken> &tokens);
+bool groupNameTokens(const std::pmr::vector<NameToken> &tokens, std::pmr::vector<NameGroup> &groups);
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "VSEPR.h"
+#include "glm/glm.hpp"
+
+/**
+ * A bond between two atoms of a structure, stored once
+ * Endpoints are indices into the structure with a < b
+ */
+struct BondEdge {
+	uint32_t a;
+	uint32_t b;
+	uint8_t order;
+	bool resonance;
+};
+
+/**
+ * Index over the bonds of a structure
+ * Atoms are numbered densely by their position in the structure,
+ * UIDs are mapped to those indices in O(1), and each atom's
+ * bonded neighbours are stored as indices in CSR form so
+ * neighbour lookups never have to scan or copy the structure.
+ * Each neighbour appears once, with the bond's order in the
+ * parallel orders array. Every bond is also listed once in edges
+ * for passes that visit each bond rather than each atom.
+ */
+struct BondGraph {
+	std::unordered_map<uint32_t, uint32_t> indexOf;
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> targets;
+	std::vector<uint8_t> orders;
+	std::vector<BondEdge> edges;
+
+	BondGraph() {}
+	BondGraph(const BondedElement *structure, size_t count);
+	BondGraph(const std::vector<BondedElement> &structure) : BondGraph(structure.data(), structure.size()) {}
+
+	size_t size() const {
+		return offsets.empty() ? 0 : offsets.size() - 1;
+	}
+
+	/**
+	 * Find the index of an atom
+	 *
+	 * @param uid the atom's unique id
+	 * @return the atom's index in the structure, -1 if it isn't part of it
+	 */
+	int find(uint32_t uid) const {
+		auto it = indexOf.find(uid);
+		return it == indexOf.end() ? -1 : (int)it->second;
+	}
+
+	uint32_t degree(size_t atom) const {
+		return offsets[atom + 1] - offsets[atom];
+	}
+
+	/**
+	 * Get the order of the n-th bond of an atom
+	 *
+	 * @param atom the atom's index
+	 * @param n which of the atom's bonds, in [0, degree(atom))
+	 * @return the bond order
+	 */
+	uint8_t order(size_t atom, size_t n) const {
+		return orders[offsets[atom] + n];
+	}
+
+	const uint32_t *neighboursBegin(size_t atom) const {
+		return targets.data() + offsets[atom];
+	}
+
+	const uint32_t *neighboursEnd(size_t atom) const {
+		return targets.data() + offsets[atom + 1];
+	}
+};
+
+/**
+ * Structure-of-arrays copy of a compound
+ * Each per-atom property is kept in its own contiguous column
+ * so loops that only need e.g. positions don't have to drag
+ * whole BondedElement records (names, matrices, heap vectors)
+ * through the cache.
+ *
+ * Bonds and cylinder transforms are stored in compressed sparse
+ * row (CSR) form. The neighbours of atom i are
+ *   bondTargets[bondOffsets[i]] ... bondTargets[bondOffsets[i+1] - 1]
+ * and are stored as indices into the per-atom columns, not UIDs.
+ * bondOrders runs parallel to bondTargets.
+ */
+struct MoleculeStore {
+	// Per-atom columns
+	std::vector<uint32_t> uids;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> vanDerWaalsPositions;
+	std::vector<uint8_t> elementIndices; // Ids into elementTable
+	std::vector<int> loneElectrons;
+	std::vector<int> bondedElectrons;
+
+	// CSR bond adjacency
+	std::vector<uint32_t> bondOffsets;
+	std::vector<uint32_t> bondTargets;
+	std::vector<uint8_t> bondOrders;
+
+	// CSR ball-and-stick cylinder transforms
+	std::vector<uint32_t> cylinderOffsets;
+	std::vector<glm::mat4> cylinderModels;
+
+	// Built from an organic name rather than a formula
+	bool organic = false;
+
+	MoleculeStore() {}
+	MoleculeStore(const std::vector<BondedElement> &structure);
+
+	size_t size() const {
+		return uids.size();
+	}
+
+	bool empty() const {
+		return uids.empty();
+	}
+
+	/**
+	 * Get the element of an atom
+	 *
+	 * @param atom the atom's index
+	 * @return the element data
+	 */
+	const Element &element(size_t atom) const {
+		return elementTable[elementIndices[atom]];
+	}
+
+	/**
+	 * Get the number of atoms bonded to an atom
+	 *
+	 * @param atom the atom's index
+	 * @return the degree
+	 */
+	uint32_t degree(size_t atom) const {
+		return bondOffsets[atom + 1] - bondOffsets[atom];
+	}
+
+	void clear();
+};
+
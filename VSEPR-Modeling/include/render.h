@@ -1,7 +1,10 @@
 #pragma once
 
 #include "VSEPR.h"
+#include "molecule.h"
 #include "data.h"
+#include "geometry.h"
+#include "domains.h"
 #include <vector>
 #include <string>
 #include "glm/glm.hpp"
@@ -55,29 +58,22 @@ extern unsigned int fastCylinderVBO;
 
 // Rendering state and constants
 extern int representation; // 0 = electron, 1 = sphere, 2 = ball and stick
-extern const float atomDistance;
 extern const float electronSpeed;
 extern const float lineColor[];
-extern const float stickSetWidth;
 
 // General utilities
 glm::quat RotationBetweenVectors(glm::vec3 start, glm::vec3 dest);
 
 // Cylinder rendering
 glm::mat4 getCylinderOffset(std::pair<int, int> bondOrder, glm::mat4 rotationModel, glm::vec3 direction, glm::mat4 cylinderModel);
-glm::mat4 getCylinderRotation(int configIndex, int modelIndex, std::pair<int, int> bondOrder, glm::mat4 rotationModel);
+glm::mat4 getCylinderRotation(const DomainGeometry &geometry, int modelIndex, std::pair<int, int> bondOrder, glm::mat4 rotationModel);
 
     // Electron rendering
-glm::vec3 calculateOrbitPosition(BondedElement central, BondedElement bonded, int configIndex, int modelIndex, int offset, int offsetTotal, bool pair);
+glm::vec3 calculateOrbitPosition(const BondedElement &central, const BondedElement &bonded, const DomainGeometry *geometry, int modelIndex, int offset, int offsetTotal, bool pair);
 void setUpPointLights(int num, Shader &program);
 void setPointLightPosition(int index, Shader &program, glm::vec3 pos);
 
-// Get atom distances
-float getSphereDistance(std::vector<BondedElement> model, int index, int order);
-float getSphereDistance(BondedElement a, BondedElement b, int order);
-float getStickDistance();
-
 // Master render functions
-void renderOrganic(std::vector<BondedElement> structure, Shader shader, glm::mat4 rotationModel, int rep);
-void renderSimpleCompound(std::vector<BondedElement> structure, glm::mat4 rotationModel, Shader shader, int representation);
-void renderElectrons(Shader program, Shader &atomProgram, std::vector<BondedElement> structure, glm::mat4 rotationModel);
\ No newline at end of file
+void renderOrganic(const MoleculeStore &structure, Shader shader, glm::mat4 rotationModel, int rep);
+void renderSimpleCompound(const MoleculeStore &structure, glm::mat4 rotationModel, Shader shader, int representation);
+void renderElectrons(Shader program, Shader &atomProgram, const std::vector<BondedElement> &structure, glm::mat4 rotationModel);
\ No newline at end of file
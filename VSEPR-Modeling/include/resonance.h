@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "VSEPR.h"
+#include "molecule.h"
+
+// Enumeration stops after about this many contributors (large fused ring systems)
+#define RESONANCE_MAX_CONTRIBUTORS 4096
+// Searches over fewer bonds than this run on the calling thread
+#define RESONANCE_PARALLEL_MIN_BONDS 32
+// Averaged orders within this of a whole number are drawn as that many full sticks
+#define RESONANCE_ORDER_TOLERANCE 0.01f
+// Subtrees queued per thread, so threads that finish early take more of them
+#define RESONANCE_TASKS_PER_THREAD 8
+
+/**
+ * The resonance contributors of a structure
+ * Only bonds whose order can change are listed. Each contributor
+ * gives those bonds an order, in the same order as bonds; every
+ * other bond keeps the order it has in the structure. The structure
+ * itself is always one of the contributors.
+ */
+struct ResonanceSet {
+	std::vector<BondEdge> bonds;
+	std::vector<std::vector<uint8_t>> contributors;
+};
+
+// Builders run on the caller's thread (often a batch worker), so searches
+// only start threads of their own when asked to (e.g. VSEPRMain, through buildFromInput)
+ResonanceSet enumerateResonance(const std::vector<BondedElement> &structure, unsigned int threads = 1);
+size_t averageResonance(std::vector<BondedElement> &structure, unsigned int threads = 1);
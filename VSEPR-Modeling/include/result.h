@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+/**
+ * Why a structure couldn't be built
+ * Each code has a short name (see buildErrorName) so batches
+ * can tally failures by reason
+ */
+enum BuildErrorCode : uint8_t {
+	BUILD_OK,
+	BUILD_ERROR_OVERBONDED,         // An atom has too few electrons for its bonds
+	BUILD_ERROR_UNBONDABLE,         // An outer atom can't bond to the central atom
+	BUILD_ERROR_NO_LEWIS_STRUCTURE, // The electrons can't be arranged into a stable structure
+	BUILD_ERROR_SEARCH_LIMIT,       // The Lewis structure search gave up before finishing
+	BUILD_ERROR_NAME,               // A name doesn't tokenize into groups
+	BUILD_ERROR_CHAIN_LENGTH,       // A stem isn't a chain length
+	BUILD_ERROR_LOCANT,             // A locant is past the end of the parent chain
+	BUILD_ERROR_FUNCTIONAL_GROUP,   // A group prefix has no template
+	BUILD_ERROR_SMILES_SYNTAX,      // A SMILES string can't be read
+	BUILD_ERROR_AROMATIC,           // Aromatic bonds have no Kekulé structure
+	BUILD_ERROR_NOT_RECOGNIZED,     // The input is no formula, name or SMILES string
+	BUILD_ERROR_INTERNAL,           // Out of memory or similar
+	BUILD_ERROR_COUNT
+};
+
+const char *buildErrorName(BuildErrorCode code);
+
+/**
+ * A failed build: the reason and the message shown for it
+ * Evaluates to true if it holds an error, so calls that can
+ * fail read as if(BuildError error = step()) return error;
+ */
+struct BuildError {
+	BuildErrorCode code = BUILD_OK;
+	std::string message;
+
+	BuildError() {}
+	BuildError(BuildErrorCode code, std::string message) : code(code), message(std::move(message)) {}
+
+	explicit operator bool() const {
+		return code != BUILD_OK;
+	}
+};
+
+/**
+ * The value of a build step or the reason it failed
+ * (in the style of std::expected)
+ * Failures are returned rather than thrown, so an invalid input
+ * costs about as much to reject as a valid one does to build.
+ * A BuildError converts to a failed Result of any type.
+ */
+template<typename T>
+struct Result {
+	T value;
+	BuildError error;
+
+	Result(const T &value) : value(value) {}
+	Result(T &&value) : value(std::move(value)) {}
+	Result(BuildError error) : error(std::move(error)) {}
+
+	bool ok() const {
+		return !error;
+	}
+
+	explicit operator bool() const {
+		return ok();
+	}
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "VSEPR.h"
+
+// Lines starting with this are read as SMILES, e.g. "smiles:CC(=O)O"
+#define SMILES_PREFIX "smiles:"
+
+/**
+ * What a SMILES string says about an atom beyond its
+ * element and bonds
+ */
+struct SmilesAtom {
+	int8_t charge = 0;
+	int8_t hydrogens = -1; // Explicit count from a bracket atom, -1 to fill to the normal valence
+	bool aromatic = false;
+};
+
+/**
+ * Heavy atoms and bonds read from a SMILES string
+ * annotations runs parallel to atoms. Aromatic bonds are
+ * stored as single bonds flagged as resonance until
+ * fillImplicitHydrogens assigns them a Kekulé structure.
+ */
+struct SmilesMolecule {
+	std::vector<BondedElement> atoms;
+	std::vector<SmilesAtom> annotations;
+};
+
+bool isSmilesInput(const std::string &input);
+[[nodiscard]] BuildError parseSmiles(std::string_view text, SmilesMolecule &molecule);
+[[nodiscard]] BuildError fillImplicitHydrogens(SmilesMolecule &molecule);
+Result<std::vector<BondedElement>> readSmilesBonds(std::string_view smiles);
+Result<std::vector<BondedElement>> interpretSmiles(const ModelingContext &context, std::string_view smiles);
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "VSEPR.h"
+#include "glm/glm.hpp"
+
+// Hash buckets per point, so most occupied cells get a bucket to themselves
+#define CELL_LIST_BUCKETS_PER_POINT 2
+// Once more than 1/this of the points have moved bucket since the last build, update() rebuilds
+#define CELL_LIST_REBUILD_FRACTION 8
+// Marks an empty slot or the end of a list
+#define CELL_LIST_END UINT32_MAX
+
+/**
+ * Uniform grid over a set of points, for finding the points
+ * within a cutoff of a position or of each other
+ * Space is cut into cubes cellSize across and each cube is hashed
+ * into a table of buckets, so memory follows the number of points
+ * rather than the volume they span. A build sorts the points by
+ * bucket into one array, so a bucket's points are scanned from
+ * contiguous memory. update() only does work for the points that
+ * crossed into another cell: they leave an empty slot behind and
+ * join a short linked list on their new bucket, until enough have
+ * moved that sorting everything again is cheaper.
+ * Queries visit the bucket of every cell the radius reaches, each
+ * bucket once. Points of other cells that hash to the same bucket
+ * are dropped by the distance check, so collisions cost time but
+ * never change results. Queries are cheapest with cellSize about
+ * equal to the radius.
+ */
+struct CellList {
+	float cellSize = 1.0f;
+	std::vector<glm::vec3> points;        // Positions as of the last build or update
+	std::vector<uint32_t> bucketOf;       // The bucket each point is in
+	std::vector<uint32_t> start;          // First slot of each bucket, and the end of the last
+	std::vector<uint32_t> slotPoint;      // The point in each slot, CELL_LIST_END once it moved away
+	std::vector<glm::vec3> slotPosition;  // Its position
+	std::vector<uint32_t> slotOf;         // The slot of each point, CELL_LIST_END if it moved
+	std::vector<uint32_t> movedHead;      // First point that moved into each bucket
+	std::vector<uint32_t> movedNext;      // Next and previous point that moved into the same bucket
+	std::vector<uint32_t> movedPrevious;
+	size_t moved = 0;
+
+	void build(const glm::vec3 *positions, size_t count, float cellSize);
+	void build(const std::vector<BondedElement> &structure, float cellSize);
+	size_t update(const glm::vec3 *positions);
+	size_t update(const std::vector<BondedElement> &structure);
+
+	size_t size() const {
+		return points.size();
+	}
+
+	size_t buckets() const {
+		return movedHead.size();
+	}
+
+	glm::ivec3 cell(glm::vec3 position) const {
+		return glm::ivec3(glm::floor(position / cellSize));
+	}
+
+	uint32_t bucket(glm::ivec3 cell) const {
+		uint32_t hash = (uint32_t)cell.x * 73856093u ^ (uint32_t)cell.y * 19349663u ^ (uint32_t)cell.z * 83492791u;
+		return hash & (buckets() - 1);
+	}
+
+	/**
+	 * Call visit(index, position) for every point in a bucket
+	 *
+	 * @param b the bucket
+	 * @param visit what to do with each point
+	 */
+	template<typename Visit>
+	void forEachInBucket(uint32_t b, Visit visit) const {
+		for(uint32_t s = start[b]; s < start[b + 1]; s++) {
+			if(slotPoint[s] != CELL_LIST_END) {
+				visit(slotPoint[s], slotPosition[s]);
+			}
+		}
+		for(uint32_t p = movedHead[b]; p != CELL_LIST_END; p = movedNext[p]) {
+			visit(p, points[p]);
+		}
+	}
+
+	/**
+	 * Call visit(index, distance2) for every point within
+	 * radius of a position, in no particular order
+	 *
+	 * @param position the centre of the query
+	 * @param radius the cutoff
+	 * @param visit what to do with each point found
+	 */
+	template<typename Visit>
+	void forEachNeighbour(glm::vec3 position, float radius, Visit visit) const {
+		if(points.empty()) {
+			return;
+		}
+		float radius2 = radius * radius;
+		int reach = (int)ceil(radius / cellSize);
+		glm::ivec3 centre = cell(position);
+		std::vector<uint32_t> visited;
+		for(int x = -reach; x <= reach; x++) {
+			for(int y = -reach; y <= reach; y++) {
+				for(int z = -reach; z <= reach; z++) {
+					uint32_t b = bucket(centre + glm::ivec3(x, y, z));
+					if(std::find(visited.begin(), visited.end(), b) != visited.end()) {
+						continue;
+					}
+					visited.push_back(b);
+					forEachInBucket(b, [&](uint32_t p, glm::vec3 other) {
+						glm::vec3 d = other - position;
+						float distance2 = glm::dot(d, d);
+						if(distance2 <= radius2) {
+							visit(p, distance2);
+						}
+					});
+				}
+			}
+		}
+	}
+
+	/**
+	 * Call visit(i, j, distance2) once for every pair of points
+	 * within radius of each other, with i < j
+	 * Points are taken bucket by bucket, so the buckets around one
+	 * point are still in cache for the next. All pairs of one i come
+	 * together, so a caller can set up per-point state (e.g.
+	 * exclusions) whenever i changes.
+	 *
+	 * @param radius the cutoff
+	 * @param visit what to do with each pair found
+	 */
+	template<typename Visit>
+	void forEachPair(float radius, Visit visit) const {
+		float radius2 = radius * radius;
+		int reach = (int)ceil(radius / cellSize);
+		std::vector<uint32_t> stamp(buckets(), CELL_LIST_END);
+		for(uint32_t home = 0; home < buckets(); home++) {
+			forEachInBucket(home, [&](uint32_t i, glm::vec3 position) {
+				glm::ivec3 centre = cell(position);
+				for(int x = -reach; x <= reach; x++) {
+					for(int y = -reach; y <= reach; y++) {
+						for(int z = -reach; z <= reach; z++) {
+							uint32_t b = bucket(centre + glm::ivec3(x, y, z));
+							if(stamp[b] == i) {
+								continue;
+							}
+							stamp[b] = i;
+							forEachInBucket(b, [&](uint32_t j, glm::vec3 other) {
+								glm::vec3 d = other - position;
+								float distance2 = glm::dot(d, d);
+								if(j > i && distance2 <= radius2) {
+									visit(i, j, distance2);
+								}
+							});
+						}
+					}
+				}
+			});
+		}
+	}
+
+private:
+	bool place(uint32_t point, glm::vec3 position);
+};
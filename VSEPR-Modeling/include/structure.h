@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "VSEPR.h"
+
+/**
+ * A structure being bonded, with its totals kept up to date
+ * Every change goes through this object, which adjusts the electron
+ * count (see countElectrons) and the formal charge sum (see
+ * getTotalFormalCharge) by the change in the atoms it touched and
+ * logs how to reverse it. A trial move is
+ *   size_t mark = state.mark();
+ *   state.shiftBond(0, i);
+ *   if(worse) state.undo(mark);
+ * so trying a move costs as much as the move, not a pass over the
+ * structure or a copy of it.
+ * Atoms are referred to by index, so the vector may grow while the
+ * state is in use.
+ */
+struct StructureState {
+	/**
+	 * How to reverse one change
+	 */
+	struct Change {
+		enum Kind : uint8_t {
+			BOND,       // bond(a, b)
+			SHIFT_BOND, // shiftBond(a, b), a received
+			LONE        // delta lone electrons added to a
+		};
+		Kind kind;
+		uint32_t a;
+		uint32_t b;
+		int delta;
+	};
+
+	std::vector<BondedElement> &atoms;
+	int electrons = 0;
+	int formalCharge = 0; // Sum of the atoms' absolute formal charges
+	std::vector<Change> log;
+
+	explicit StructureState(std::vector<BondedElement> &atoms);
+
+	void add(BondedElement atom);
+	[[nodiscard]] BuildError bond(size_t a, size_t b);
+	bool shiftBond(size_t receiver, size_t donor);
+	void addLoneElectrons(size_t atom, int delta);
+
+	size_t mark() const {
+		return log.size();
+	}
+
+	void undo(size_t mark);
+
+	/**
+	 * Keep every change so far, so the log doesn't grow
+	 * through a long series of accepted moves
+	 */
+	void commit() {
+		log.clear();
+	}
+
+private:
+	void forget(const BondedElement &atom);
+	void count(const BondedElement &atom);
+};
@@ -0,0 +1,148 @@
+#include <new>
+#include <cstdlib>
+#include "allocation.h"
+
+// Replacing the global allocator costs every allocation of every program
+// linked against the library, so it's only built when reports are asked for
+#ifdef VSEPR_ALLOCATION_REPORT
+
+// Per-thread so concurrent requests don't pollute each other's counts
+static thread_local uint64_t allocationCount = 0;
+
+/**
+ * Get the number of heap allocations the calling
+ * thread has made since it started
+ * 
+ * @return the allocation count
+ */
+uint64_t heapAllocationCount() {
+    return allocationCount;
+}
+
+/**
+ * Allocate memory like the default operator new, calling the
+ * new handler until it succeeds, and count the call
+ *
+ * @param size the number of bytes
+ * @param alignment the alignment, 0 for malloc's
+ * @return the memory
+ */
+static void *countedAllocate(std::size_t size, std::size_t alignment) {
+    allocationCount++;
+    if(size == 0) {
+        size = 1;
+    }
+    if(alignment > 0) {
+        // aligned_alloc wants a multiple of the alignment
+        size = (size + alignment - 1) / alignment * alignment;
+    }
+    while(true) {
+        void *p = alignment > 0 ? std::aligned_alloc(alignment, size) : std::malloc(size);
+        if(p) {
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if(!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+/**
+ * Replacement global allocation functions
+ * These behave like the defaults but count every call. Every
+ * form is replaced (aligned, nothrow) so memory is never freed
+ * by a different allocator than the one that gave it out.
+ */
+void *operator new(std::size_t size) {
+    return countedAllocate(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAllocate(size, (std::size_t)alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAllocate(size, (std::size_t)alignment);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return countedAllocate(size, 0);
+    }
+    catch(const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    try {
+        return countedAllocate(size, (std::size_t)alignment);
+    }
+    catch(const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return ::operator new(size, alignment, std::nothrow);
+}
+
+void *operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+#endif
@@ -0,0 +1,181 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "VSEPR.h"
+#include "context.h"
+#include "cache.h"
+#include "smiles.h"
+
+using namespace std;
+
+// Lines built per round. Big enough to keep every core busy,
+// small enough that output starts streaming straight away
+#define BATCH_CHUNK_SIZE 4096
+
+/**
+ * Build one line of a batch and format its output record
+ *
+ * @param context the lookup tables to build with
+ * @param cache finished structures shared between the workers
+ * @param line the formula or name
+ * @param smiles whether the line is a SMILES string without SMILES_PREFIX
+ * @param out the record: the input line followed by its table or an error
+ * @return why the line couldn't be built, BUILD_OK if it was
+ */
+static BuildErrorCode buildRecord(const ModelingContext &context, StructureCache &cache, const string &line, bool smiles, string &out) {
+	StructureCache::Entry result;
+	try {
+		result = cache.build(context, smiles ? SMILES_PREFIX + line : line);
+	}
+	catch(const std::exception &err) {
+		// Builders report failures in their result, this is only running out of memory
+		BuildResult failed;
+		failed.error = BuildError(BUILD_ERROR_INTERNAL, err.what());
+		result = make_shared<const BuildResult>(std::move(failed));
+	}
+	out = line;
+	out += '\n';
+	if(result->error) {
+		out += result->error.message;
+		out += '\n';
+		return result->error.code;
+	}
+	if(result->structure.empty() && !result->organic) {
+		out += "Input not recognized\n";
+		return BUILD_ERROR_NOT_RECOGNIZED;
+	}
+	out += formatStructureTable(result->structure);
+	return BUILD_OK;
+}
+
+/**
+ * Build every line of a stream on several threads and write
+ * the results in input order
+ * Lines are read and built a chunk at a time so memory use
+ * stays flat no matter how long the input is. Blank lines are skipped.
+ *
+ * @param context the lookup tables to build with
+ * @param cache finished structures, so repeated inputs are only built once
+ * @param in the formulas and names, one per line
+ * @param out where to write the results
+ * @param threads the number of threads to build on, 0 for one per core
+ * @param smiles whether every line is a SMILES string
+ * @param failures if set, incremented for each line that couldn't be built by reason
+ * @return the number of lines that couldn't be built
+ */
+int runBatch(const ModelingContext &context, StructureCache &cache, istream &in, ostream &out, unsigned int threads, bool smiles, BatchFailures *failures) {
+	if(threads == 0) {
+		threads = max(1u, thread::hardware_concurrency());
+	}
+
+	vector<string> lines;
+	vector<string> records;
+	lines.reserve(BATCH_CHUNK_SIZE);
+	BatchFailures tally;
+	string line;
+	bool more = true;
+	while(more) {
+		lines.clear();
+		while(lines.size() < BATCH_CHUNK_SIZE && (more = (bool)getline(in, line))) {
+			if(!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if(!line.empty()) {
+				lines.push_back(line);
+			}
+		}
+		if(lines.empty()) {
+			break;
+		}
+
+		records.assign(lines.size(), string());
+		atomic<size_t> next(0);
+		atomic<int> chunkFailures[BUILD_ERROR_COUNT] = {};
+		auto worker = [&]() {
+			for(size_t i = next++; i < lines.size(); i = next++) {
+				BuildErrorCode code = buildRecord(context, cache, lines[i], smiles, records[i]);
+				if(code != BUILD_OK) {
+					chunkFailures[code].fetch_add(1, memory_order_relaxed);
+				}
+			}
+		};
+
+		unsigned int poolSize = min<size_t>(threads, lines.size());
+		vector<thread> pool;
+		pool.reserve(poolSize);
+		for(unsigned int t = 1; t < poolSize; t++) {
+			pool.emplace_back(worker);
+		}
+		worker();
+		for(thread &t : pool) {
+			t.join();
+		}
+
+		for(const string &record : records) {
+			out << record;
+		}
+		for(int code = 0; code < BUILD_ERROR_COUNT; code++) {
+			tally.counts[code] += chunkFailures[code];
+		}
+	}
+	out.flush();
+	if(failures != nullptr) {
+		for(int code = 0; code < BUILD_ERROR_COUNT; code++) {
+			failures->counts[code] += tally.counts[code];
+		}
+	}
+	return tally.total();
+}
+
+/**
+ * Entry point for non-interactive batch builds
+ * Never opens a window
+ *
+ * @param path the file to read, or null/"-" for stdin
+ * @param smiles whether every line is a SMILES string
+ * @return the process exit code
+ */
+int batchMain(const char *path, bool smiles) {
+	const ModelingContext *context;
+	try {
+		context = &defaultContext();
+	}
+	catch(const std::exception &err) {
+		cerr << err.what() << '\n';
+		return 1;
+	}
+
+	ios::sync_with_stdio(false);
+	// Records only hold bond tables, so the geometry isn't relaxed
+	StructureCache cache(STRUCTURE_CACHE_SIZE, false);
+	BatchFailures failures;
+	if(path == nullptr || string(path) == "-") {
+		runBatch(*context, cache, cin, cout, 0, smiles, &failures);
+	}
+	else {
+		ifstream file(path);
+		if(!file) {
+			cerr << "Couldn't open " << path << '\n';
+			return 1;
+		}
+		runBatch(*context, cache, file, cout, 0, smiles, &failures);
+	}
+
+	cerr << "Structure cache: " << cache.hits() << " hits, " << cache.misses() << " misses, " << cache.shared() << " shared across notations" << '\n';
+	if(failures.total() > 0) {
+		cerr << "Failed: " << failures.total();
+		const char *separator = " (";
+		for(int code = 0; code < BUILD_ERROR_COUNT; code++) {
+			if(failures.counts[code] > 0) {
+				cerr << separator << failures.counts[code] << ' ' << buildErrorName((BuildErrorCode)code);
+				separator = ", ";
+			}
+		}
+		cerr << ")\n";
+	}
+	return failures.total() > 0 ? 2 : 0;
+}
@@ -0,0 +1,41 @@
+#include "molecule.h"
+
+using namespace std;
+
+/**
+ * Index the bonds of a structure
+ * Neighbour UIDs that aren't part of the structure are skipped
+ *
+ * @param structure the atoms of the compound
+ * @param n the number of atoms
+ */
+BondGraph::BondGraph(const BondedElement *structure, size_t n) {
+	indexOf.reserve(n);
+	offsets.reserve(n + 1);
+
+	size_t totalBonds = 0;
+	for(size_t i = 0; i < n; i++) {
+		indexOf[structure[i].getUID()] = i;
+		totalBonds += structure[i].bonds.size();
+	}
+	targets.reserve(totalBonds);
+	orders.reserve(totalBonds);
+	edges.reserve(totalBonds / 2);
+
+	offsets.push_back(0);
+	for(size_t i = 0; i < n; i++) {
+		const BondedElement &b = structure[i];
+		for(const Bond &bond : b.bonds) {
+			auto target = indexOf.find(bond.uid);
+			if(target == indexOf.end()) {
+				continue;
+			}
+			targets.push_back(target->second);
+			orders.push_back(bond.order);
+			if(i < target->second) {
+				edges.push_back(BondEdge{(uint32_t)i, target->second, bond.order, bond.resonance});
+			}
+		}
+		offsets.push_back(targets.size());
+	}
+}
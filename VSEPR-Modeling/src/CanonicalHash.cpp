@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cstdio>
+#include "canonical.h"
+#include "molecule.h"
+
+using namespace std;
+
+// Seeds for the two halves of the final key
+#define KEY_SEED_HIGH 0x9e3779b97f4a7c15ULL
+#define KEY_SEED_LOW 0xc2b2ae3d27d4eb4fULL
+// Bonds whose order resonance could change hash alike whatever
+// order their Kekulé structure gave them
+#define RESONANCE_BOND_CODE 7
+// Most atom pairings sameMolecule tries per atom before giving up
+#define MATCH_STEP_LIMIT 64
+
+/**
+ * Scramble a 64-bit value (the splitmix64 finalizer)
+ *
+ * @param x the value
+ * @return the mixed value
+ */
+static inline uint64_t mix(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+/**
+ * Count the distinct labels
+ *
+ * @param labels the atom labels
+ * @param scratch space to sort a copy in
+ * @return the number of distinct labels
+ */
+static size_t countClasses(const vector<uint64_t> &labels, vector<uint64_t> &scratch) {
+	scratch = labels;
+	sort(scratch.begin(), scratch.end());
+	return unique(scratch.begin(), scratch.end()) - scratch.begin();
+}
+
+/**
+ * Compute the canonical key of a finished structure, along with the
+ * refined bond graph it was taken from
+ * Atoms start with a label from their own invariants (element,
+ * formal charge, number of bonds, lone electrons) and are relabelled
+ * from their neighbours' labels and bond orders (Weisfeiler-Lehman /
+ * Morgan refinement) until the labels stop splitting into new classes.
+ * The sorted final labels are then folded into two independent 64-bit
+ * halves. Like any refinement hash it can't tell apart the rare
+ * graphs that refinement doesn't separate (some regular ring systems).
+ * Bonds between two atoms that could each take a higher order (the
+ * bonds enumerateResonance searches) are hashed without their order.
+ * Every atom's own invariants fix its total bond order, so two
+ * structures that only differ in those orders are contributors of
+ * one resonance hybrid, and get one key before resonance is worked
+ * out. Only the bonds and electron counts are read, so the key can
+ * be taken as soon as a structure is bonded, before it's placed.
+ *
+ * @param structure the atoms of the compound, hydrogens included
+ * @return the key and graph
+ */
+CanonicalGraph canonicalGraph(const vector<BondedElement> &structure) {
+	BondGraph graph(structure);
+	size_t n = graph.size();
+
+	vector<uint64_t> labels(n);
+	vector<uint64_t> next(n);
+	vector<uint64_t> scratch;
+	for(size_t i = 0; i < n; i++) {
+		const BondedElement &atom = structure[i];
+		uint64_t invariant = atom.elementId;
+		invariant |= (uint64_t)(uint8_t)getFormalCharge(atom) << 8;
+		invariant |= (uint64_t)(uint8_t)graph.degree(i) << 16;
+		invariant |= (uint64_t)(uint8_t)atom.loneElectrons << 24;
+		labels[i] = mix(invariant);
+	}
+
+	vector<uint8_t> flexible(n);
+	for(size_t i = 0; i < n; i++) {
+		int bondSum = 0;
+		for(uint32_t k = 0; k < graph.degree(i); k++) {
+			bondSum += graph.order(i, k);
+		}
+		flexible[i] = structure[i].loneElectrons / 2 + bondSum > (int)graph.degree(i);
+	}
+	vector<uint8_t> bondCodes(graph.targets.size());
+	for(size_t i = 0; i < n; i++) {
+		for(uint32_t k = 0; k < graph.degree(i); k++) {
+			bool resonance = flexible[i] && flexible[graph.neighboursBegin(i)[k]];
+			bondCodes[graph.offsets[i] + k] = resonance ? RESONANCE_BOND_CODE : graph.order(i, k);
+		}
+	}
+
+	size_t classes = countClasses(labels, scratch);
+	for(size_t round = 0; round < n; round++) {
+		for(size_t i = 0; i < n; i++) {
+			// Summing the neighbour terms makes them order independent
+			uint64_t neighbourhood = 0;
+			for(uint32_t k = 0; k < graph.degree(i); k++) {
+				uint32_t other = graph.neighboursBegin(i)[k];
+				neighbourhood += mix(labels[other] + bondCodes[graph.offsets[i] + k]);
+			}
+			next[i] = mix(labels[i] ^ mix(neighbourhood));
+		}
+		labels.swap(next);
+
+		size_t refined = countClasses(labels, scratch);
+		if(refined == classes) {
+			break;
+		}
+		classes = refined;
+	}
+
+	CanonicalGraph result;
+	result.labels = labels;
+	sort(labels.begin(), labels.end());
+	MoleculeKey &key = result.key;
+	key.high = mix(KEY_SEED_HIGH + n);
+	key.low = mix(KEY_SEED_LOW + graph.edges.size());
+	for(uint64_t label : labels) {
+		key.high = mix(key.high ^ label);
+		key.low = mix(key.low + (label ^ KEY_SEED_LOW));
+	}
+	result.offsets = std::move(graph.offsets);
+	result.targets = std::move(graph.targets);
+	result.codes = std::move(bondCodes);
+	return result;
+}
+
+/**
+ * Compute the canonical key of a finished structure (see canonicalGraph)
+ *
+ * @param structure the atoms of the compound, hydrogens included
+ * @return the key
+ */
+MoleculeKey canonicalKey(const vector<BondedElement> &structure) {
+	return canonicalGraph(structure).key;
+}
+
+/**
+ * Get the code of the bond between two atoms
+ *
+ * @param graph the graph
+ * @param a one atom
+ * @param b the other atom
+ * @return the bond code, 0 if they aren't bonded
+ */
+static uint8_t bondCode(const CanonicalGraph &graph, uint32_t a, uint32_t b) {
+	for(uint32_t k = graph.offsets[a]; k < graph.offsets[a + 1]; k++) {
+		if(graph.targets[k] == b) {
+			return graph.codes[k];
+		}
+	}
+	return 0;
+}
+
+/**
+ * Backtracking search for a bond-preserving pairing of two graphs'
+ * atoms (an isomorphism), see sameMolecule
+ */
+struct GraphMatch {
+	const CanonicalGraph &a;
+	const CanonicalGraph &b;
+	vector<uint32_t> order;   // a's atoms, each after one of its neighbours where possible
+	vector<int> parents;      // The neighbour each atom of order follows, -1 if none
+	vector<int> pairs;        // The b atom each a atom is paired with, -1 if none yet
+	vector<uint8_t> used;     // Whether each b atom is paired
+	size_t steps = 0;
+
+	GraphMatch(const CanonicalGraph &a, const CanonicalGraph &b) : a(a), b(b), pairs(a.size(), -1), used(b.size(), 0) {
+		// Breadth first from each component's atom of rarest label, so
+		// every atom but the first of a component has a paired neighbour
+		// to take its candidates from
+		size_t n = a.size();
+		vector<uint64_t> sorted = a.labels;
+		sort(sorted.begin(), sorted.end());
+		vector<size_t> rarity(n);
+		for(size_t atom = 0; atom < n; atom++) {
+			auto range = equal_range(sorted.begin(), sorted.end(), a.labels[atom]);
+			rarity[atom] = range.second - range.first;
+		}
+		vector<uint8_t> seen(n, 0);
+		while(order.size() < n) {
+			int start = -1;
+			for(uint32_t atom = 0; atom < n; atom++) {
+				if(!seen[atom] && (start < 0 || rarity[atom] < rarity[start])) {
+					start = atom;
+				}
+			}
+			size_t head = order.size();
+			order.push_back(start);
+			parents.push_back(-1);
+			seen[start] = 1;
+			for(; head < order.size(); head++) {
+				uint32_t atom = order[head];
+				for(uint32_t k = a.offsets[atom]; k < a.offsets[atom + 1]; k++) {
+					uint32_t other = a.targets[k];
+					if(!seen[other]) {
+						seen[other] = 1;
+						order.push_back(other);
+						parents.push_back(atom);
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * Check that pairing two atoms keeps every bond to the atoms
+	 * already paired, and adds none
+	 *
+	 * @param u the a atom
+	 * @param v the b atom
+	 * @return true if the pairing is consistent
+	 */
+	bool consistent(uint32_t u, uint32_t v) const {
+		if(a.labels[u] != b.labels[v] || a.offsets[u + 1] - a.offsets[u] != b.offsets[v + 1] - b.offsets[v]) {
+			return false;
+		}
+		int pairedA = 0;
+		for(uint32_t k = a.offsets[u]; k < a.offsets[u + 1]; k++) {
+			int other = pairs[a.targets[k]];
+			if(other >= 0) {
+				if(bondCode(b, v, other) != a.codes[k]) {
+					return false;
+				}
+				pairedA++;
+			}
+		}
+		int pairedB = 0;
+		for(uint32_t k = b.offsets[v]; k < b.offsets[v + 1]; k++) {
+			pairedB += used[b.targets[k]];
+		}
+		return pairedA == pairedB;
+	}
+
+	/**
+	 * Pair the atoms of order from i on
+	 *
+	 * @param i the position in order
+	 * @return true if every atom got paired
+	 */
+	bool search(size_t i) {
+		if(i == order.size()) {
+			return true;
+		}
+		uint32_t u = order[i];
+		auto tryPair = [&](uint32_t v) {
+			if(used[v] || ++steps > MATCH_STEP_LIMIT * order.size() || !consistent(u, v)) {
+				return false;
+			}
+			pairs[u] = v;
+			used[v] = 1;
+			if(search(i + 1)) {
+				return true;
+			}
+			pairs[u] = -1;
+			used[v] = 0;
+			return false;
+		};
+		if(parents[i] >= 0) {
+			uint32_t parent = pairs[parents[i]];
+			for(uint32_t k = b.offsets[parent]; k < b.offsets[parent + 1]; k++) {
+				if(tryPair(b.targets[k])) {
+					return true;
+				}
+			}
+			return false;
+		}
+		for(uint32_t v = 0; v < b.size(); v++) {
+			if(tryPair(v)) {
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/**
+ * Check whether two structures are the same molecule
+ * Refinement can give different graphs the same key (e.g. decalin
+ * and bicyclopentyl), so a matching key is only a candidate. Atoms
+ * are paired in breadth first order, each only with atoms of the same
+ * refinement label among the neighbours of its neighbour's partner,
+ * and every bond to the atoms paired so far must match. Refinement
+ * labels leave few candidates, so this is close to linear for real
+ * molecules; pairs that would take more than MATCH_STEP_LIMIT tries
+ * per atom count as different.
+ *
+ * @param a one structure's graph
+ * @param b the other's
+ * @return true if there's a pairing of their atoms that keeps every bond
+ */
+bool sameMolecule(const CanonicalGraph &a, const CanonicalGraph &b) {
+	if(a.key != b.key || a.size() != b.size() || a.targets.size() != b.targets.size()) {
+		return false;
+	}
+	if(a.size() == 0) {
+		return true;
+	}
+	GraphMatch match(a, b);
+	return match.search(0);
+}
+
+/**
+ * Format the key as 32 hex digits
+ *
+ * @return the hex string
+ */
+string MoleculeKey::toString() const {
+	char text[33];
+	snprintf(text, sizeof(text), "%016llx%016llx", (unsigned long long)high, (unsigned long long)low);
+	return text;
+}
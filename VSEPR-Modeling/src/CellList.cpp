@@ -0,0 +1,141 @@
+#include "spatial.h"
+
+using namespace std;
+
+/**
+ * Sort a set of points into cells, replacing what the list held
+ *
+ * @param positions the points
+ * @param count the number of points
+ * @param cellSize the width of a cell, about the radius queries will use
+ */
+void CellList::build(const glm::vec3 *positions, size_t count, float cellSize) {
+	this->cellSize = cellSize > 0 ? cellSize : 1.0f;
+	size_t bucketCount = 1;
+	while(bucketCount < count * CELL_LIST_BUCKETS_PER_POINT) {
+		bucketCount <<= 1;
+	}
+	points.assign(positions, positions + count);
+	movedHead.assign(bucketCount, CELL_LIST_END);
+	movedNext.assign(count, CELL_LIST_END);
+	movedPrevious.assign(count, CELL_LIST_END);
+	moved = 0;
+
+	// Counting sort by bucket, keeping index order within a bucket
+	bucketOf.resize(count);
+	start.assign(bucketCount + 1, 0);
+	for(size_t i = 0; i < count; i++) {
+		bucketOf[i] = bucket(cell(points[i]));
+		start[bucketOf[i] + 1]++;
+	}
+	for(size_t b = 0; b < bucketCount; b++) {
+		start[b + 1] += start[b];
+	}
+	slotPoint.resize(count);
+	slotPosition.resize(count);
+	slotOf.resize(count);
+	vector<uint32_t> fill(start.begin(), start.end() - 1);
+	for(size_t i = 0; i < count; i++) {
+		uint32_t s = fill[bucketOf[i]]++;
+		slotPoint[s] = i;
+		slotPosition[s] = points[i];
+		slotOf[i] = s;
+	}
+}
+
+/**
+ * Sort the van der Waals positions of a structure into cells
+ *
+ * @param structure the atoms
+ * @param cellSize the width of a cell, about the radius queries will use
+ */
+void CellList::build(const vector<BondedElement> &structure, float cellSize) {
+	vector<glm::vec3> positions;
+	positions.reserve(structure.size());
+	for(const BondedElement &e : structure) {
+		positions.push_back(e.vanDerWaalsPosition);
+	}
+	build(positions.data(), positions.size(), cellSize);
+}
+
+/**
+ * Move a point, taking it out of its slot or moved list
+ * and onto its new bucket's moved list if it changed cell
+ *
+ * @param point the point's index
+ * @param position where it is now
+ * @return whether it changed bucket
+ */
+bool CellList::place(uint32_t point, glm::vec3 position) {
+	points[point] = position;
+	uint32_t b = bucket(cell(position));
+	if(b == bucketOf[point]) {
+		if(slotOf[point] != CELL_LIST_END) {
+			slotPosition[slotOf[point]] = position;
+		}
+		return false;
+	}
+
+	if(slotOf[point] != CELL_LIST_END) {
+		slotPoint[slotOf[point]] = CELL_LIST_END;
+		slotOf[point] = CELL_LIST_END;
+		moved++;
+	}
+	else {
+		if(movedPrevious[point] != CELL_LIST_END) {
+			movedNext[movedPrevious[point]] = movedNext[point];
+		}
+		else {
+			movedHead[bucketOf[point]] = movedNext[point];
+		}
+		if(movedNext[point] != CELL_LIST_END) {
+			movedPrevious[movedNext[point]] = movedPrevious[point];
+		}
+	}
+
+	bucketOf[point] = b;
+	movedPrevious[point] = CELL_LIST_END;
+	movedNext[point] = movedHead[b];
+	if(movedHead[b] != CELL_LIST_END) {
+		movedPrevious[movedHead[b]] = point;
+	}
+	movedHead[b] = point;
+	return true;
+}
+
+/**
+ * Move the points to new positions, relinking only the ones
+ * that crossed into another cell (see CELL_LIST_REBUILD_FRACTION)
+ *
+ * @param positions the new positions, as many as the list was built with
+ * @return the number of points that changed bucket
+ */
+size_t CellList::update(const glm::vec3 *positions) {
+	size_t changed = 0;
+	for(uint32_t i = 0; i < points.size(); i++) {
+		changed += place(i, positions[i]);
+	}
+	if(moved * CELL_LIST_REBUILD_FRACTION > points.size()) {
+		build(positions, points.size(), cellSize);
+	}
+	return changed;
+}
+
+/**
+ * Move the points to the current van der Waals positions of a
+ * structure, which must have as many atoms as it was built with
+ *
+ * @param structure the atoms
+ * @return the number of atoms that changed bucket
+ */
+size_t CellList::update(const vector<BondedElement> &structure) {
+	size_t changed = 0;
+	for(uint32_t i = 0; i < points.size(); i++) {
+		changed += place(i, structure[i].vanDerWaalsPosition);
+	}
+	if(moved * CELL_LIST_REBUILD_FRACTION > points.size()) {
+		vector<glm::vec3> positions(points);
+		build(positions.data(), positions.size(), cellSize);
+	}
+	return changed;
+}
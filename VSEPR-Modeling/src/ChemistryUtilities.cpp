@@ -1,12 +1,32 @@
 #include "VSEPR.h"
-#include "render.h"
+#include "geometry.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtx/quaternion.hpp"
+#include "molecule.h"
+#include "resonance.h"
+#include "data.h"
+#include "context.h"
 #include <vector>
 #include <algorithm>
+#include <cmath>
 #include <map>
 
 using namespace std;
 
-extern map<string, Element> elements;
+/**
+ * Find an element's id (atomic number) by its abbreviated symbol
+ * E.g. He = 2, Br = 35
+ * 
+ * @param symbol the element's symbol
+ * @return the element id if found, -1 otherwise
+ */
+int findElementId(string_view symbol) {
+	int hash = symbolHash(symbol);
+	if(hash < 0 || symbolTable[hash] == LONE_PAIR) {
+		return -1;
+	}
+	return symbolTable[hash];
+}
 
 /**
  * Find an element by its abbreviated symbol
@@ -15,14 +35,12 @@ extern map<string, Element> elements;
  * @param symbol the element's symbol
  * @return the appropriate element object if found, an empty one otherwise
  */
-Element searchElements(string symbol) {
-	int size  = elements.size();
-	Element e = elements[symbol];
-	if(size == elements.size()) {
-		return e;
+Element searchElements(string_view symbol) {
+	int id = findElementId(symbol);
+	if(id < 0) {
+		return Element(-1);
 	}
-	elements.erase(symbol);
-	return Element(-1);
+	return elementTable[id];
 }
 
 /**
@@ -31,8 +49,8 @@ Element searchElements(string symbol) {
  * @param b the atom
  * @return the formal charge
  */
-int getFormalCharge(BondedElement b) {
-	return b.base.valenceNumber - (b.bondedElectrons/2) - b.loneElectrons;
+int getFormalCharge(const BondedElement &b) {
+	return b.base().valenceNumber - (b.bondedElectrons/2) - b.loneElectrons;
 }
 
 /**
@@ -42,11 +60,11 @@ int getFormalCharge(BondedElement b) {
  * @return the number of electrons away from stability
  *         >0 means missing electrons, 0 = stable
  */
-int checkStability(BondedElement b) {
-	if (b.base.periodNumber == 1) {
+int checkStability(const BondedElement &b) {
+	if (b.base().periodNumber == 1) {
 		return 2 - b.bondedElectrons - b.loneElectrons;
 	}
-	if (b.base.exception == true) {
+	if (b.base().exception == true) {
 		return 0;
 	}
 	return 8 - b.bondedElectrons - b.loneElectrons;
@@ -59,31 +77,14 @@ int checkStability(BondedElement b) {
  * @param structure the atom structure
  * @return the total number of electrons
  */
-int countElectrons(vector<BondedElement> structure) {
+int countElectrons(const vector<BondedElement> &structure) {
 	int total = 0;
-	for(BondedElement b : structure) {
+	for(const BondedElement &b : structure) {
 		total += b.loneElectrons + (b.bondedElectrons / 2);
 	}
 	return total;
 }
 
-/**
- * Find how many times a key value occurs in a list
- * 
- * @param v the list
- * @param key the key value
- * @return the number of occurrences
- */
-int findInstances(vector<uint32_t> v, uint32_t key) {
-	int count = 0;
-	for(uint32_t b : v) {
-		if(b == key) {
-			count++;
-		}
-	}
-	return count;
-}
-
 /**
  * Check if a string contains a substring
  * 
@@ -91,7 +92,7 @@ int findInstances(vector<uint32_t> v, uint32_t key) {
  * @param check the substring
  * @return true if the substring is found, false otherwise
  */
-bool checkStringComponent(string main, string check) {
+bool checkStringComponent(string_view main, string_view check) {
 	size_t pos = main.find(check);
 	return pos != std::string::npos;
 }
@@ -102,7 +103,7 @@ bool checkStringComponent(string main, string check) {
  * @param main the base string
  * @return true if theres a number, false otherwise
  */
-bool checkForDigits(string main) {
+bool checkForDigits(string_view main) {
 	for(auto i : main) {
 		if(isdigit(i)) {
 			return true;
@@ -111,69 +112,16 @@ bool checkForDigits(string main) {
 	return false;
 }
 
-/**
- * Find the last instance of a substring
- * 
- * @param main the base string
- * @param check the substring
- * @return the starting index of the last appearance of the substring
- */
-int findLastComponent(string main, string check) {
-	if(check.length() > main.length()) {
-		return -1;
-	}
-	int compIndex = -1;
-	int index = 0;
-	for(int i = 0; i < main.length(); i++) {
-		if(main[i] == check[index]) {
-			index++;
-		}
-		else {
-			index = 0;
-		}
-		if(index == check.length()) {
-			compIndex = i - check.length() + 1;
-			index = 0;
-		}
-	}
-	return compIndex;
-}
-
-/**
- * Find the length of a substituent
- * 
- * @param name the substituent name
- * @return the length according to the prefix
- */
-int findNumberTerm(string name) {
-	vector<string> keys;
-	int diIndex;
-	for(auto it = numberTerms.begin(); it != numberTerms.end(); it++) {
-		keys.push_back(it->first);
-	}
-
-	int lastTerm = 0;
-	int highestIndex = -1;
-	for(int i = 0; i < keys.size(); i++) {
-		int newIndex = findLastComponent(name, keys[i]);
-		if(newIndex > highestIndex) {
-			lastTerm = numberTerms[keys[i]];
-		}
-	}
-
-	return lastTerm;
-}
-
 /**
  * Check if an atom has a valid number of electrons
  * 
  * @param e the atom
  * @return true if its valid, false otherwise
  */
-bool checkBondedElementValidity(BondedElement e) {
+bool checkBondedElementValidity(const BondedElement &e) {
 	if(e.bondedElectrons < 0 || e.loneElectrons < 0) {return false;}
-	if(e.base.periodNumber == 1 && e.bondedElectrons + e.loneElectrons > 2) {return false;}
-	if(e.base.periodNumber == 2 && e.bondedElectrons + e.loneElectrons > 8) {return false;}
+	if(e.base().periodNumber == 1 && e.bondedElectrons + e.loneElectrons > 2) {return false;}
+	if(e.base().periodNumber == 2 && e.bondedElectrons + e.loneElectrons > 8) {return false;}
 	return true;
 }
 
@@ -185,10 +133,10 @@ bool checkBondedElementValidity(BondedElement e) {
  * @return whether the two atoms still have a valid # of electrons
  */
 bool bond(BondedElement &a, BondedElement &b) {
-	a.neighbours.push_back(b.getUID());
+	a.addBond(b.getUID());
 	a.bondedElectrons+=2;
 	a.loneElectrons--;
-	b.neighbours.push_back(a.getUID());
+	b.addBond(a.getUID());
 	b.bondedElectrons+=2;
 	b.loneElectrons--;
 
@@ -204,9 +152,9 @@ bool bond(BondedElement &a, BondedElement &b) {
  * @return whether the two atoms still have a valid # of electrons
 */
 bool shiftBond(BondedElement &receiver, BondedElement &donor) {
-	receiver.neighbours.push_back(donor.getUID());
+	receiver.addBond(donor.getUID());
 	receiver.bondedElectrons+=2;
-	donor.neighbours.push_back(receiver.getUID());
+	donor.addBond(receiver.getUID());
 	donor.bondedElectrons+=2;
 	donor.loneElectrons-=2;
 
@@ -214,23 +162,55 @@ bool shiftBond(BondedElement &receiver, BondedElement &donor) {
 }
 
 /**
- * Bond two atoms and throw an exception if it fails
+ * Revert the most recent shiftBond between two atoms,
+ * handing the bond's electrons back to the donor as a lone pair
+ * 
+ * @param receiver the atom that received the bond
+ * @param donor the atom that gave up the lone pair
+ */
+void undoShiftBond(BondedElement &receiver, BondedElement &donor) {
+	receiver.removeBond(donor.getUID());
+	receiver.bondedElectrons-=2;
+	donor.removeBond(receiver.getUID());
+	donor.bondedElectrons-=2;
+	donor.loneElectrons+=2;
+}
+
+/**
+ * Get the short name of a build error code, used to
+ * tally failures by reason
+ * 
+ * @param code the code
+ * @return the name, e.g. "overbonded"
+ */
+const char *buildErrorName(BuildErrorCode code) {
+	static const char *names[BUILD_ERROR_COUNT] = {
+		"ok", "overbonded", "unbondable atom", "no Lewis structure", "search limit reached", "unrecognized name",
+		"bad chain length", "bad locant", "unknown functional group", "SMILES syntax",
+		"unassignable aromatic bonds", "input not recognized", "internal error"
+	};
+	return code < BUILD_ERROR_COUNT ? names[code] : "unknown";
+}
+
+/**
+ * Bond two atoms, reporting which one is overbonded if it fails
  * 
  * @param a the first element
  * @param b the second element
+ * @return no error if the bond was made
  */
-void bondSafe(BondedElement &a, BondedElement &b) {
-	if(!bond(a, b)) {
-		vector<string> errors;
-		string errorMessage = "Bond error: ";
-		if(a.loneElectrons < 0 || checkStability(a) < 0) {
-			errorMessage += (a.base.name + " overbonded");
-		}
-		else if(b.loneElectrons < 0 || checkStability(b) < 0) {
-			errorMessage += (b.base.name + " overbonded");
-		}
-		throw errorMessage.c_str();
+BuildError bondSafe(BondedElement &a, BondedElement &b) {
+	if(bond(a, b)) {
+		return BuildError();
 	}
+	string errorMessage = "Bond error: ";
+	if(a.loneElectrons < 0 || checkStability(a) < 0) {
+		errorMessage += (a.base().name + " overbonded");
+	}
+	else if(b.loneElectrons < 0 || checkStability(b) < 0) {
+		errorMessage += (b.base().name + " overbonded");
+	}
+	return BuildError(BUILD_ERROR_OVERBONDED, std::move(errorMessage));
 }
 
 /**
@@ -239,7 +219,7 @@ void bondSafe(BondedElement &a, BondedElement &b) {
  * @param structure the compound's structure
  * @return the total formal charge
  */
-int getTotalFormalCharge(vector<BondedElement> structure) {
+int getTotalFormalCharge(const vector<BondedElement> &structure) {
 	int totalCharge = 0;
 	for (int i = 0; i < structure.size(); i++) {
 		totalCharge += abs(getFormalCharge(structure[i]));
@@ -251,33 +231,24 @@ int getTotalFormalCharge(vector<BondedElement> structure) {
  * Generate the transformation matrices required to
  * render cylinders for ball-and-stick models
  * 
- * @param structure the compound's structure
- * @return the structure updated with cylinder models
+ * @param structure the compound's structure, updated with cylinder models
  */
-vector<BondedElement> generateCylinders(vector<BondedElement> structure) {
-	vector<BondedElement> newStruc;
-	for(BondedElement b : structure) {
+void generateCylinders(vector<BondedElement> &structure) {
+	BondGraph graph(structure);
+	for(BondedElement &b : structure) {
 		glm::vec3 start = b.position;
-		std::sort(b.neighbours.begin(), b.neighbours.end());
 
-		for(int i = 0; i < b.neighbours.size(); i++) {
-			auto n = b.neighbours[i];
-			int bondOrder = 1;
+		for(const Bond &bond : b.bonds) {
+			// Averaged resonance orders draw their fraction as a thinner last stick
+			float order = bond.averageOrder > 0 ? bond.averageOrder : bond.order;
+			int bondOrder = (int)ceil(order - RESONANCE_ORDER_TOLERANCE);
+			float lastWidth = order - (bondOrder - 1);
 
-			try{
-				// Max bond order is 3
-				if(b.neighbours.at(i + 1) == n) {
-					bondOrder++; i++;
-				}
-				if(b.neighbours.at(i + 2) == n) {
-					bondOrder++; i++;
-				}
-			}
-			catch (const std::exception &e) {
-				// Do nothing, just to avoid if statements
+			int neighbourIndex = graph.find(bond.uid);
+			if(neighbourIndex < 0) {
+				continue;
 			}
-
-			BondedElement updatedNeighbour = findNeighbour(n, structure);
+			const BondedElement &updatedNeighbour = structure[neighbourIndex];
 			glm::vec3 end = updatedNeighbour.position;
 
 			//Rotation
@@ -304,15 +275,16 @@ vector<BondedElement> generateCylinders(vector<BondedElement> structure) {
 				model = glm::translate(model, start);
 				model = glm::rotate(model, angle, axis);
 				model = glm::translate(model, glm::vec3(lateralOffset, 0, 0));
-				if (updatedNeighbour.base.name == "hydrogen" || b.base.name == "hydrogen") {
+				if (updatedNeighbour.elementId == HYDROGEN || b.elementId == HYDROGEN) {
 					model = glm::scale(model, glm::vec3(1.0f, 0.7f, 1.0f));
 				}
+				if(i == bondOrder - 1 && lastWidth < 1.0f - RESONANCE_ORDER_TOLERANCE) {
+					model = glm::scale(model, glm::vec3(lastWidth, 1.0f, lastWidth));
+				}
 				b.cylinderModels.push_back(model);
 			}
 		}
-		newStruc.push_back(b);
 	}
-	return newStruc;
 }
 
 /**
@@ -320,13 +292,12 @@ vector<BondedElement> generateCylinders(vector<BondedElement> structure) {
  * This function's method involves shifting the structure
  * by the average of all the atoms' positions
  * 
- * @param structure the compound's structure
- * @return the newly centered structure
+ * @param structure the compound's structure, centered in place
  */
-vector<BondedElement> averageCenterPositions(vector<BondedElement> structure) {
+void averageCenterPositions(vector<BondedElement> &structure) {
 	glm::vec3 totalOffset;
 	glm::vec3 totalOffset_v;
-	for(BondedElement e : structure) {
+	for(const BondedElement &e : structure) {
 		totalOffset+=e.position;
 		totalOffset_v+=e.vanDerWaalsPosition;
 	}
@@ -337,7 +308,6 @@ vector<BondedElement> averageCenterPositions(vector<BondedElement> structure) {
 		structure[i].position -= offset;
 		structure[i].vanDerWaalsPosition -= offset_v;
 	}
-	return structure;
 }
 
 
@@ -346,16 +316,15 @@ vector<BondedElement> averageCenterPositions(vector<BondedElement> structure) {
  * This function's method involves centering the structure between
  * its most extreme points
  * 
- * @param structure the compound's structure
- * @return the newly centered structure
+ * @param structure the compound's structure, centered in place
  */
-vector<BondedElement> centerPositions(vector<BondedElement> structure) {
+void centerPositions(vector<BondedElement> &structure) {
     glm::vec3 lowestExtreme = glm::vec3(0);
 	glm::vec3 greatestExtreme = glm::vec3(0);
 	glm::vec3 lowestExtreme_v = glm::vec3(0);
 	glm::vec3 greatestExtreme_v = glm::vec3(0);
 
-	for(BondedElement e : structure) {
+	for(const BondedElement &e : structure) {
 		// Lowest extreme regular positions
 		if (e.position.x < lowestExtreme.x) { lowestExtreme.x = e.position.x; }
 		if (e.position.y < lowestExtreme.y) { lowestExtreme.y = e.position.y; }
@@ -384,6 +353,4 @@ vector<BondedElement> centerPositions(vector<BondedElement> structure) {
 		structure[i].position -= offset;
 		structure[i].vanDerWaalsPosition -= offset_v;
 	}
-
-	return structure;
 }
\ No newline at end of file
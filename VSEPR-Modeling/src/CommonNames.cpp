@@ -0,0 +1,173 @@
+#include <cstdint>
+#include <string_view>
+#include "VSEPR.h"
+
+using namespace std;
+
+struct CommonName {
+	string_view name;
+	string_view input;
+};
+
+static constexpr CommonName commonNames[] = {
+#define COMMON_NAME(name, input, formula) {name, input},
+#include "commonNames.def"
+#undef COMMON_NAME
+};
+
+static constexpr size_t commonNameCount = sizeof(commonNames) / sizeof(commonNames[0]);
+
+/**
+ * Get the smallest power of two at least twice the number of names,
+ * so each bucket finds free slots after a few tries
+ *
+ * @return the number of slots in the lookup table
+ */
+static constexpr size_t commonNameSlots() {
+	size_t slots = 1;
+	while(slots < commonNameCount * 2) {
+		slots *= 2;
+	}
+	return slots;
+}
+
+/**
+ * Hash a name the way it's matched, ignoring case and whitespace (FNV-1a)
+ *
+ * @param name the name
+ * @param seed picks one hash function out of the family
+ * @return the hash
+ */
+static constexpr uint32_t commonNameHash(string_view name, uint32_t seed) {
+	uint32_t hash = 2166136261u ^ seed;
+	for(char c : name) {
+		if(c == ' ' || c == '\t') {
+			continue;
+		}
+		if(c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		hash = (hash ^ (uint8_t)c) * 16777619u;
+	}
+	return hash ^ (hash >> 15);
+}
+
+/**
+ * Perfect hash table over the names, built at compile time
+ * (hash and displace). Names are split into buckets by one hash,
+ * then each bucket, biggest first, gets the first seed that sends
+ * all of its names to free slots. A lookup is one hash to find the
+ * bucket's seed and one more to find the slot.
+ */
+struct CommonNameTable {
+	uint32_t seeds[commonNameCount] = {};
+	int16_t slots[commonNameSlots()] = {};
+	bool complete = false;
+
+	constexpr CommonNameTable() {
+		size_t buckets[commonNameCount] = {};
+		size_t bucketSizes[commonNameCount] = {};
+		for(size_t i = 0; i < commonNameCount; i++) {
+			buckets[i] = commonNameHash(commonNames[i].name, 0) % commonNameCount;
+			bucketSizes[buckets[i]]++;
+		}
+		for(size_t s = 0; s < commonNameSlots(); s++) {
+			slots[s] = -1;
+		}
+
+		for(size_t size = commonNameCount; size > 0; size--) {
+			for(size_t b = 0; b < commonNameCount; b++) {
+				if(bucketSizes[b] != size) {
+					continue;
+				}
+				uint32_t seed = 1;
+				while(!place(b, buckets, seed)) {
+					if(++seed > 100000) {
+						return;
+					}
+				}
+				seeds[b] = seed;
+			}
+		}
+		complete = true;
+	}
+
+	/**
+	 * Try to put every name of a bucket in a free slot
+	 * Slots are only claimed if the whole bucket fits
+	 *
+	 * @param bucket the bucket
+	 * @param buckets the bucket of each name
+	 * @param seed the seed to try
+	 * @return true if the bucket was placed
+	 */
+	constexpr bool place(size_t bucket, const size_t *buckets, uint32_t seed) {
+		size_t claimed[commonNameCount] = {};
+		size_t count = 0;
+		for(size_t i = 0; i < commonNameCount; i++) {
+			if(buckets[i] != bucket) {
+				continue;
+			}
+			size_t slot = commonNameHash(commonNames[i].name, seed) & (commonNameSlots() - 1);
+			if(slots[slot] >= 0) {
+				for(size_t c = 0; c < count; c++) {
+					slots[claimed[c]] = -1;
+				}
+				return false;
+			}
+			slots[slot] = i;
+			claimed[count++] = slot;
+		}
+		return true;
+	}
+};
+
+static constexpr CommonNameTable commonNameTable;
+static_assert(commonNameTable.complete, "No perfect hash for commonNames.def, is a name listed twice?");
+
+/**
+ * Compare an input with a listed name, ignoring case and whitespace
+ *
+ * @param input the input
+ * @param name the name in commonNames.def (lower case)
+ * @return true if they match
+ */
+static bool matchesCommonName(string_view input, string_view name) {
+	size_t n = 0;
+	for(char c : input) {
+		if(c == ' ' || c == '\t') {
+			continue;
+		}
+		while(n < name.length() && name[n] == ' ') {
+			n++;
+		}
+		if(c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		if(n == name.length() || name[n] != c) {
+			return false;
+		}
+		n++;
+	}
+	while(n < name.length() && name[n] == ' ') {
+		n++;
+	}
+	return n == name.length();
+}
+
+/**
+ * Look up the trivial name of a compound, e.g. "water" or "benzene"
+ * Costs one hash and one comparison, nothing is parsed
+ *
+ * @param input the line of input
+ * @return the formula, name or SMILES input it stands for
+ *         (see commonNames.def), empty if it isn't a listed name
+ */
+string_view findCommonName(string_view input) {
+	uint32_t seed = commonNameTable.seeds[commonNameHash(input, 0) % commonNameCount];
+	int16_t index = commonNameTable.slots[commonNameHash(input, seed) & (commonNameSlots() - 1)];
+	if(index < 0 || !matchesCommonName(input, commonNames[index].name)) {
+		return string_view();
+	}
+	return commonNames[index].input;
+}
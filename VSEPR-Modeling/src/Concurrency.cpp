@@ -1,13 +1,24 @@
 #include <mutex>
 #include <vector>
 #include <condition_variable>
+#include <cstdio>
 #include "VSEPR.h"
+#include "molecule.h"
+#include "conformers.h"
 
 // Model shared between threads
 // This variable is only available in the scope
 // of this file so it cannot be accessed by the render/model threads
 // through any non-thread-safe means.
 std::vector<BondedElement> sharedModel;
+// Column copy of sharedModel built once per update on the model thread
+MoleculeStore sharedStore;
+// Incremented every time the shared model is replaced
+unsigned int sharedVersion = 0;
+// Conformers of the shared model, lowest energy first, and which one is shown (-1 for none)
+std::vector<Conformer> sharedConformers;
+int sharedConformer = -1;
+bool sharedOrganic = false;
 // Mutex to manage thread permissions
 std::mutex accessMutex;
 
@@ -22,20 +33,52 @@ std::condition_variable frameWait;
  * Also prohibits writing to data while drawing a frame
  *
  * @param model an updated version of the model if it's being set (optional for read)
+ *              pass it with std::move to hand the atoms over without copying
+ * @param organic whether the model is an organic compound
+ * @return a copy of the shared model when reading, an empty list after a write
 */
-std::vector<BondedElement> mutateModel(std::vector<BondedElement> model) {
+std::vector<BondedElement> mutateModel(std::vector<BondedElement> model, bool organic) {
     std::vector<BondedElement> returnVec;
     accessMutex.lock();
         if(model.size() > 0) {
             std::unique_lock<std::mutex> lck(frameMutex);
             while (!ready) frameWait.wait(lck);
-            sharedModel = model;
+            sharedStore = MoleculeStore(model);
+            sharedStore.organic = organic;
+            sharedModel = std::move(model);
+            sharedVersion++;
+            sharedConformers.clear();
+            sharedConformer = -1;
+            sharedOrganic = organic;
+        }
+        else {
+            returnVec = sharedModel;
         }
-        returnVec = sharedModel;
     accessMutex.unlock();
     return returnVec;
 }
 
+/**
+ * Copy the shared model and its column store into the
+ * render thread's local copies, but only if the model changed
+ * since the last poll. Avoids copying the atoms every frame.
+ *
+ * @param model the render thread's local model
+ * @param store the render thread's local column store
+ * @param version the version the local copies are at, updated on copy
+ * @return whether the local copies were updated
+*/
+bool pollModel(std::vector<BondedElement> &model, MoleculeStore &store, unsigned int &version) {
+    std::lock_guard<std::mutex> lock(accessMutex);
+    if(version == sharedVersion) {
+        return false;
+    }
+    model = sharedModel;
+    store = sharedStore;
+    version = sharedVersion;
+    return true;
+}
+
 /**
  * Called by render thread to allow mutation of model variable.
  * Mutation is prohibited during a frame draw to avoid errors with
@@ -49,3 +92,43 @@ void readyFrameUpdate() {
     }
     frameWait.notify_one();
 }
+
+/**
+ * Replace the conformers of the shared model
+ * Called as conformers are found, so the list can grow and
+ * reorder while it's being stepped through. The shown model
+ * doesn't change until the next step.
+ *
+ * @param conformers the conformers found so far, lowest energy first
+*/
+void publishConformers(const std::vector<Conformer> &conformers) {
+    std::lock_guard<std::mutex> lock(accessMutex);
+    sharedConformers = conformers;
+    if(sharedConformer >= (int)sharedConformers.size()) {
+        sharedConformer = (int)sharedConformers.size() - 1;
+    }
+}
+
+/**
+ * Show another conformer of the shared model
+ * Called by the render thread between frames, so the shared
+ * model can be replaced without waiting for the frame to finish.
+ *
+ * @param step how many conformers to move by, negative to go back
+ * @return whether there were conformers to step through
+*/
+bool stepConformer(int step) {
+    std::lock_guard<std::mutex> lock(accessMutex);
+    int count = (int)sharedConformers.size();
+    if(count == 0) {
+        return false;
+    }
+    sharedConformer = sharedConformer < 0 ? (step > 0 ? 0 : count - 1) : ((sharedConformer + step) % count + count) % count;
+    const Conformer &conformer = sharedConformers[sharedConformer];
+    sharedModel = conformer.structure;
+    sharedStore = MoleculeStore(sharedModel);
+    sharedStore.organic = sharedOrganic;
+    sharedVersion++;
+    printf("Conformer %d of %d: %.2f kcal/mol\n", sharedConformer + 1, count, conformer.energy);
+    return true;
+}
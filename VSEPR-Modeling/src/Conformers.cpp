@@ -0,0 +1,625 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "conformers.h"
+#include "forcefield.h"
+#include "molecule.h"
+
+using namespace std;
+
+/**
+ * Find the atoms reachable from one atom without crossing its bond to another
+ *
+ * @param graph the bonds of the structure
+ * @param from the atom to start at
+ * @param across the atom on the other side of the bond
+ * @param side filled with the atoms found, from included
+ * @return whether across was reached another way, i.e. the bond is in a ring
+ */
+static bool collectSide(const BondGraph &graph, uint32_t from, uint32_t across, vector<uint32_t> &side) {
+	vector<uint8_t> seen(graph.size(), 0);
+	side.assign(1, from);
+	seen[from] = 1;
+	seen[across] = 1;
+	for(size_t k = 0; k < side.size(); k++) {
+		for(const uint32_t *n = graph.neighboursBegin(side[k]); n != graph.neighboursEnd(side[k]); n++) {
+			if(*n == across && side[k] != from) {
+				return true;
+			}
+			if(!seen[*n]) {
+				seen[*n] = 1;
+				side.push_back(*n);
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Check whether an atom has a heavy neighbour other than one atom
+ *
+ * @param structure the atoms
+ * @param graph the bonds of the structure
+ * @param atom the atom to check
+ * @param other the neighbour to leave out
+ * @return whether it has one
+ */
+static bool hasHeavyNeighbour(const vector<BondedElement> &structure, const BondGraph &graph, uint32_t atom, uint32_t other) {
+	for(const uint32_t *n = graph.neighboursBegin(atom); n != graph.neighboursEnd(atom); n++) {
+		if(*n != other && structure[*n].elementId != HYDROGEN) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Find the bonds of a structure worth turning to make new conformers
+ * These are single bonds outside rings and resonance systems with
+ * something heavier than hydrogen on both ends, so turning them
+ * moves more than a methyl group's hydrogens. The smaller side of
+ * each bond is the one that moves.
+ *
+ * @param structure the atoms, with bonds filled in
+ * @return the rotatable bonds
+ */
+vector<RotatableBond> findRotatableBonds(const vector<BondedElement> &structure) {
+	BondGraph graph(structure);
+	vector<RotatableBond> rotatable;
+	vector<uint32_t> side;
+	for(const BondEdge &edge : graph.edges) {
+		if(edge.order != 1 || edge.resonance) {
+			continue;
+		}
+		if(!hasHeavyNeighbour(structure, graph, edge.a, edge.b) || !hasHeavyNeighbour(structure, graph, edge.b, edge.a)) {
+			continue;
+		}
+		if(collectSide(graph, edge.b, edge.a, side)) {
+			continue;
+		}
+		if(side.size() * 2 <= graph.size()) {
+			rotatable.push_back(RotatableBond{edge.a, edge.b, side});
+		}
+		else {
+			collectSide(graph, edge.a, edge.b, side);
+			rotatable.push_back(RotatableBond{edge.b, edge.a, side});
+		}
+	}
+	return rotatable;
+}
+
+/**
+ * Turn the moving side of a bond about the bond's axis
+ *
+ * @param coordinates x, y and z of each atom in turn, updated in place
+ * @param bond the bond and the atoms on its moving side
+ * @param angle how far to turn, in radians
+ */
+static void turnBond(vector<double> &coordinates, const RotatableBond &bond, double angle) {
+	glm::dvec3 origin(coordinates[3*bond.b], coordinates[3*bond.b + 1], coordinates[3*bond.b + 2]);
+	glm::dvec3 axis = origin - glm::dvec3(coordinates[3*bond.a], coordinates[3*bond.a + 1], coordinates[3*bond.a + 2]);
+	if(glm::dot(axis, axis) == 0) {
+		return;
+	}
+	axis = glm::normalize(axis);
+	double c = cos(angle);
+	double s = sin(angle);
+	for(uint32_t atom : bond.moving) {
+		glm::dvec3 v = glm::dvec3(coordinates[3*atom], coordinates[3*atom + 1], coordinates[3*atom + 2]) - origin;
+		// Rodrigues' rotation formula
+		v = v * c + glm::cross(axis, v) * s + axis * glm::dot(axis, v) * (1 - c);
+		coordinates[3*atom] = origin.x + v.x;
+		coordinates[3*atom + 1] = origin.y + v.y;
+		coordinates[3*atom + 2] = origin.z + v.z;
+	}
+}
+
+/**
+ * Diagonalize a symmetric matrix with Jacobi rotations
+ *
+ * @param m the matrix, left with its eigenvalues on the diagonal
+ * @param vectors filled with the eigenvectors, one per column
+ */
+template<int N>
+static void diagonalize(double m[N][N], double vectors[N][N]) {
+	for(int r = 0; r < N; r++) {
+		for(int c = 0; c < N; c++) {
+			vectors[r][c] = r == c ? 1 : 0;
+		}
+	}
+	for(int sweep = 0; sweep < 50; sweep++) {
+		double off = 0;
+		for(int p = 0; p < N; p++) {
+			for(int q = p + 1; q < N; q++) {
+				off += m[p][q] * m[p][q];
+			}
+		}
+		if(off < 1e-18) {
+			break;
+		}
+		for(int p = 0; p < N; p++) {
+			for(int q = p + 1; q < N; q++) {
+				if(m[p][q] == 0) {
+					continue;
+				}
+				double theta = (m[q][q] - m[p][p]) / (2 * m[p][q]);
+				double t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+				double c = 1 / sqrt(t * t + 1);
+				double s = t * c;
+				for(int k = 0; k < N; k++) {
+					double kp = m[k][p];
+					double kq = m[k][q];
+					m[k][p] = c * kp - s * kq;
+					m[k][q] = s * kp + c * kq;
+					kp = vectors[k][p];
+					kq = vectors[k][q];
+					vectors[k][p] = c * kp - s * kq;
+					vectors[k][q] = s * kp + c * kq;
+				}
+				for(int k = 0; k < N; k++) {
+					double pk = m[p][k];
+					double qk = m[q][k];
+					m[p][k] = c * pk - s * qk;
+					m[q][k] = s * pk + c * qk;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Press every ring system of a geometry flat onto its best fit plane,
+ * then pucker lone rings by moving their atoms alternately up and down
+ * A flat ring is the saddle between its puckers, so starting from
+ * either side of it can land in any of them (e.g. either chair of
+ * a cyclohexane, with its substituents axial or equatorial).
+ *
+ * @param graph the bonds of the structure
+ * @param coordinates x, y and z of each atom in turn, updated in place
+ * @param pucker how far (A) to move lone ring atoms off the plane, the sign picks which way
+ * @return the number of ring systems flattened
+ */
+static size_t flattenRings(const BondGraph &graph, vector<double> &coordinates, double pucker) {
+	// Ring bonds are the ones whose ends are still joined without them.
+	// Aromatic rings can't pucker, so their bonds are left out
+	vector<vector<uint32_t>> ringNeighbours(graph.size());
+	vector<uint32_t> side;
+	for(const BondEdge &edge : graph.edges) {
+		if(!edge.resonance && collectSide(graph, edge.b, edge.a, side)) {
+			ringNeighbours[edge.a].push_back(edge.b);
+			ringNeighbours[edge.b].push_back(edge.a);
+		}
+	}
+
+	vector<uint8_t> seen(graph.size(), 0);
+	vector<uint32_t> system;
+	size_t systems = 0;
+	for(uint32_t first = 0; first < graph.size(); first++) {
+		if(seen[first] || ringNeighbours[first].empty()) {
+			continue;
+		}
+		systems++;
+		seen[first] = 1;
+		system.assign(1, first);
+		for(size_t k = 0; k < system.size(); k++) {
+			for(uint32_t n : ringNeighbours[system[k]]) {
+				if(!seen[n]) {
+					seen[n] = 1;
+					system.push_back(n);
+				}
+			}
+		}
+
+		glm::dvec3 centre(0);
+		for(uint32_t atom : system) {
+			centre += glm::dvec3(coordinates[3*atom], coordinates[3*atom + 1], coordinates[3*atom + 2]);
+		}
+		centre /= (double)system.size();
+		double spread[3][3] = {};
+		for(uint32_t atom : system) {
+			glm::dvec3 d = glm::dvec3(coordinates[3*atom], coordinates[3*atom + 1], coordinates[3*atom + 2]) - centre;
+			for(int r = 0; r < 3; r++) {
+				for(int c = 0; c < 3; c++) {
+					spread[r][c] += d[r] * d[c];
+				}
+			}
+		}
+		double axes[3][3];
+		diagonalize<3>(spread, axes);
+		int thinnest = 0;
+		for(int a = 1; a < 3; a++) {
+			if(spread[a][a] < spread[thinnest][thinnest]) {
+				thinnest = a;
+			}
+		}
+		glm::dvec3 normal(axes[0][thinnest], axes[1][thinnest], axes[2][thinnest]);
+
+		// Atoms hanging off the rings move with the ring atom they're closest to,
+		// otherwise they'd hold the ring in its old pucker
+		vector<uint32_t> owner(graph.size(), UINT32_MAX);
+		for(uint32_t atom : system) {
+			owner[atom] = atom;
+		}
+		vector<uint32_t> frontier(system);
+		for(size_t k = 0; k < frontier.size(); k++) {
+			for(const uint32_t *n = graph.neighboursBegin(frontier[k]); n != graph.neighboursEnd(frontier[k]); n++) {
+				if(owner[*n] == UINT32_MAX) {
+					owner[*n] = owner[frontier[k]];
+					frontier.push_back(*n);
+				}
+			}
+		}
+		vector<glm::dvec3> shift(graph.size(), glm::dvec3(0));
+		for(uint32_t atom : system) {
+			glm::dvec3 p(coordinates[3*atom], coordinates[3*atom + 1], coordinates[3*atom + 2]);
+			shift[atom] = -normal * glm::dot(p - centre, normal);
+		}
+
+		// A lone ring is laid out as a regular polygon, since a chain
+		// embedding can leave it folded up even once it's flat
+		bool cycle = true;
+		for(uint32_t atom : system) {
+			cycle = cycle && ringNeighbours[atom].size() == 2;
+		}
+		if(cycle) {
+			glm::dvec3 across(axes[0][(thinnest + 1) % 3], axes[1][(thinnest + 1) % 3], axes[2][(thinnest + 1) % 3]);
+			glm::dvec3 along = glm::cross(normal, across);
+			double bondLength = 0;
+			uint32_t previous = system[0];
+			uint32_t atom = ringNeighbours[previous][0];
+			vector<uint32_t> order(1, previous);
+			while(atom != system[0]) {
+				order.push_back(atom);
+				uint32_t following = ringNeighbours[atom][0] == previous ? ringNeighbours[atom][1] : ringNeighbours[atom][0];
+				previous = atom;
+				atom = following;
+			}
+			for(size_t k = 0; k < order.size(); k++) {
+				uint32_t a = order[k];
+				uint32_t b = order[(k + 1) % order.size()];
+				bondLength += glm::length(glm::dvec3(coordinates[3*a] - coordinates[3*b], coordinates[3*a + 1] - coordinates[3*b + 1], coordinates[3*a + 2] - coordinates[3*b + 2]));
+			}
+			bondLength /= order.size();
+			double radius = bondLength / (2 * sin(M_PI / order.size()));
+			for(size_t k = 0; k < order.size(); k++) {
+				double angle = 2 * M_PI * k / order.size();
+				glm::dvec3 p(coordinates[3*order[k]], coordinates[3*order[k] + 1], coordinates[3*order[k] + 2]);
+				double side = k % 2 == 0 ? pucker : -pucker;
+				shift[order[k]] = centre + radius * (cos(angle) * across + sin(angle) * along) + side * normal - p;
+			}
+		}
+		for(uint32_t atom : frontier) {
+			coordinates[3*atom] += shift[owner[atom]].x;
+			coordinates[3*atom + 1] += shift[owner[atom]].y;
+			coordinates[3*atom + 2] += shift[owner[atom]].z;
+		}
+	}
+	return systems;
+}
+
+/**
+ * Pick the atoms two geometries are compared on: the heavy atoms,
+ * or every atom if there are fewer than two heavy ones
+ *
+ * @param structure the atoms
+ * @return their indices
+ */
+static vector<uint32_t> comparedAtoms(const vector<BondedElement> &structure) {
+	vector<uint32_t> atoms;
+	for(uint32_t i = 0; i < structure.size(); i++) {
+		if(structure[i].elementId != HYDROGEN) {
+			atoms.push_back(i);
+		}
+	}
+	if(atoms.size() < 2) {
+		atoms.resize(structure.size());
+		for(uint32_t i = 0; i < structure.size(); i++) {
+			atoms[i] = i;
+		}
+	}
+	return atoms;
+}
+
+/**
+ * Get the root mean square distance between the heavy atoms of two
+ * geometries of a structure, once they're laid over each other as
+ * closely as turning and moving allow (Horn's quaternion method)
+ * Mirror images don't count as the same.
+ *
+ * @param structure the atoms
+ * @param a x, y and z of each atom in turn
+ * @param b the other geometry, the same size
+ * @return the distance in the units of the coordinates
+ */
+double conformerDistance(const vector<BondedElement> &structure, const vector<double> &a, const vector<double> &b) {
+	vector<uint32_t> atoms = comparedAtoms(structure);
+	if(atoms.empty()) {
+		return 0;
+	}
+
+	glm::dvec3 centreA(0);
+	glm::dvec3 centreB(0);
+	for(uint32_t i : atoms) {
+		centreA += glm::dvec3(a[3*i], a[3*i + 1], a[3*i + 2]);
+		centreB += glm::dvec3(b[3*i], b[3*i + 1], b[3*i + 2]);
+	}
+	centreA /= (double)atoms.size();
+	centreB /= (double)atoms.size();
+
+	double s[3][3] = {};
+	double lengths = 0;
+	for(uint32_t i : atoms) {
+		glm::dvec3 u = glm::dvec3(a[3*i], a[3*i + 1], a[3*i + 2]) - centreA;
+		glm::dvec3 v = glm::dvec3(b[3*i], b[3*i + 1], b[3*i + 2]) - centreB;
+		lengths += glm::dot(u, u) + glm::dot(v, v);
+		for(int r = 0; r < 3; r++) {
+			for(int c = 0; c < 3; c++) {
+				s[r][c] += u[r] * v[c];
+			}
+		}
+	}
+
+	double m[4][4] = {
+		{s[0][0] + s[1][1] + s[2][2], s[1][2] - s[2][1], s[2][0] - s[0][2], s[0][1] - s[1][0]},
+		{s[1][2] - s[2][1], s[0][0] - s[1][1] - s[2][2], s[0][1] + s[1][0], s[2][0] + s[0][2]},
+		{s[2][0] - s[0][2], s[0][1] + s[1][0], -s[0][0] + s[1][1] - s[2][2], s[1][2] + s[2][1]},
+		{s[0][1] - s[1][0], s[2][0] + s[0][2], s[1][2] + s[2][1], -s[0][0] - s[1][1] + s[2][2]}
+	};
+	double vectors[4][4];
+	diagonalize<4>(m, vectors);
+	double largest = max(max(m[0][0], m[1][1]), max(m[2][2], m[3][3]));
+	double squared = (lengths - 2 * largest) / atoms.size();
+	return sqrt(max(0.0, squared));
+}
+
+/**
+ * Get how far apart two geometries of a structure are in shape alone
+ * The distances between every pair of heavy atoms are sorted and the
+ * two lists compared, so swapping symmetric atoms or mirroring the
+ * geometry changes nothing, unlike with conformerDistance().
+ *
+ * @param structure the atoms
+ * @param a x, y and z of each atom in turn
+ * @param b the other geometry, the same size
+ * @return the root mean square difference of the sorted distances
+ */
+static double shapeDistance(const vector<BondedElement> &structure, const vector<double> &a, const vector<double> &b) {
+	vector<uint32_t> atoms = comparedAtoms(structure);
+	vector<double> distancesA;
+	vector<double> distancesB;
+	for(size_t i = 0; i < atoms.size(); i++) {
+		for(size_t j = i + 1; j < atoms.size(); j++) {
+			uint32_t p = atoms[i];
+			uint32_t q = atoms[j];
+			distancesA.push_back(glm::distance(glm::dvec3(a[3*p], a[3*p + 1], a[3*p + 2]), glm::dvec3(a[3*q], a[3*q + 1], a[3*q + 2])));
+			distancesB.push_back(glm::distance(glm::dvec3(b[3*p], b[3*p + 1], b[3*p + 2]), glm::dvec3(b[3*q], b[3*q + 1], b[3*q + 2])));
+		}
+	}
+	if(distancesA.empty()) {
+		return 0;
+	}
+	sort(distancesA.begin(), distancesA.end());
+	sort(distancesB.begin(), distancesB.end());
+	double squared = 0;
+	for(size_t k = 0; k < distancesA.size(); k++) {
+		squared += (distancesA[k] - distancesB[k]) * (distancesA[k] - distancesB[k]);
+	}
+	return sqrt(squared / distancesA.size());
+}
+
+/**
+ * Check whether two conformers are the same one
+ * Atoms are compared by index first. A copy of a conformer with
+ * symmetric atoms swapped (e.g. a cyclohexane chair after a ring
+ * flip) or its mirror image is far from it that way, but has the
+ * same energy and the same set of distances between its atoms, so
+ * conformers that match on both count as the same too.
+ *
+ * @param structure the atoms
+ * @param a one conformer
+ * @param b the other
+ * @return whether they're duplicates
+ */
+static bool sameConformer(const vector<BondedElement> &structure, const Conformer &a, const Conformer &b) {
+	if(conformerDistance(structure, a.coordinates, b.coordinates) < CONFORMER_RMSD) {
+		return true;
+	}
+	return fabs(a.energy - b.energy) < CONFORMER_ENERGY_TOLERANCE && shapeDistance(structure, a.coordinates, b.coordinates) < CONFORMER_RMSD;
+}
+
+/**
+ * Check whether a conformer would join a set
+ * It has to be within CONFORMER_ENERGY_WINDOW of the lowest, low
+ * enough to make the cut, and lower than anything in the set it
+ * is a duplicate of.
+ *
+ * @param structure the atoms
+ * @param kept the set, lowest energy first
+ * @param conformer the new conformer
+ * @param limit the most conformers the set holds
+ * @return whether it would be kept
+ */
+static bool admits(const vector<BondedElement> &structure, const vector<Conformer> &kept, const Conformer &conformer, size_t limit) {
+	if(!kept.empty() && conformer.energy > kept[0].energy + CONFORMER_ENERGY_WINDOW) {
+		return false;
+	}
+	for(const Conformer &other : kept) {
+		if(sameConformer(structure, other, conformer)) {
+			return conformer.energy < other.energy;
+		}
+	}
+	return kept.size() < limit || conformer.energy < kept.back().energy;
+}
+
+/**
+ * Add a conformer that admits() accepts to a set, dropping its
+ * duplicates and whatever no longer makes the cut
+ *
+ * @param structure the atoms
+ * @param kept the set, lowest energy first
+ * @param conformer the new conformer
+ * @param limit the most conformers the set holds
+ */
+static void admit(const vector<BondedElement> &structure, vector<Conformer> &kept, Conformer &&conformer, size_t limit) {
+	kept.erase(remove_if(kept.begin(), kept.end(), [&](const Conformer &other) {
+		return sameConformer(structure, other, conformer);
+	}), kept.end());
+	auto at = upper_bound(kept.begin(), kept.end(), conformer.energy, [](double energy, const Conformer &other) {
+		return energy < other.energy;
+	});
+	kept.insert(at, std::move(conformer));
+	double ceiling = kept[0].energy + CONFORMER_ENERGY_WINDOW;
+	while(kept.size() > limit || kept.back().energy > ceiling) {
+		kept.pop_back();
+	}
+}
+
+/**
+ * Search for the low energy conformers of a structure
+ * Each candidate turns every rotatable bond to one of
+ * CONFORMER_TORSION_STEPS angles, every combination in turn or
+ * random ones when there are more than CONFORMER_CANDIDATES, and
+ * is nudged and relaxed with the van der Waals force field. Rings
+ * aren't turned, instead each combination is tried several times,
+ * from the template and from flattened rings puckered either way,
+ * so rings can settle into different puckers.
+ * Candidates are relaxed by threads started for this call and
+ * joined before it returns, each with its own pair list against the
+ * shared force field. Relaxed candidates too high in energy or the
+ * same as a lower one are dropped, and the stick positions are only
+ * fitted for the ones that are kept. The sink sees them as they're
+ * found, in whatever order the threads finish. Once every candidate
+ * is relaxed the set is picked again, lowest energy first and ties
+ * by candidate, so the result is the same for any number of threads.
+ *
+ * @param structure the atoms, with bonds and van der Waals positions filled in
+ * @param threads the number of threads to relax on, 0 for one per core
+ * @param limit the most conformers to keep
+ * @param sink if set, given the conformers found so far whenever they change
+ * @param cancelled if set, the search stops at the next candidate once it's true
+ *        and returns what it has kept so far
+ * @return the conformers kept, lowest energy first
+ */
+vector<Conformer> generateConformers(const vector<BondedElement> &structure, unsigned int threads, size_t limit, const ConformerSink &sink, const atomic<bool> *cancelled) {
+	vector<Conformer> kept;
+	if(structure.size() < 2 || limit == 0) {
+		return kept;
+	}
+	if(threads == 0) {
+		threads = max(1u, thread::hardware_concurrency());
+	}
+
+	vector<RotatableBond> rotatable = findRotatableBonds(structure);
+	size_t combinations = 1;
+	for(size_t r = 0; r < rotatable.size() && combinations <= CONFORMER_CANDIDATES; r++) {
+		combinations *= CONFORMER_TORSION_STEPS;
+	}
+	bool sampled = combinations > CONFORMER_CANDIDATES;
+
+	const ForceField field(structure, false);
+	const vector<double> start = readCoordinates(structure, false);
+	// Candidates with rings start from the template or from either pucker of flattened rings
+	BondGraph graph(structure);
+	vector<double> starts[3] = {start, start, start};
+	bool rings = flattenRings(graph, starts[1], CONFORMER_PUCKER) > 0;
+	flattenRings(graph, starts[2], -CONFORMER_PUCKER);
+	size_t candidates = combinations;
+	if(sampled) {
+		candidates = CONFORMER_CANDIDATES;
+	}
+	else if(rings) {
+		candidates = min<size_t>(combinations * CONFORMER_RING_SAMPLES, CONFORMER_CANDIDATES);
+	}
+
+	// Every relaxed candidate, each written by the one thread that took it
+	vector<Conformer> relaxed(candidates);
+	vector<uint8_t> done(candidates, 0);
+	mutex keptMutex;
+	atomic<size_t> next(0);
+	auto worker = [&]() {
+		NonbondedList pairs;
+		for(size_t i = next++; i < candidates; i = next++) {
+			if(cancelled != nullptr && cancelled->load()) {
+				break;
+			}
+			Conformer &conformer = relaxed[i];
+			conformer.coordinates = starts[rings ? i % 3 : 0];
+			minstd_rand random(i + 1);
+			uniform_int_distribution<int> pick(0, CONFORMER_TORSION_STEPS - 1);
+			size_t digits = (rings ? i / 3 : i) % combinations;
+			for(const RotatableBond &bond : rotatable) {
+				int step = sampled ? pick(random) : digits % CONFORMER_TORSION_STEPS;
+				digits /= CONFORMER_TORSION_STEPS;
+				turnBond(conformer.coordinates, bond, 2 * M_PI * step / CONFORMER_TORSION_STEPS);
+			}
+			uniform_real_distribution<double> nudge(-CONFORMER_JITTER, CONFORMER_JITTER);
+			for(double &c : conformer.coordinates) {
+				c += nudge(random);
+			}
+			conformer.energy = minimizeEnergy(field, conformer.coordinates, pairs).energy;
+			done[i] = 1;
+
+			{
+				lock_guard<mutex> lock(keptMutex);
+				if(!admits(structure, kept, conformer, limit)) {
+					continue;
+				}
+			}
+			conformer.structure = structure;
+			writeCoordinates(conformer.coordinates, conformer.structure, false);
+			relaxSticks(conformer.structure);
+
+			lock_guard<mutex> lock(keptMutex);
+			if(admits(structure, kept, conformer, limit)) {
+				admit(structure, kept, Conformer(conformer), limit);
+				if(sink) {
+					sink(kept);
+				}
+			}
+		}
+	};
+
+	unsigned int poolSize = min<size_t>(threads, candidates);
+	vector<thread> pool;
+	pool.reserve(poolSize);
+	for(unsigned int t = 1; t < poolSize; t++) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for(thread &t : pool) {
+		t.join();
+	}
+	if(cancelled != nullptr && cancelled->load()) {
+		return kept;
+	}
+
+	vector<size_t> order;
+	for(size_t i = 0; i < candidates; i++) {
+		if(done[i]) {
+			order.push_back(i);
+		}
+	}
+	stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return relaxed[a].energy < relaxed[b].energy;
+	});
+	vector<Conformer> chosen;
+	for(size_t i : order) {
+		Conformer &conformer = relaxed[i];
+		if(!admits(structure, chosen, conformer, limit)) {
+			continue;
+		}
+		if(conformer.structure.empty()) {
+			conformer.structure = structure;
+			writeCoordinates(conformer.coordinates, conformer.structure, false);
+			relaxSticks(conformer.structure);
+		}
+		admit(structure, chosen, std::move(conformer), limit);
+	}
+	if(sink) {
+		sink(chosen);
+	}
+	return chosen;
+}
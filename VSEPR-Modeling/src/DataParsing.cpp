@@ -14,11 +14,35 @@ vector<string> csvStringToVector(string rawLine);
 int stoiSafe(string s);
 float stofSafe(string s);
 
-extern std::map<std::string, Element> elements;
+Element elementTable[ELEMENT_TABLE_SIZE];
+uint8_t symbolTable[SYMBOL_TABLE_SIZE];
+
+/**
+ * Perfect hash of an element symbol
+ * Symbols are one capital letter optionally followed by
+ * one lowercase letter, so every possible symbol gets its own slot
+ * 
+ * @param symbol the element's symbol
+ * @return the slot in symbolTable, -1 if it isn't shaped like a symbol
+ */
+int symbolHash(std::string_view symbol) {
+    if(symbol.empty() || symbol.length() > 2 || !isupper(symbol[0])) {
+        return -1;
+    }
+    int hash = (symbol[0] - 'A') * 27;
+    if(symbol.length() == 2) {
+        if(!islower(symbol[1])) {
+            return -1;
+        }
+        hash += symbol[1] - 'a' + 1;
+    }
+    return hash;
+}
 
 /**
  * Read periodic table data from the csv file
- * Data is stored in the global elements list
+ * Data is stored in the global element table, indexed by
+ * atomic number, and symbols are indexed in symbolTable
  * 
  * @param path the path to the file
  */
@@ -134,12 +158,18 @@ void parseCSV(std::string path)
             newElement.exception = true;
         }
 
-        elements.insert(pair<string, Element>(shortHand, newElement));
+        int hash = symbolHash(shortHand);
+        if(atomicNumber <= LONE_PAIR || atomicNumber >= ELEMENT_TABLE_SIZE || hash < 0) {
+            continue;
+        }
+        elementTable[atomicNumber] = newElement;
+        symbolTable[hash] = atomicNumber;
     }
 
     Element lonePair;
+    lonePair.atomicNumber = LONE_PAIR;
     lonePair.name = "Lone pair";
-    elements.insert(pair<string, Element>("LP", lonePair));
+    elementTable[LONE_PAIR] = lonePair;
 }
 
 /**
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include "VSEPR.h"
+#include "domains.h"
+
+using namespace std;
+
+#define COS_72 0.30901699437494742410
+#define SIN_72 0.95105651629515357212
+#define COS_144 -0.80901699437494742410
+#define SIN_144 0.58778525229247312917
+// 1/sqrt(3) and sqrt(2/3), the tetrahedron's coordinates
+#define TETRAHEDRAL_Y 0.57735026918962576451
+#define TETRAHEDRAL_XZ 0.81649658092772603273
+
+/**
+ * The directions of one electron domain count and the order
+ * bonded neighbours fill them in, lone pairs taking the rest
+ */
+struct DomainArrangement {
+	int count;
+	double directions[MAX_DOMAINS][3];
+	int fillOrder[MAX_DOMAINS];
+};
+
+static constexpr DomainArrangement arrangements[MAX_DOMAINS + 1] = {
+	{0, {}, {}},
+	{1, {{1, 0, 0}}, {0}},
+	{2, {{1, 0, 0}, {-1, 0, 0}}, {0, 1}},
+	{3, {{COS_30, -SIN_30, 0}, {-COS_30, -SIN_30, 0}, {0, 1, 0}}, {0, 1, 2}},
+	{4, {{TETRAHEDRAL_XZ, -TETRAHEDRAL_Y, 0}, {-TETRAHEDRAL_XZ, -TETRAHEDRAL_Y, 0}, {0, TETRAHEDRAL_Y, -TETRAHEDRAL_XZ}, {0, TETRAHEDRAL_Y, TETRAHEDRAL_XZ}}, {0, 1, 2, 3}},
+	// Axial first, so lone pairs are equatorial
+	{5, {{0, 0, -1}, {-COS_30, 0, SIN_30}, {0, -1, 0}, {COS_30, 0, SIN_30}, {0, 1, 0}}, {2, 4, 0, 1, 3}},
+	// Opposite corners of the square first, so two bonds are linear and lone pairs trans
+	{6, {{SIN_45, 0, -SIN_45}, {SIN_45, 0, SIN_45}, {-SIN_45, 0, SIN_45}, {-SIN_45, 0, -SIN_45}, {0, 1, 0}, {0, -1, 0}}, {0, 2, 1, 3, 4, 5}},
+	// The pentagon first, so lone pairs are axial
+	{7, {{1, 0, 0}, {COS_72, 0, SIN_72}, {COS_144, 0, SIN_144}, {COS_144, 0, -SIN_144}, {COS_72, 0, -SIN_72}, {0, 1, 0}, {0, -1, 0}}, {0, 1, 2, 3, 4, 5, 6}},
+};
+
+/**
+ * Square root usable in constant expressions (Newton's method)
+ *
+ * @param x the number, at least 0
+ * @return its square root
+ */
+static constexpr double constexprSqrt(double x) {
+	if(x <= 0) {
+		return 0;
+	}
+	double root = x > 1 ? x : 1;
+	for(int i = 0; i < 64; i++) {
+		root = 0.5 * (root + x / root);
+	}
+	return root;
+}
+
+/**
+ * Every arrangement for every split of domains into bonds and
+ * lone pairs, built at compile time
+ */
+struct DomainGeometryTable {
+	DomainGeometry entries[MAX_DOMAINS + 1][MAX_DOMAINS + 1];
+
+	constexpr DomainGeometryTable() : entries() {
+		for(int bonding = 0; bonding <= MAX_DOMAINS; bonding++) {
+			for(int lone = 0; bonding + lone <= MAX_DOMAINS; lone++) {
+				if(bonding + lone > 0) {
+					fill(entries[bonding][lone], arrangements[bonding + lone]);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Set an entry's directions and the rotations onto them
+	 * The rotation turns +y onto the direction about their cross
+	 * product, or half a turn about -x for -y (see RotationBetweenVectors)
+	 *
+	 * @param entry the entry
+	 * @param arrangement its domain count's directions
+	 */
+	static constexpr void fill(DomainGeometry &entry, const DomainArrangement &arrangement) {
+		entry.domains = arrangement.count;
+		for(int slot = 0; slot < arrangement.count; slot++) {
+			const double *d = arrangement.directions[arrangement.fillOrder[slot]];
+			double length = constexprSqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+			double x = d[0] / length, y = d[1] / length, z = d[2] / length;
+			entry.directions[slot][0] = x;
+			entry.directions[slot][1] = y;
+			entry.directions[slot][2] = z;
+
+			double qw = 0, qx = -1, qy = 0, qz = 0;
+			if(y > -1 + 0.001) {
+				double s = constexprSqrt((1 + y) * 2);
+				qw = s * 0.5;
+				qx = z / s;
+				qz = -x / s;
+			}
+			entry.frames[slot][0] = qw;
+			entry.frames[slot][1] = qx;
+			entry.frames[slot][2] = qy;
+			entry.frames[slot][3] = qz;
+
+			float *m = entry.cylinders[slot];
+			m[0] = 1 - 2*(qy*qy + qz*qz);
+			m[1] = 2*(qx*qy + qw*qz);
+			m[2] = 2*(qx*qz - qw*qy);
+			m[4] = 2*(qx*qy - qw*qz);
+			m[5] = 1 - 2*(qx*qx + qz*qz);
+			m[6] = 2*(qy*qz + qw*qx);
+			m[8] = 2*(qx*qz + qw*qy);
+			m[9] = 2*(qy*qz - qw*qx);
+			m[10] = 1 - 2*(qx*qx + qy*qy);
+			m[15] = 1;
+		}
+	}
+};
+
+static constexpr DomainGeometryTable domainGeometryTable;
+
+/**
+ * Look up the arrangement of an atom's electron domains
+ * Atoms with more than MAX_DOMAINS domains are given fewer lone pairs
+ *
+ * @param bonding the number of bonded neighbours
+ * @param lonePairs the number of lone pairs
+ * @return the arrangement, null if there are no domains or too many bonds
+ */
+const DomainGeometry *domainGeometry(int bonding, int lonePairs) {
+	if(bonding < 0 || bonding > MAX_DOMAINS) {
+		return nullptr;
+	}
+	lonePairs = max(0, min(lonePairs, MAX_DOMAINS - bonding));
+	if(bonding + lonePairs == 0) {
+		return nullptr;
+	}
+	return &domainGeometryTable.entries[bonding][lonePairs];
+}
@@ -0,0 +1,121 @@
+#include <vector>
+#include <algorithm>
+#include "VSEPR.h"
+#include "context.h"
+#include "geometry.h"
+#include "domains.h"
+#include "molecule.h"
+#include "resonance.h"
+#include "glm/gtx/quaternion.hpp"
+
+using namespace std;
+
+/**
+ * Place every atom of a structure with an arbitrary bond graph
+ * Each connected part is walked breadth first from its first atom.
+ * An atom's neighbours and lone pairs take the directions of the
+ * configuration for its number of electron domains, turned so the
+ * atom it was reached from lies along the first direction. Bonds that
+ * close rings are left at whatever length the walk gives them.
+ * Disconnected parts are laid out side by side along x.
+ *
+ * @param structure the atoms, with bonds and electron counts filled in
+ */
+void embedStructure(vector<BondedElement> &structure) {
+	BondGraph graph(structure);
+	size_t n = structure.size();
+
+	vector<int> parent(n, -1);
+	vector<uint8_t> placed(n, 0);
+	vector<glm::quat> frames(n, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	vector<uint32_t> queue;
+	queue.reserve(n);
+
+	float extent = 0.0f;
+	float extent_v = 0.0f;
+	for(size_t root = 0; root < n; root++) {
+		if(placed[root]) {
+			continue;
+		}
+		size_t componentStart = queue.size();
+		structure[root].position = glm::vec3(0.0f);
+		structure[root].vanDerWaalsPosition = glm::vec3(0.0f);
+		placed[root] = 1;
+		queue.push_back(root);
+
+		for(size_t head = componentStart; head < queue.size(); head++) {
+			uint32_t atom = queue[head];
+			const BondedElement &current = structure[atom];
+			int degree = graph.degree(atom);
+			const DomainGeometry *geometry = domainGeometry(degree, current.loneElectrons / 2);
+			if(geometry == nullptr) {
+				continue;
+			}
+
+			int slot = 0;
+			if(parent[atom] >= 0) {
+				glm::vec3 toParent = glm::normalize(structure[parent[atom]].position - current.position);
+				frames[atom] = glm::rotation(geometry->direction(0), toParent);
+				slot = 1;
+			}
+
+			for(int k = 0; k < degree; k++) {
+				uint32_t other = graph.neighboursBegin(atom)[k];
+				if((int)other == parent[atom]) {
+					continue;
+				}
+				int neighbourSlot = slot++;
+				if(placed[other]) {
+					continue;
+				}
+
+				BondedElement &child = structure[other];
+				glm::vec3 dir = frames[atom] * geometry->direction(neighbourSlot);
+				float stickLength = (child.elementId == HYDROGEN || current.elementId == HYDROGEN) ? 0.7f : 1.0f;
+				child.position = current.position + dir * getStickDistance() * stickLength;
+				child.vanDerWaalsPosition = current.vanDerWaalsPosition + dir * getSphereDistance(child, current, graph.order(atom, k));
+				parent[other] = atom;
+				placed[other] = 1;
+				queue.push_back(other);
+			}
+		}
+
+		// Line disconnected parts up next to each other
+		float low = 0.0f, high = 0.0f, low_v = 0.0f, high_v = 0.0f;
+		for(size_t q = componentStart; q < queue.size(); q++) {
+			const BondedElement &e = structure[queue[q]];
+			low = min(low, e.position.x);
+			high = max(high, e.position.x);
+			low_v = min(low_v, e.vanDerWaalsPosition.x);
+			high_v = max(high_v, e.vanDerWaalsPosition.x);
+		}
+		if(componentStart > 0) {
+			float shift = extent + getStickDistance() - low;
+			float shift_v = extent_v + getStickDistance() - low_v;
+			for(size_t q = componentStart; q < queue.size(); q++) {
+				structure[queue[q]].position.x += shift;
+				structure[queue[q]].vanDerWaalsPosition.x += shift_v;
+			}
+			high += shift;
+			high_v += shift_v;
+		}
+		extent = high;
+		extent_v = high_v;
+	}
+}
+
+/**
+ * Place a bonded structure with an arbitrary bond graph and fill in
+ * everything drawn from it: the atoms are embedded and centred,
+ * bonds that differ between resonance contributors are averaged
+ * and the cylinders are generated
+ *
+ * @param structure the atoms, with bonds and electron counts filled in
+ * @param threads the threads resonance is enumerated on, 0 for one per core
+ */
+void placeStructure(vector<BondedElement> &structure, unsigned int threads) {
+	embedStructure(structure);
+	averageCenterPositions(structure);
+	averageResonance(structure, threads);
+	generateCylinders(structure);
+}
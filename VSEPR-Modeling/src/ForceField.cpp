@@ -0,0 +1,690 @@
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <random>
+#include "VSEPR.h"
+#include "forcefield.h"
+#include "domains.h"
+#include "geometry.h"
+#include "molecule.h"
+
+using namespace std;
+
+/**
+ * Get how much longer bonds are in the ball-and-stick model than
+ * in reality, taking a carbon-carbon single bond as the reference
+ *
+ * @return the stick length per A
+ */
+static double stickScale() {
+	return getStickDistance() / (2 * elementTable[CARBON].covalentRadii[0] / 100);
+}
+
+/**
+ * Get the covalent radius of an element for a bond order
+ * Orders between whole numbers (averaged resonance) interpolate
+ * between the radii on either side
+ *
+ * @param e the element
+ * @param order the bond order
+ * @return the radius in A
+ */
+static double covalentRadius(const Element &e, float order) {
+	auto radius = [&e](int whole) {
+		whole = max(1, min(3, whole));
+		return e.covalentRadii[whole - 1] > 0 ? e.covalentRadii[whole - 1] : e.covalentRadii[0];
+	};
+	int low = (int)floor(order);
+	float fraction = order - low;
+	return (radius(low) * (1 - fraction) + radius(low + 1) * fraction) / 100;
+}
+
+/**
+ * Get the position of an atom from a flat coordinate array
+ *
+ * @param coordinates x, y and z of each atom in turn
+ * @param atom the atom's index
+ * @return the position
+ */
+static glm::dvec3 atomAt(const double *coordinates, uint32_t atom) {
+	return glm::dvec3(coordinates[3*atom], coordinates[3*atom + 1], coordinates[3*atom + 2]);
+}
+
+/**
+ * Add to the gradient of one atom
+ *
+ * @param gradient the flat gradient array
+ * @param atom the atom's index
+ * @param delta the amount to add
+ */
+static void addGradient(double *gradient, uint32_t atom, glm::dvec3 delta) {
+	gradient[3*atom] += delta.x;
+	gradient[3*atom + 1] += delta.y;
+	gradient[3*atom + 2] += delta.z;
+}
+
+/**
+ * Build the energy model of a structure from its current geometry
+ *
+ * @param structure the atoms, with bonds and positions filled in
+ * @param sticks whether to model the ball-and-stick positions
+ *               instead of the van der Waals ones
+ */
+ForceField::ForceField(const vector<BondedElement> &structure, bool sticks) {
+	BondGraph graph(structure);
+	atoms = structure.size();
+	lengthScale = sticks ? stickScale() : 1.0;
+	vector<double> start = readCoordinates(structure, sticks);
+
+	for(const BondEdge &edge : graph.edges) {
+		const BondedElement &a = structure[edge.a];
+		const BondedElement &b = structure[edge.b];
+		double rest;
+		if(sticks) {
+			// As long as the sticks are drawn
+			rest = getStickDistance() * (a.elementId == HYDROGEN || b.elementId == HYDROGEN ? 0.7 : 1.0);
+		}
+		else {
+			float order = edge.order;
+			for(const Bond &bond : a.bonds) {
+				if(bond.uid == b.getUID() && bond.averageOrder > 0) {
+					order = bond.averageOrder;
+				}
+			}
+			rest = covalentRadius(a.base(), order) + covalentRadius(b.base(), order);
+		}
+		bonds.push_back(BondTerm{edge.a, edge.b, rest, FORCE_FIELD_BOND_K / (lengthScale * lengthScale)});
+	}
+
+	// Each pair of neighbours bends towards the closest angle of the atom's arrangement
+	vector<int> domains(atoms, 0);
+	for(uint32_t centre = 0; centre < atoms; centre++) {
+		int degree = graph.degree(centre);
+		const DomainGeometry *geometry = domainGeometry(degree, structure[centre].loneElectrons / 2);
+		if(geometry == nullptr) {
+			continue;
+		}
+		domains[centre] = geometry->domains;
+		if(degree < 2) {
+			continue;
+		}
+
+		double restAngles[MAX_DOMAINS * MAX_DOMAINS];
+		int restCount = 0;
+		for(int s = 0; s < geometry->domains; s++) {
+			for(int t = s + 1; t < geometry->domains; t++) {
+				restAngles[restCount++] = glm::dot(geometry->direction(s), geometry->direction(t));
+			}
+		}
+
+		const uint32_t *neighbours = graph.neighboursBegin(centre);
+		glm::dvec3 origin = atomAt(start.data(), centre);
+		for(int i = 0; i < degree; i++) {
+			for(int j = i + 1; j < degree; j++) {
+				glm::dvec3 u = atomAt(start.data(), neighbours[i]) - origin;
+				glm::dvec3 v = atomAt(start.data(), neighbours[j]) - origin;
+				double lengths = glm::length(u) * glm::length(v);
+				double current = lengths > 0 ? glm::dot(u, v) / lengths : restAngles[0];
+				double cosRest = restAngles[0];
+				for(int r = 1; r < restCount; r++) {
+					if(fabs(restAngles[r] - current) < fabs(cosRest - current)) {
+						cosRest = restAngles[r];
+					}
+				}
+				angles.push_back(AngleTerm{neighbours[i], centre, neighbours[j], cosRest, FORCE_FIELD_ANGLE_K});
+			}
+		}
+	}
+
+	// Torsions about bonds between sp3 and sp2 atoms, sharing the bond's barrier
+	for(const BondEdge &edge : graph.edges) {
+		int degreeB = graph.degree(edge.a);
+		int degreeC = graph.degree(edge.b);
+		int hybridB = domains[edge.a];
+		int hybridC = domains[edge.b];
+		if(degreeB < 2 || degreeC < 2 || hybridB < 3 || hybridC < 3 || hybridB > 4 || hybridC > 4) {
+			continue;
+		}
+
+		double barrier;
+		int periodicity;
+		int phase;
+		if(hybridB == 4 && hybridC == 4) {
+			barrier = FORCE_FIELD_TORSION_SP3;
+			periodicity = 3;
+			phase = -1;
+		}
+		else if(hybridB == 3 && hybridC == 3) {
+			barrier = edge.order > 1 || edge.resonance ? FORCE_FIELD_TORSION_SP2 : FORCE_FIELD_TORSION_CONJUGATED;
+			periodicity = 2;
+			phase = 1;
+		}
+		else {
+			barrier = FORCE_FIELD_TORSION_MIXED;
+			periodicity = 6;
+			phase = 1;
+		}
+
+		size_t first = torsions.size();
+		for(const uint32_t *a = graph.neighboursBegin(edge.a); a != graph.neighboursEnd(edge.a); a++) {
+			for(const uint32_t *d = graph.neighboursBegin(edge.b); d != graph.neighboursEnd(edge.b); d++) {
+				if(*a != edge.b && *d != edge.a && *a != *d) {
+					torsions.push_back(TorsionTerm{*a, edge.a, edge.b, *d, barrier, periodicity, phase});
+				}
+			}
+		}
+		for(size_t t = first; t < torsions.size(); t++) {
+			torsions[t].barrier /= torsions.size() - first;
+		}
+	}
+
+	contact.resize(atoms);
+	for(uint32_t i = 0; i < atoms; i++) {
+		float radius = structure[i].base().vanDerWaalsRadius;
+		contact[i] = (radius > 0 ? radius : 1.7) * lengthScale;
+	}
+
+	excludedOffsets.reserve(atoms + 1);
+	excludedOffsets.push_back(0);
+	for(uint32_t i = 0; i < atoms; i++) {
+		size_t first = excluded.size();
+		for(const uint32_t *j = graph.neighboursBegin(i); j != graph.neighboursEnd(i); j++) {
+			excluded.push_back(*j);
+			for(const uint32_t *k = graph.neighboursBegin(*j); k != graph.neighboursEnd(*j); k++) {
+				if(*k != i) {
+					excluded.push_back(*k);
+				}
+			}
+		}
+		sort(excluded.begin() + first, excluded.end());
+		excluded.erase(unique(excluded.begin() + first, excluded.end()), excluded.end());
+		excludedOffsets.push_back(excluded.size());
+	}
+}
+
+/**
+ * List the van der Waals pairs within reach of each other
+ * Candidates come from the list's cell grid, which is only
+ * updated for atoms that changed cell after the first build
+ *
+ * @param coordinates x, y and z of each atom in turn
+ * @param pairs the list to fill, replacing what it held
+ */
+void ForceField::buildPairs(const double *coordinates, NonbondedList &pairs) const {
+	pairs.first.clear();
+	pairs.second.clear();
+	pairs.contact2.clear();
+	pairs.built.assign(coordinates, coordinates + 3 * atoms);
+	if(atoms == 0) {
+		return;
+	}
+	double skin = FORCE_FIELD_PAIR_SKIN * lengthScale;
+	double widest = *max_element(contact.begin(), contact.end());
+	float reach = 2 * widest * FORCE_FIELD_VDW_CUTOFF + skin;
+
+	vector<glm::vec3> positions(atoms);
+	for(size_t i = 0; i < atoms; i++) {
+		positions[i] = atomAt(coordinates, i);
+	}
+	if(pairs.cells.size() != atoms || pairs.cells.cellSize != reach) {
+		pairs.cells.build(positions.data(), atoms, reach);
+	}
+	else {
+		pairs.cells.update(positions.data());
+	}
+
+	vector<uint32_t> mark(atoms, UINT_MAX);
+	uint32_t current = UINT_MAX;
+	pairs.cells.forEachPair(reach, [&](uint32_t i, uint32_t j, float distance2) {
+		if(i != current) {
+			current = i;
+			for(uint32_t e = excludedOffsets[i]; e < excludedOffsets[i + 1]; e++) {
+				mark[excluded[e]] = i;
+			}
+		}
+		if(mark[j] == i) {
+			return;
+		}
+		double distance = contact[i] + contact[j];
+		double pairReach = distance * FORCE_FIELD_VDW_CUTOFF + skin;
+		if(distance2 < pairReach * pairReach) {
+			pairs.first.push_back(i);
+			pairs.second.push_back(j);
+			pairs.contact2.push_back(distance * distance);
+		}
+	});
+}
+
+/**
+ * Stretch energy of the bonds, k (r - r0)^2
+ *
+ * @param bonds the bond terms
+ * @param x the coordinates
+ * @param gradient the gradient to add to
+ * @return the energy
+ */
+static double bondEnergy(const vector<BondTerm> &bonds, const double *x, double *gradient) {
+	double energy = 0;
+	for(const BondTerm &bond : bonds) {
+		glm::dvec3 d = atomAt(x, bond.a) - atomAt(x, bond.b);
+		double length = glm::length(d);
+		double stretch = length - bond.rest;
+		energy += bond.k * stretch * stretch;
+		if(length > 0) {
+			glm::dvec3 force = d * (2 * bond.k * stretch / length);
+			addGradient(gradient, bond.a, force);
+			addGradient(gradient, bond.b, -force);
+		}
+	}
+	return energy;
+}
+
+/**
+ * Bend energy of the angles, k (cos t - cos t0)^2
+ *
+ * @param angles the angle terms
+ * @param x the coordinates
+ * @param gradient the gradient to add to
+ * @return the energy
+ */
+static double angleEnergy(const vector<AngleTerm> &angles, const double *x, double *gradient) {
+	double energy = 0;
+	for(const AngleTerm &angle : angles) {
+		glm::dvec3 centre = atomAt(x, angle.centre);
+		glm::dvec3 u = atomAt(x, angle.a) - centre;
+		glm::dvec3 v = atomAt(x, angle.b) - centre;
+		double lu2 = glm::dot(u, u);
+		double lv2 = glm::dot(v, v);
+		if(lu2 <= 0 || lv2 <= 0) {
+			continue;
+		}
+		double inverse = 1 / sqrt(lu2 * lv2);
+		double cosine = glm::dot(u, v) * inverse;
+		double bend = cosine - angle.cosRest;
+		energy += angle.k * bend * bend;
+
+		double scale = 2 * angle.k * bend;
+		glm::dvec3 gradientA = (v * inverse - u * (cosine / lu2)) * scale;
+		glm::dvec3 gradientB = (u * inverse - v * (cosine / lv2)) * scale;
+		addGradient(gradient, angle.a, gradientA);
+		addGradient(gradient, angle.b, gradientB);
+		addGradient(gradient, angle.centre, -(gradientA + gradientB));
+	}
+	return energy;
+}
+
+/**
+ * Torsion energy, barrier/2 (1 - phase cos(n phi))
+ * Derivatives of phi from Blondel and Karplus, J. Comput. Chem. 17 (1996)
+ *
+ * @param torsions the torsion terms
+ * @param x the coordinates
+ * @param gradient the gradient to add to
+ * @return the energy
+ */
+static double torsionEnergy(const vector<TorsionTerm> &torsions, const double *x, double *gradient) {
+	double energy = 0;
+	for(const TorsionTerm &torsion : torsions) {
+		glm::dvec3 f = atomAt(x, torsion.a) - atomAt(x, torsion.b);
+		glm::dvec3 g = atomAt(x, torsion.b) - atomAt(x, torsion.c);
+		glm::dvec3 h = atomAt(x, torsion.d) - atomAt(x, torsion.c);
+		glm::dvec3 a = glm::cross(f, g);
+		glm::dvec3 b = glm::cross(h, g);
+		double a2 = glm::dot(a, a);
+		double b2 = glm::dot(b, b);
+		double lg = glm::length(g);
+		if(a2 < 1e-12 || b2 < 1e-12 || lg < 1e-12) {
+			continue;
+		}
+		double phi = atan2(glm::dot(glm::cross(b, a), g) / lg, glm::dot(a, b));
+		int n = torsion.periodicity;
+		energy += torsion.barrier / 2 * (1 - torsion.phase * cos(n * phi));
+		double dPhi = torsion.barrier / 2 * torsion.phase * n * sin(n * phi);
+
+		glm::dvec3 gradientA = a * (-lg / a2);
+		glm::dvec3 gradientD = b * (lg / b2);
+		double fg = glm::dot(f, g) / (a2 * lg);
+		double hg = glm::dot(h, g) / (b2 * lg);
+		glm::dvec3 gradientB = -gradientA + a * fg - b * hg;
+		glm::dvec3 gradientC = -gradientD - a * fg + b * hg;
+		addGradient(gradient, torsion.a, gradientA * dPhi);
+		addGradient(gradient, torsion.b, gradientB * dPhi);
+		addGradient(gradient, torsion.c, gradientC * dPhi);
+		addGradient(gradient, torsion.d, gradientD * dPhi);
+	}
+	return energy;
+}
+
+/**
+ * Lennard-Jones energy of the listed pairs, eps((r0/r)^12 - 2(r0/r)^6),
+ * shifted to 0 at the cutoff
+ * Pairs are gathered FORCE_FIELD_LANES at a time into plain arrays
+ * and worked through without branches or square roots. The middle
+ * loop is marked omp simd and runs in vector registers when built
+ * with the Makefile's KERNEL_FLAGS; other builds run it lane by lane.
+ *
+ * @param pairs the pair list
+ * @param x the coordinates
+ * @param gradient the gradient to add to
+ * @return the energy
+ */
+static double nonbondedEnergy(const NonbondedList &pairs, const double *x, double *gradient) {
+	const double cutoff2 = FORCE_FIELD_VDW_CUTOFF * FORCE_FIELD_VDW_CUTOFF;
+	const double inner2 = FORCE_FIELD_VDW_INNER * FORCE_FIELD_VDW_INNER;
+	const double cutoffQ3 = 1 / (cutoff2 * cutoff2 * cutoff2);
+	const double shift = FORCE_FIELD_VDW_WELL * (cutoffQ3 * cutoffQ3 - 2 * cutoffQ3);
+
+	double energy = 0;
+	size_t count = pairs.size();
+	for(size_t p = 0; p < count; p += FORCE_FIELD_LANES) {
+		size_t lanes = min((size_t)FORCE_FIELD_LANES, count - p);
+		double dx[FORCE_FIELD_LANES], dy[FORCE_FIELD_LANES], dz[FORCE_FIELD_LANES];
+		double r2[FORCE_FIELD_LANES], contact2[FORCE_FIELD_LANES];
+		double laneEnergy[FORCE_FIELD_LANES], slope[FORCE_FIELD_LANES];
+		for(size_t l = 0; l < FORCE_FIELD_LANES; l++) {
+			if(l < lanes) {
+				const double *a = x + 3 * pairs.first[p + l];
+				const double *b = x + 3 * pairs.second[p + l];
+				dx[l] = a[0] - b[0];
+				dy[l] = a[1] - b[1];
+				dz[l] = a[2] - b[2];
+				contact2[l] = pairs.contact2[p + l];
+			}
+			else {
+				dx[l] = dy[l] = dz[l] = 1;
+				contact2[l] = 0;
+			}
+		}
+
+#pragma omp simd
+		for(size_t l = 0; l < FORCE_FIELD_LANES; l++) {
+			r2[l] = dx[l]*dx[l] + dy[l]*dy[l] + dz[l]*dz[l];
+			double inner = contact2[l] * inner2;
+			double clamped = r2[l] > inner ? r2[l] : inner;
+			double q = contact2[l] / clamped;
+			double q3 = q * q * q;
+			double dEdr2 = FORCE_FIELD_VDW_WELL * 6 * (q3 - q3 * q3) / clamped;
+			double e = FORCE_FIELD_VDW_WELL * (q3 * q3 - 2 * q3) - shift + dEdr2 * (r2[l] - clamped);
+			bool within = r2[l] < contact2[l] * cutoff2;
+			laneEnergy[l] = within ? e : 0.0;
+			slope[l] = within ? 2 * dEdr2 : 0.0;
+		}
+
+		for(size_t l = 0; l < lanes; l++) {
+			energy += laneEnergy[l];
+			double *a = gradient + 3 * pairs.first[p + l];
+			double *b = gradient + 3 * pairs.second[p + l];
+			a[0] += slope[l] * dx[l];
+			a[1] += slope[l] * dy[l];
+			a[2] += slope[l] * dz[l];
+			b[0] -= slope[l] * dx[l];
+			b[1] -= slope[l] * dy[l];
+			b[2] -= slope[l] * dz[l];
+		}
+	}
+	return energy;
+}
+
+/**
+ * Get the energy of a geometry and its gradient
+ * The pair list is rebuilt first if an atom has moved far enough
+ * since it was built that a pair could have come within the cutoff
+ *
+ * @param coordinates x, y and z of each atom in turn
+ * @param gradient where to write the gradient, the same size
+ * @param pairs the pair list to use and keep up to date
+ * @return the energy in kcal/mol
+ */
+double ForceField::evaluate(const double *coordinates, double *gradient, NonbondedList &pairs) const {
+	bool rebuild = pairs.built.size() != 3 * atoms;
+	double halfSkin = FORCE_FIELD_PAIR_SKIN * lengthScale / 2;
+	for(size_t i = 0; i < atoms && !rebuild; i++) {
+		double dx = coordinates[3*i] - pairs.built[3*i];
+		double dy = coordinates[3*i + 1] - pairs.built[3*i + 1];
+		double dz = coordinates[3*i + 2] - pairs.built[3*i + 2];
+		rebuild = dx*dx + dy*dy + dz*dz > halfSkin * halfSkin;
+	}
+	if(rebuild) {
+		buildPairs(coordinates, pairs);
+	}
+
+	fill(gradient, gradient + 3 * atoms, 0.0);
+	double energy = bondEnergy(bonds, coordinates, gradient);
+	energy += angleEnergy(angles, coordinates, gradient);
+	energy += torsionEnergy(torsions, coordinates, gradient);
+	energy += nonbondedEnergy(pairs, coordinates, gradient);
+	return energy;
+}
+
+/**
+ * Get the dot product of two vectors of the same size
+ *
+ * @param a the first vector
+ * @param b the second vector
+ * @return the dot product
+ */
+static double dot(const vector<double> &a, const vector<double> &b) {
+	double sum = 0;
+	for(size_t i = 0; i < a.size(); i++) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+/**
+ * Relax a geometry to the nearest energy minimum with L-BFGS
+ * Each step backtracks until the energy drops enough (Armijo) and
+ * no atom moves further than FORCE_FIELD_MAX_STEP. The history is
+ * dropped whenever it stops giving a downhill direction.
+ *
+ * @param field the energy model
+ * @param coordinates the starting geometry, replaced by the relaxed one
+ * @param pairs the pair list to evaluate with, kept by threads that
+ *              minimize many geometries so its storage is reused
+ * @param maxIterations the most steps to take
+ * @return the final energy and whether the gradient tolerance was reached
+ */
+MinimizeResult minimizeEnergy(const ForceField &field, vector<double> &coordinates, NonbondedList &pairs, int maxIterations) {
+	MinimizeResult result;
+	size_t n = coordinates.size();
+	if(n == 0) {
+		return result;
+	}
+	pairs.built.clear();
+	vector<double> gradient(n), direction(n), trial(n), trialGradient(n);
+	vector<vector<double>> s(FORCE_FIELD_HISTORY, vector<double>(n));
+	vector<vector<double>> y(FORCE_FIELD_HISTORY, vector<double>(n));
+	double rho[FORCE_FIELD_HISTORY];
+	double alpha[FORCE_FIELD_HISTORY];
+	int stored = 0;
+	int newest = -1;
+	double maxStep = FORCE_FIELD_MAX_STEP * field.lengthScale;
+	double tolerance = FORCE_FIELD_GRADIENT_TOLERANCE / field.lengthScale;
+
+	double energy = field.evaluate(coordinates.data(), gradient.data(), pairs);
+	for(; result.iterations < maxIterations; result.iterations++) {
+		if(dot(gradient, gradient) < tolerance * tolerance * n) {
+			result.converged = true;
+			break;
+		}
+
+		// Two loop recursion for the quasi-Newton direction
+		for(size_t i = 0; i < n; i++) {
+			direction[i] = -gradient[i];
+		}
+		for(int k = 0; k < stored; k++) {
+			int slot = (newest - k + FORCE_FIELD_HISTORY) % FORCE_FIELD_HISTORY;
+			alpha[slot] = rho[slot] * dot(s[slot], direction);
+			for(size_t i = 0; i < n; i++) {
+				direction[i] -= alpha[slot] * y[slot][i];
+			}
+		}
+		if(stored > 0) {
+			double gamma = dot(s[newest], y[newest]) / dot(y[newest], y[newest]);
+			for(double &d : direction) {
+				d *= gamma;
+			}
+		}
+		for(int k = stored - 1; k >= 0; k--) {
+			int slot = (newest - k + FORCE_FIELD_HISTORY) % FORCE_FIELD_HISTORY;
+			double beta = rho[slot] * dot(y[slot], direction);
+			for(size_t i = 0; i < n; i++) {
+				direction[i] += (alpha[slot] - beta) * s[slot][i];
+			}
+		}
+		double slope = dot(direction, gradient);
+		if(slope >= 0) {
+			stored = 0;
+			for(size_t i = 0; i < n; i++) {
+				direction[i] = -gradient[i];
+			}
+			slope = dot(direction, gradient);
+		}
+
+		double step = 1.0;
+		for(size_t i = 0; i < n; i += 3) {
+			double move = sqrt(direction[i]*direction[i] + direction[i+1]*direction[i+1] + direction[i+2]*direction[i+2]);
+			if(move * step > maxStep) {
+				step = maxStep / move;
+			}
+		}
+
+		double trialEnergy = energy;
+		bool accepted = false;
+		for(int tries = 0; tries < 30 && !accepted; tries++, step *= 0.5) {
+			for(size_t i = 0; i < n; i++) {
+				trial[i] = coordinates[i] + step * direction[i];
+			}
+			trialEnergy = field.evaluate(trial.data(), trialGradient.data(), pairs);
+			accepted = trialEnergy <= energy + 1e-4 * step * slope;
+		}
+		if(!accepted) {
+			if(stored == 0) {
+				break;
+			}
+			stored = 0;
+			continue;
+		}
+
+		newest = (newest + 1) % FORCE_FIELD_HISTORY;
+		for(size_t i = 0; i < n; i++) {
+			s[newest][i] = trial[i] - coordinates[i];
+			y[newest][i] = trialGradient[i] - gradient[i];
+		}
+		double curvature = dot(s[newest], y[newest]);
+		if(curvature > 1e-12) {
+			rho[newest] = 1 / curvature;
+			stored = min(stored + 1, FORCE_FIELD_HISTORY);
+		}
+		else {
+			newest = (newest - 1 + FORCE_FIELD_HISTORY) % FORCE_FIELD_HISTORY;
+		}
+		coordinates.swap(trial);
+		gradient.swap(trialGradient);
+		energy = trialEnergy;
+	}
+	result.energy = energy;
+	return result;
+}
+
+/**
+ * Relax a geometry to the nearest energy minimum with a pair list
+ * of its own (see the overload above)
+ *
+ * @param field the energy model
+ * @param coordinates the starting geometry, replaced by the relaxed one
+ * @param maxIterations the most steps to take
+ * @return the final energy and whether the gradient tolerance was reached
+ */
+MinimizeResult minimizeEnergy(const ForceField &field, vector<double> &coordinates, int maxIterations) {
+	NonbondedList pairs;
+	return minimizeEnergy(field, coordinates, pairs, maxIterations);
+}
+
+/**
+ * Copy one coordinate set of a structure into a flat array
+ *
+ * @param structure the atoms
+ * @param sticks whether to read the ball-and-stick positions
+ *               instead of the van der Waals ones
+ * @return x, y and z of each atom in turn
+ */
+vector<double> readCoordinates(const vector<BondedElement> &structure, bool sticks) {
+	vector<double> coordinates;
+	coordinates.reserve(3 * structure.size());
+	for(const BondedElement &e : structure) {
+		const glm::vec3 &p = sticks ? e.position : e.vanDerWaalsPosition;
+		coordinates.insert(coordinates.end(), {p.x, p.y, p.z});
+	}
+	return coordinates;
+}
+
+/**
+ * Copy a flat array back into one coordinate set of a structure
+ *
+ * @param coordinates x, y and z of each atom in turn
+ * @param structure the atoms, updated in place
+ * @param sticks whether to write the ball-and-stick positions
+ *               instead of the van der Waals ones
+ */
+void writeCoordinates(const vector<double> &coordinates, vector<BondedElement> &structure, bool sticks) {
+	for(size_t i = 0; i < structure.size(); i++) {
+		glm::vec3 &p = sticks ? structure[i].position : structure[i].vanDerWaalsPosition;
+		p = glm::vec3(coordinates[3*i], coordinates[3*i + 1], coordinates[3*i + 2]);
+	}
+}
+
+/**
+ * Relax both coordinate sets of a structure to their nearest
+ * energy minimum, replacing the template geometry
+ * The van der Waals positions are relaxed first and the stick
+ * positions start from them, scaled up, so both models settle
+ * into the same conformation. The cylinders are regenerated.
+ * Templates are often exactly planar (cyclo groups), which is a
+ * saddle point the gradient never leads away from, so every
+ * coordinate is nudged first, the same way on every run.
+ *
+ * @param structure the atoms, with bonds and positions filled in
+ */
+void relaxStructure(vector<BondedElement> &structure) {
+	if(structure.size() < 2) {
+		return;
+	}
+	ForceField real(structure, false);
+	vector<double> coordinates = readCoordinates(structure, false);
+	minstd_rand random;
+	uniform_real_distribution<double> nudge(-FORCE_FIELD_JITTER, FORCE_FIELD_JITTER);
+	for(double &c : coordinates) {
+		c += nudge(random);
+	}
+	minimizeEnergy(real, coordinates);
+	writeCoordinates(coordinates, structure, false);
+	relaxSticks(structure);
+}
+
+/**
+ * Fit the ball-and-stick positions of a structure to its
+ * (relaxed) van der Waals positions
+ * The van der Waals geometry is scaled up to stick lengths and
+ * relaxed again with the stick model, then the structure is
+ * centred and its cylinders regenerated.
+ *
+ * @param structure the atoms, with bonds and positions filled in
+ */
+void relaxSticks(vector<BondedElement> &structure) {
+	vector<double> coordinates = readCoordinates(structure, false);
+	double scale = stickScale();
+	for(double &c : coordinates) {
+		c *= scale;
+	}
+	writeCoordinates(coordinates, structure, true);
+	ForceField sticks(structure, true);
+	minimizeEnergy(sticks, coordinates);
+	writeCoordinates(coordinates, structure, true);
+
+	averageCenterPositions(structure);
+	for(BondedElement &e : structure) {
+		e.cylinderModels.clear();
+	}
+	generateCylinders(structure);
+}
@@ -0,0 +1,260 @@
+#include <cctype>
+#include <limits>
+#include <algorithm>
+#include <iterator>
+#include "formula.h"
+#include "VSEPR.h"
+
+using namespace std;
+
+// Formulas with more atoms than this are rejected rather than overflowing
+#define MAX_FORMULA_ATOMS 1000000u
+
+namespace {
+
+/**
+ * Single pass cursor over a formula
+ * Atoms are appended to a flat list of (element, count) terms as
+ * they're read. A closing bracket multiplies every term since its
+ * opening bracket, and a hydrate's leading coefficient multiplies
+ * every term of its part, so nothing is ever re-read.
+ */
+struct FormulaReader {
+	string_view text;
+	size_t pos = 0;
+	vector<ElementCount> terms;
+
+	bool done() const {
+		return pos >= text.length();
+	}
+
+	char peek() const {
+		return text[pos];
+	}
+
+	/**
+	 * Read a run of digits
+	 *
+	 * @param value set to the number read, left alone if there are no digits
+	 * @return false if the number is too large
+	 */
+	bool readNumber(uint32_t &value) {
+		if(done() || !isdigit((unsigned char)peek())) {
+			return true;
+		}
+		uint64_t number = 0;
+		while(!done() && isdigit((unsigned char)peek())) {
+			number = number * 10 + (peek() - '0');
+			if(number > MAX_FORMULA_ATOMS) {
+				return false;
+			}
+			pos++;
+		}
+		value = (uint32_t)number;
+		return true;
+	}
+
+	/**
+	 * Multiply the counts of every term from start onwards
+	 *
+	 * @param start the first term to scale
+	 * @param multiplier the factor
+	 * @return false if a count gets too large
+	 */
+	bool scale(size_t start, uint32_t multiplier) {
+		for(size_t i = start; i < terms.size(); i++) {
+			uint64_t scaled = (uint64_t)terms[i].count * multiplier;
+			if(scaled > MAX_FORMULA_ATOMS) {
+				return false;
+			}
+			terms[i].count = (uint32_t)scaled;
+		}
+		return true;
+	}
+
+	/**
+	 * Check for a hydrate separator (middle dot, '.' or '*')
+	 * and step over it
+	 *
+	 * @return whether there was one
+	 */
+	bool readHydrateSeparator() {
+		if(peek() == '.' || peek() == '*') {
+			pos++;
+			return true;
+		}
+		// U+00B7 in UTF-8
+		if(text.substr(pos, 2) == "\xC2\xB7") {
+			pos += 2;
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Read the molecule part of the formula, up to the charge
+	 *
+	 * @return false if it isn't valid
+	 */
+	bool readMolecule() {
+		vector<size_t> groupStarts;
+		vector<char> groupClosers;
+		size_t partStart = 0;
+		uint32_t partMultiplier = 1;
+		bool expectingAtom = true;
+
+		if(!readNumber(partMultiplier)) {
+			return false;
+		}
+		while(!done() && !isspace((unsigned char)peek()) && peek() != '+' && peek() != '-') {
+			char c = peek();
+			if(isupper((unsigned char)c)) {
+				size_t symbolStart = pos++;
+				if(!done() && islower((unsigned char)peek())) {
+					pos++;
+				}
+				int id = findElementId(text.substr(symbolStart, pos - symbolStart));
+				if(id < 0) {
+					return false;
+				}
+				uint32_t count = 1;
+				if(!readNumber(count) || count == 0) {
+					return false;
+				}
+				terms.push_back(ElementCount{(uint8_t)id, count});
+				expectingAtom = false;
+			}
+			else if(c == '(' || c == '[') {
+				groupStarts.push_back(terms.size());
+				groupClosers.push_back(c == '(' ? ')' : ']');
+				pos++;
+				expectingAtom = true;
+			}
+			else if(c == ')' || c == ']') {
+				if(groupStarts.empty() || groupClosers.back() != c || expectingAtom) {
+					return false;
+				}
+				pos++;
+				uint32_t multiplier = 1;
+				if(!readNumber(multiplier) || multiplier == 0 || !scale(groupStarts.back(), multiplier)) {
+					return false;
+				}
+				groupStarts.pop_back();
+				groupClosers.pop_back();
+			}
+			else if(readHydrateSeparator()) {
+				if(!groupStarts.empty() || expectingAtom || !scale(partStart, partMultiplier)) {
+					return false;
+				}
+				partStart = terms.size();
+				partMultiplier = 1;
+				if(!readNumber(partMultiplier) || partMultiplier == 0) {
+					return false;
+				}
+				expectingAtom = true;
+			}
+			else {
+				return false;
+			}
+		}
+		return groupStarts.empty() && !expectingAtom && scale(partStart, partMultiplier);
+	}
+
+	/**
+	 * Read an ionic charge, either attached ("NH4+") or after
+	 * a space with the magnitude on either side of the sign
+	 * ("SO4 2-", "SO4 -2")
+	 *
+	 * @param charge set to the signed charge
+	 * @return false if it isn't valid
+	 */
+	bool readCharge(int &charge) {
+		while(!done() && isspace((unsigned char)peek())) {
+			pos++;
+		}
+		if(done()) {
+			return true;
+		}
+
+		uint32_t magnitude = 1;
+		char sign = ' ';
+		if(peek() == '+' || peek() == '-') {
+			sign = peek();
+			pos++;
+			if(!readNumber(magnitude)) {
+				return false;
+			}
+		}
+		else {
+			if(!readNumber(magnitude) || done() || (peek() != '+' && peek() != '-')) {
+				return false;
+			}
+			sign = peek();
+			pos++;
+		}
+		while(!done() && isspace((unsigned char)peek())) {
+			pos++;
+		}
+		if(!done()) {
+			return false;
+		}
+		charge = sign == '-' ? -(int)magnitude : (int)magnitude;
+		return true;
+	}
+};
+
+} // namespace
+
+/**
+ * Parse a chemical formula into a composition histogram in one pass
+ * Supports multi-digit counts, nested groups (Ca(OH)2, K4[Fe(CN)6]),
+ * hydrates (CuSO4·5H2O, also written with '.' or '*') and a charge
+ *
+ * @param text the formula
+ * @param formula set to the composition and charge
+ * @return whether the formula was valid
+ */
+bool parseFormula(string_view text, Formula &formula) {
+	formula = Formula();
+	FormulaReader reader;
+	reader.text = text;
+	while(!reader.done() && isspace((unsigned char)reader.peek())) {
+		reader.pos++;
+	}
+	if(reader.done() || !reader.readMolecule() || !reader.readCharge(formula.charge)) {
+		formula = Formula();
+		return false;
+	}
+
+	// Merge terms into one entry per element, keeping first-appearance order
+	uint32_t slot[ELEMENT_TABLE_SIZE];
+	fill(begin(slot), end(slot), numeric_limits<uint32_t>::max());
+	uint64_t total = 0;
+	for(const ElementCount &term : reader.terms) {
+		total += term.count;
+		if(slot[term.elementId] == numeric_limits<uint32_t>::max()) {
+			slot[term.elementId] = formula.counts.size();
+			formula.counts.push_back(term);
+		}
+		else {
+			formula.counts[slot[term.elementId]].count += term.count;
+		}
+	}
+	if(total > MAX_FORMULA_ATOMS) {
+		formula = Formula();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Find the composition of a chemical formula
+ *
+ * @param text the chemical formula
+ * @return the composition, empty if the formula isn't valid
+ */
+Formula readFormula(string_view text) {
+	Formula formula;
+	parseFormula(text, formula);
+	return formula;
+}
@@ -0,0 +1,177 @@
+#include <stdexcept>
+#include "fragments.h"
+#include "context.h"
+#include "molecule.h"
+
+using namespace std;
+
+/**
+ * Record a finished structure as a template
+ * Neighbour UIDs are replaced by local indices
+ *
+ * @param structure the atoms, placed and hydrogenated
+ * @param count the number of atoms
+ */
+FragmentTemplate::FragmentTemplate(const BondedElement *structure, size_t count) {
+	BondGraph graph(structure, count);
+	atoms.reserve(count);
+	bondOffsets.reserve(count + 1);
+	bonds.reserve(graph.targets.size());
+	for(size_t i = 0; i < count; i++) {
+		const BondedElement &e = structure[i];
+		atoms.push_back(FragmentAtom{e.elementId, e.loneElectrons, e.bondedElectrons, e.id, e.position, e.vanDerWaalsPosition, e.rotation});
+		bondOffsets.push_back(bonds.size());
+		for(uint32_t n = 0; n < graph.degree(i); n++) {
+			bonds.push_back(FragmentBond{(uint16_t)graph.neighboursBegin(i)[n], graph.order(i, n)});
+		}
+	}
+	bondOffsets.push_back(bonds.size());
+}
+
+/**
+ * Create a copy of the fragment with fresh unique ids
+ * Atoms keep the template's positions; the caller moves the
+ * whole fragment into place with one rigid transform
+ *
+ * @param arena the request's memory arena to allocate the atoms from
+ * @param removedHydrogens per atom, how many of its first hydrogens to leave
+ *        out to make room for substituents (null for none)
+ * @return the new substituent
+ */
+Substituent FragmentTemplate::instantiate(std::pmr::memory_resource *arena, const uint8_t *removedHydrogens) const {
+	size_t count = atoms.size();
+	std::pmr::vector<int32_t> indices(count, 0, arena);
+	size_t kept = count;
+	if(removedHydrogens != nullptr) {
+		for(size_t i = 0; i < count; i++) {
+			int left = removedHydrogens[i];
+			for(uint32_t b = bondOffsets[i]; b < bondOffsets[i + 1] && left > 0; b++) {
+				if(atoms[bonds[b].target].elementId == HYDROGEN) {
+					indices[bonds[b].target] = -1;
+					kept--;
+					left--;
+				}
+			}
+		}
+	}
+
+	Substituent sub(arena);
+	sub.components.reserve(kept);
+	for(size_t i = 0; i < count; i++) {
+		if(indices[i] < 0) {
+			continue;
+		}
+		const FragmentAtom &atom = atoms[i];
+		indices[i] = sub.components.size();
+		sub.components.emplace_back(atom.loneElectrons, atom.bondedElectrons, elementTable[atom.elementId]);
+		BondedElement &e = sub.components.back();
+		e.id = atom.id;
+		e.position = atom.position;
+		e.vanDerWaalsPosition = atom.vanDerWaalsPosition;
+		e.rotation = atom.rotation;
+	}
+
+	for(size_t i = 0; i < count; i++) {
+		if(indices[i] < 0) {
+			continue;
+		}
+		BondedElement &e = sub.components[indices[i]];
+		for(uint32_t b = bondOffsets[i]; b < bondOffsets[i + 1]; b++) {
+			const FragmentBond &bond = bonds[b];
+			if(indices[bond.target] < 0) {
+				// Hand the removed hydrogen's bond back for a substituent
+				e.bondedElectrons -= 2 * bond.order;
+				e.loneElectrons += bond.order;
+				continue;
+			}
+			e.bonds.push_back(Bond{sub.components[indices[bond.target]].getUID(), bond.order});
+		}
+	}
+	return sub;
+}
+
+/**
+ * Build the template of a saturated alkyl chain or cyclo group
+ *
+ * @param length the number of carbons
+ * @param cyclo whether the chain is a ring
+ * @param attached whether it's a substituent, with its first
+ *        carbon left one bond short for the parent chain
+ * @return the template, or why it can't be built
+ */
+Result<FragmentTemplate> buildChainTemplate(int length, bool cyclo, bool attached) {
+	std::pmr::memory_resource *resource = std::pmr::get_default_resource();
+	Substituent chain(resource);
+	chain.components.reserve(length * 3 + 2);
+	const Element &carbon = elementTable[CARBON];
+	for(int i = 0; i < length; i++) {
+		BondedElement newCarbon = BondedElement(4, 0, carbon);
+		newCarbon.id = i+1;
+		if(i > 0) {
+			if(BuildError error = bondSafe(newCarbon, chain.components[i-1])) {
+				return error;
+			}
+		}
+		chain.components.push_back(std::move(newCarbon));
+	}
+	if(cyclo) {
+		if(BuildError error = bondSafe(chain.components[0], chain.components[length-1])) {
+			return error;
+		}
+	}
+	positionAtoms(chain, cyclo, resource);
+
+	// Stand-in for the parent chain so the hydrogens leave its slot free
+	BondedElement parent = BondedElement(4, 0, carbon);
+	chain.connectionPoint = -1;
+	if(attached) {
+		if(BuildError error = bondSafe(chain.components[0], parent)) {
+			return error;
+		}
+		chain.connectionPoint = 1;
+	}
+	if(BuildError error = fillInHydrogens(chain)) {
+		return error;
+	}
+	if(attached) {
+		BondedElement &first = chain.components[0];
+		first.removeBond(parent.getUID());
+		first.bondedElectrons -= 2;
+		first.loneElectrons++;
+	}
+	return FragmentTemplate(chain.components.data(), chain.components.size());
+}
+
+/**
+ * Build every prebuilt fragment into the context
+ * Needs the element table
+ * Throws if a template can't be built, like a missing data table
+ *
+ * @param context the context to fill in
+ */
+void buildFragmentLibrary(ModelingContext &context) {
+	FragmentLibrary &library = context.fragments;
+	for(int attached = 0; attached < 2; attached++) {
+		for(int cyclo = 0; cyclo < 2; cyclo++) {
+			vector<FragmentTemplate> &chains = library.chains[attached][cyclo];
+			chains.resize(FRAGMENT_TEMPLATE_MAX + 1);
+			for(int length = cyclo ? 3 : 1; length <= FRAGMENT_TEMPLATE_MAX; length++) {
+				Result<FragmentTemplate> chain = buildChainTemplate(length, cyclo, attached);
+				if(!chain) {
+					throw std::runtime_error("Fragment library: " + chain.error.message);
+				}
+				chains[length] = std::move(chain.value);
+			}
+		}
+	}
+
+	// Alkyl halides, one atom bonded to the parent chain
+	const pair<const char *, int> halogens[] = {{"fluoro", 9}, {"chloro", CHLORINE}, {"bromo", BROMINE}, {"iodo", 53}};
+	for(const auto &halogen : halogens) {
+		const Element &e = elementTable[halogen.second];
+		BondedElement atom = BondedElement(e.valenceNumber, 0, e);
+		atom.position = glm::vec3(0.0f);
+		atom.vanDerWaalsPosition = glm::vec3(0.0f);
+		library.groups[halogen.first] = FragmentTemplate(&atom, 1);
+	}
+}
@@ -0,0 +1,43 @@
+#include "VSEPR.h"
+#include "geometry.h"
+
+// Geometry constants shared by the structure builder and the renderer
+const float atomDistance = 3.5f;
+const float stickSetWidth = 3.0f;
+
+/**
+ * Get the bond distance between two atoms
+ * 
+ * @param model the compound structure
+ * @param index the index of the peripheral atom
+ * @param order the bond order
+ * @return the bond distance
+ */
+float getSphereDistance(const std::vector<BondedElement> &model, int index, int order) {
+	// Schomaker and Stevenson formula for bond length (not used with current data)
+	// return model[0].base().covalentRadius + model[index].base().covalentRadius - 0.09 * abs(model[0].base().electronegativity - model[index].base().electronegativity);
+
+	// Sum of covalent radii based on bond order
+	return (model[0].base().covalentRadii[order-1] + model[index].base().covalentRadii[order-1])/100;
+}
+
+/**
+ * Get the bond distance between two atoms
+ * 
+ * @param a the first element
+ * @param b the second element
+ * @param order the bond order
+ * @return the bond distance
+ */
+float getSphereDistance(const BondedElement &a, const BondedElement &b, int order) {
+	return (a.base().covalentRadii[order-1] + b.base().covalentRadii[order-1])/100;
+}
+
+/**
+ * Get the atomic distance for ball-and-stick models
+ * 
+ * @return the distance
+ */
+float getStickDistance() {
+	return atomDistance;
+}
@@ -0,0 +1,988 @@
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include "VSEPR.h"
+#include "context.h"
+#include "formula.h"
+
+using namespace std;
+
+// Skeletons are searched exhaustively, so only small molecules are tried
+#define LEWIS_MAX_HEAVY_ATOMS 16
+// Give up (BUILD_ERROR_SEARCH_LIMIT) after this many search nodes
+#define LEWIS_NODE_LIMIT (1 << 18)
+// How far the first pass of the search raises its ceiling on the cost,
+// doubling every pass after
+#define LEWIS_CEILING_STEP 500
+// Splits of each bond's polarity between its ends tried for the tightest bound
+#define LEWIS_POLARITY_SHARES 8
+// Costs per bond order moved between the ends of each bond, and per
+// formal charge moved onto the atoms, tried for the tightest bound
+#define LEWIS_MAX_TRANSFER 2400
+#define LEWIS_TRANSFER_STEP 300
+// Steps of the costs per neighbour and per hydrogen moved onto the atoms
+// tried for the tightest bound, up to LEWIS_MAX_TRANSFER
+#define LEWIS_NEIGHBOUR_STEP 50
+#define LEWIS_MAX_BOND_ORDER 3
+// Most bond orders any atom can take (an expanded octet, e.g. Cl in ClO4-)
+#define LEWIS_MAX_BONDS 7
+// Costs are in hundredths of kcal/mol and are weighed against each
+// other. An electron missing from an octet outweighs everything else
+#define DEFICIT_COST 100000000
+// Per neighbour past four: hypervalent atoms rarely have more than four
+// sigma bonds when a multiple bond would do instead
+#define CROWDING_COST 1500
+// Per formal charge, squared so charge is spread rather than piled on one atom
+#define CHARGE_COST 1000
+// Per bond to an atom of the most electronegative element past its
+// first. Such atoms are the ends of chains and bridge only when there's
+// no other way, as in oxides with fewer central atoms than bonds, and
+// then rather than take on about three more formal charges
+#define BRIDGE_COST 3400
+// Taken off per bond between non-hydrogen atoms, times the square of
+// their electronegativity difference (Pauling's ionic resonance energy,
+// 23 kcal/mol per unit squared)
+#define POLAR_COST 2300
+// Multiple bonds and rings cost a quarter of their enthalpies for
+// carbon, keeping their ratios: in full they'd outweigh formal charges,
+// which are bookkeeping rather than energies.
+// Per bond order past the first: a C=C is about 20 kcal/mol weaker
+// than two C-C bonds
+#define PI_COST 500
+// Per 3 or 4-membered ring: cyclopropane and cyclobutane are strained
+// by about 27 kcal/mol
+#define SMALL_RING_COST 675
+// Per 5-membered ring: cyclopentane is strained by about 6 kcal/mol
+#define FIVE_RING_COST 155
+// Per atom, times the square of its share of multiple bond orders, so
+// they're spread out (conjugated rather than cumulated or triple bonds)
+#define SPREAD_COST 20
+
+/**
+ * What the solver needs to know about one non-hydrogen atom
+ */
+struct SolverAtom {
+	uint8_t elementId;
+	int valence;
+	int capacity;     // Most bond orders the atom can take
+	int maxElectrons; // Most electrons around the atom, bonded and lone
+	int octet;        // Electrons the atom needs, 0 for electron-deficient atoms
+	float electronegativity;
+};
+
+/**
+ * Score one atom of a finished assignment
+ *
+ * @param atom the atom
+ * @param bonds the sum of its bond orders
+ * @param lone its lone electrons
+ * @return the cost, lower is better
+ */
+static int atomCost(const SolverAtom &atom, int bonds, int lone) {
+	int deficit = max(0, atom.octet - 2*bonds - lone);
+	int formalCharge = atom.valence - bonds - lone;
+	return DEFICIT_COST*deficit + CHARGE_COST*formalCharge*formalCharge;
+}
+
+/**
+ * Get the cheapest an atom with fixed bonds can score, whatever
+ * lone electrons the rest of the molecule leaves it
+ *
+ * @param atom the atom
+ * @param bonds the sum of its bond orders
+ * @param pairs whether lone electrons only come in pairs (the molecule has an even number of electrons)
+ * @param shift added to the cost per unit of formal charge
+ * @return the lowest cost
+ */
+static int minimumAtomCost(const SolverAtom &atom, int bonds, bool pairs, int shift) {
+	int best = INT_MAX;
+	for(int lone = 0; lone <= atom.maxElectrons - 2*bonds; lone += pairs ? 2 : 1) {
+		best = min(best, atomCost(atom, bonds, lone) + shift*(atom.valence - bonds - lone));
+	}
+	return best;
+}
+
+/**
+ * Check whether two atoms can swap places in any structure
+ *
+ * @param a the first atom
+ * @param b the second atom
+ * @return true if they're the same element
+ */
+static bool interchangeable(const SolverAtom &a, const SolverAtom &b) {
+	return a.elementId == b.elementId;
+}
+
+/**
+ * Depth first branch and bound over the bonds of a molecule
+ * The variables are the number of hydrogens on each atom, then the
+ * order of the bond between each pair of atoms, atom by atom, so
+ * every atom knows how many bonds it still needs before any are
+ * placed and an atom is closed (none of its bonds can change) once
+ * its block of pairs is set. Adjacency is kept as one bitset per atom.
+ * Every cost but ring strain is a sum over atoms: its octet and formal
+ * charge, its half of each multiple bond, its share of each bond's
+ * polarity, its neighbours past four and, for atoms of the most
+ * electronegative element, its neighbours past the first. So a branch
+ * is cut when its bonds already use more electrons than the molecule
+ * has, when a closed atom can't reach the rest of the molecule, or when
+ * the lower bound on its cost can't beat the best structure found:
+ * closed atoms and rings score exactly, open atoms no less than their
+ * cheapest bond order sum and neighbour count among those they can
+ * still reach, the molecule can't have fewer missing octet electrons
+ * than the most bonds its open atoms can still form allow, its formal
+ * charges must add up to its charge and too many bonds between too few
+ * atoms must close small rings. Lagrange multipliers move cost between
+ * the atoms and the molecule so the atoms, bound apart, agree with each
+ * other (see the constructor). Values are tried cheapest bound first,
+ * so good structures are found early.
+ * Identical atoms are interchangeable, so only structures that give
+ * each one no more hydrogens than the one before it, and no stronger
+ * bonds where the two otherwise match, are searched.
+ * Atoms of the most electronegative element only bond to each other
+ * if there's no other element, which rules out peroxide-like chains
+ * (O=N-O-O-O-N=O has no formal charges but isn't N2O5).
+ */
+struct LewisSearch {
+	struct Variable {
+		int atom;
+		int other; // -1 for the atom's hydrogen count
+	};
+
+	const vector<SolverAtom> &atoms;
+	// Atoms of the most electronegative element, if there are others
+	bool terminal[LEWIS_MAX_HEAVY_ATOMS];
+	bool bondable[LEWIS_MAX_HEAVY_ATOMS][LEWIS_MAX_HEAVY_ATOMS];
+	int hydrogens;
+	int electrons;
+	int charge;
+	int atomCount;
+	int octetTotal = 0;
+	// An odd electron count leaves one atom short of an octet
+	int allowedDeficit;
+	vector<Variable> variables;
+
+	uint8_t orders[LEWIS_MAX_HEAVY_ATOMS][LEWIS_MAX_HEAVY_ATOMS] = {};
+	int bondSums[LEWIS_MAX_HEAVY_ATOMS] = {};
+	int hydrogenCounts[LEWIS_MAX_HEAVY_ATOMS] = {};
+	uint32_t adjacency[LEWIS_MAX_HEAVY_ATOMS] = {};
+	int degrees[LEWIS_MAX_HEAVY_ATOMS] = {};
+	// Each end's share of the polarity of each bond, and the most any
+	// bond of an atom can take off it
+	int polarities[LEWIS_MAX_HEAVY_ATOMS][LEWIS_MAX_HEAVY_ATOMS];
+	int mostPolarity[LEWIS_MAX_HEAVY_ATOMS] = {};
+	// The sum of polarities over each atom's bonds so far
+	int polarSums[LEWIS_MAX_HEAVY_ATOMS] = {};
+	// The cost per bond order moved onto each end of each bond, which
+	// cancels out over the molecule, the least any bond of an atom
+	// moves onto it, and the sum over each atom's bonds so far
+	int transfers[LEWIS_MAX_HEAVY_ATOMS][LEWIS_MAX_HEAVY_ATOMS];
+	int leastTransfer[LEWIS_MAX_HEAVY_ATOMS] = {};
+	int transferSums[LEWIS_MAX_HEAVY_ATOMS] = {};
+	// Cost of the small rings the bonds so far close, which later bonds can't open
+	int strain = 0;
+	// Bonds between non-hydrogen atoms so far
+	int bondCount = 0;
+	// The least ring strain of any structure by its number of bonds
+	// between non-hydrogen atoms
+	int leastStrain[LEWIS_MAX_HEAVY_ATOMS*(LEWIS_MAX_HEAVY_ATOMS - 1)/2 + 1];
+	// The cost per non-hydrogen neighbour moved from the rings onto the atoms
+	int neighbourCost = 0;
+	// The cost per hydrogen moved from the molecule onto the atoms
+	int hydrogenCost = 0;
+	// The Lagrange multipliers the bound is taken at (see relax)
+	int multipliers[5] = {};
+	// Cheapest cost of each atom by its bond order sum
+	int costByBonds[LEWIS_MAX_HEAVY_ATOMS][LEWIS_MAX_BONDS + 1];
+	int chargeCost;
+	// The cost per formal charge costByBonds includes, which the
+	// molecule is paid back per unit of its charge
+	int chargeShift = INT_MIN;
+	int bondTotal = 0;
+	int hydrogensLeft;
+	long nodes = 0;
+	// Set if the search stopped at LEWIS_NODE_LIMIT, before finding the best structure
+	bool limited = false;
+
+	// Only structures cheaper than this are kept. Starts as the ceiling
+	// of the current pass
+	int bestCost = INT_MAX;
+	// The lowest bound or cost cut off by the ceiling this pass
+	int cutCost = INT_MAX;
+	uint8_t bestOrders[LEWIS_MAX_HEAVY_ATOMS][LEWIS_MAX_HEAVY_ATOMS];
+	int bestHydrogens[LEWIS_MAX_HEAVY_ATOMS];
+	int bestLone[LEWIS_MAX_HEAVY_ATOMS];
+
+	LewisSearch(const vector<SolverAtom> &atoms, int hydrogens, int electrons, int charge) : atoms(atoms), hydrogens(hydrogens), electrons(electrons), charge(charge), atomCount(atoms.size()), hydrogensLeft(hydrogens) {
+		float mostElectronegative = 0;
+		bool oneElement = true;
+		for(int a = 0; a < atomCount; a++) {
+			mostElectronegative = max(mostElectronegative, atoms[a].electronegativity);
+			oneElement = oneElement && interchangeable(atoms[a], atoms[0]);
+		}
+		for(int a = 0; a < atomCount; a++) {
+			terminal[a] = !oneElement && atoms[a].electronegativity == mostElectronegative;
+			variables.push_back(Variable{a, -1});
+			octetTotal += atoms[a].octet;
+		}
+		for(int a = 0; a < atomCount; a++) {
+			for(int b = a + 1; b < atomCount; b++) {
+				variables.push_back(Variable{a, b});
+				bondable[a][b] = !terminal[a] || !terminal[b];
+			}
+		}
+		allowedDeficit = electrons % 2;
+		// Dropping a bond of every ring of up to 5 atoms leaves no more
+		// bonds than the Moore bound (Alon, Hoory and Linial) allows: n
+		// atoms with d bonds each on average and no such ring need
+		// n >= 2(1 + (d-1) + (d-1)^2), and with no ring of 3 or 4 atoms
+		// n >= 1 + d^2. So the rest of the bonds each close a ring
+		long n = atomCount;
+		int mostWithoutFiveRings = max(0, atomCount - 1);
+		int mostWithoutSmallRings = mostWithoutFiveRings;
+		for(long m = 0; m <= n*(n - 1)/2; m++) {
+			if(n*n*n - 2*n*n + 4*m*n - 8*m*m >= 0) {
+				mostWithoutFiveRings = max<int>(mostWithoutFiveRings, m);
+			}
+			if(n*n*(n - 1) >= 4*m*m) {
+				mostWithoutSmallRings = max<int>(mostWithoutSmallRings, m);
+			}
+		}
+		for(int m = 0; m <= atomCount*(atomCount - 1)/2; m++) {
+			leastStrain[m] = FIVE_RING_COST*max(0, m - mostWithoutFiveRings) + (SMALL_RING_COST - FIVE_RING_COST)*max(0, m - mostWithoutSmallRings);
+		}
+		// Integer formal charges summing to the charge
+		chargeCost = CHARGE_COST * abs(charge);
+
+		// However a bond's polarity is split between its ends, whatever
+		// one end is charged per bond order the other is paid, whatever
+		// each atom is charged per formal charge, neighbour or hydrogen
+		// the molecule is paid back per unit of its charge, per bond
+		// or per hydrogen, finished structures cost the same. But the
+		// atoms, bound apart, bound the search differently: e.g. an
+		// oxygen atom on its own would take a double bond or a negative
+		// charge, whatever its neighbours have to give, and each carbon
+		// atom of benzene three single bonds, whatever rings they close.
+		// So take the multipliers that bound the whole search best (a
+		// Lagrangian relaxation of the atoms adding up to a molecule)
+		relax();
+		if(atomCount > 1) {
+			tighten();
+		}
+	}
+
+	/**
+	 * Raise the lower bound on the whole search by moving one
+	 * multiplier at a time up or down in steps while that raises it
+	 */
+	void tighten() {
+		const int least[5] = {0, -LEWIS_MAX_TRANSFER, -LEWIS_MAX_TRANSFER, 0, -LEWIS_MAX_TRANSFER};
+		const int most[5] = {LEWIS_POLARITY_SHARES, LEWIS_MAX_TRANSFER, LEWIS_MAX_TRANSFER, LEWIS_MAX_TRANSFER, LEWIS_MAX_TRANSFER};
+		const int steps[5] = {1, LEWIS_TRANSFER_STEP, LEWIS_TRANSFER_STEP, LEWIS_NEIGHBOUR_STEP, LEWIS_NEIGHBOUR_STEP};
+		int bestBound = lowerBound(variables[0]);
+		for(bool raised = true; raised;) {
+			raised = false;
+			for(int m = 0; m < 5; m++) {
+				for(int step : {steps[m], -steps[m]}) {
+					while(multipliers[m] + step >= least[m] && multipliers[m] + step <= most[m]) {
+						multipliers[m] += step;
+						relax();
+						int bound = lowerBound(variables[0]);
+						if(bound <= bestBound) {
+							multipliers[m] -= step;
+							break;
+						}
+						bestBound = bound;
+						raised = true;
+					}
+				}
+			}
+		}
+		relax();
+	}
+
+	/**
+	 * Set the costs the atoms are bound by from the multipliers: how
+	 * many of LEWIS_POLARITY_SHARES parts of each bond's polarity go to
+	 * its more electronegative end, the cost per bond order moved onto
+	 * that end from the other, and the cost per formal charge, per
+	 * non-hydrogen neighbour and per hydrogen past that
+	 */
+	void relax() {
+		int share = multipliers[0];
+		int transfer = multipliers[1];
+		neighbourCost = multipliers[3];
+		hydrogenCost = multipliers[3] + multipliers[4];
+		if(multipliers[2] != chargeShift) {
+			chargeShift = multipliers[2];
+			for(int a = 0; a < atomCount; a++) {
+				for(int bonds = 0; bonds <= atoms[a].capacity; bonds++) {
+					costByBonds[a][bonds] = minimumAtomCost(atoms[a], bonds, electrons % 2 == 0, chargeShift);
+				}
+			}
+		}
+		fill(mostPolarity, mostPolarity + atomCount, 0);
+		fill(leastTransfer, leastTransfer + atomCount, INT_MAX);
+		for(int a = 0; a < atomCount; a++) {
+			for(int b = a + 1; b < atomCount; b++) {
+				float difference = atoms[a].electronegativity - atoms[b].electronegativity;
+				int polarity = (int)(POLAR_COST * difference*difference);
+				int negative = difference >= 0 ? a : b;
+				int positive = a + b - negative;
+				polarities[negative][positive] = polarity * share / LEWIS_POLARITY_SHARES;
+				polarities[positive][negative] = polarity - polarities[negative][positive];
+				transfers[negative][positive] = difference != 0 ? transfer : 0;
+				transfers[positive][negative] = -transfers[negative][positive];
+				if(bondable[a][b]) {
+					mostPolarity[negative] = max(mostPolarity[negative], polarities[negative][positive]);
+					mostPolarity[positive] = max(mostPolarity[positive], polarities[positive][negative]);
+					leastTransfer[negative] = min(leastTransfer[negative], transfers[negative][positive]);
+					leastTransfer[positive] = min(leastTransfer[positive], transfers[positive][negative]);
+				}
+			}
+		}
+		for(int a = 0; a < atomCount; a++) {
+			if(leastTransfer[a] == INT_MAX) {
+				leastTransfer[a] = 0;
+			}
+		}
+	}
+
+	int capacityLeft(int a) const {
+		return atoms[a].capacity - bondSums[a] - hydrogenCounts[a];
+	}
+
+	/**
+	 * Get the cost of an atom's bonds to the other non-hydrogen atoms,
+	 * but for their polarity
+	 *
+	 * @param a the atom
+	 * @param heavyBonds the sum of the orders of those bonds
+	 * @param degree the number of those bonds
+	 * @return the cost
+	 */
+	int bondsCost(int a, int heavyBonds, int degree) const {
+		int multiple = heavyBonds - degree;
+		int cost = PI_COST/2*multiple + SPREAD_COST*multiple*multiple;
+		if(degree > 4) {
+			cost += CROWDING_COST*(degree - 4);
+		}
+		if(terminal[a] && degree > 1) {
+			cost += BRIDGE_COST*(degree - 1);
+		}
+		return cost;
+	}
+
+	/**
+	 * Get the most bond orders an open atom can still end up with
+	 *
+	 * @param b the atom
+	 * @param variable the next variable to set
+	 * @param partners set to the most non-hydrogen neighbours it can still end up with
+	 * @return the most bond orders
+	 */
+	int reachableBonds(int b, const Variable &variable, int &partners) const {
+		int reach = bondSums[b] + hydrogenCounts[b];
+		partners = degrees[b];
+		if(variable.other < 0) {
+			// No bonds are set yet
+			if(b >= variable.atom) {
+				reach += hydrogensLeft;
+			}
+			for(int x = 0; x < atomCount; x++) {
+				if(x != b && bondable[min(x, b)][max(x, b)]) {
+					reach += min(LEWIS_MAX_BOND_ORDER, atoms[x].capacity);
+					partners++;
+				}
+			}
+			return min(reach, atoms[b].capacity);
+		}
+		// Bonds (x, y) with x < y are set in block x, in order of y
+		int a = variable.atom;
+		for(int x = a; x < atomCount; x++) {
+			if(x == b || !bondable[min(x, b)][max(x, b)]) {
+				continue;
+			}
+			bool open = b == a ? x >= variable.other : (x > a || b >= variable.other);
+			if(open && capacityLeft(x) > 0) {
+				reach += min(LEWIS_MAX_BOND_ORDER, capacityLeft(x));
+				partners++;
+			}
+		}
+		return min(reach, atoms[b].capacity);
+	}
+
+	/**
+	 * Get the cheapest an atom can score, whatever bonds it ends up with
+	 *
+	 * @param a the atom
+	 * @param h its hydrogens
+	 * @param reach the most bond orders it can end up with
+	 * @param partners the most non-hydrogen neighbours it can end up with
+	 * @param cheapestBonds lowered to the lowest cost of its bonds alone, without its octet and charge
+	 * @return the lowest cost, INT_MAX if it can't bond to the molecule
+	 */
+	int cheapestAtom(int a, int h, int reach, int partners, int &cheapestBonds) const {
+		int fewest = max(degrees[a], atomCount > 1 ? 1 : 0);
+		int best = INT_MAX;
+		for(int bonds = bondSums[a] + h; bonds <= reach; bonds++) {
+			int heavyBonds = bonds - h;
+			// Each new neighbour takes at least one more bond order
+			int most = min(partners, degrees[a] + heavyBonds - bondSums[a]);
+			// The cost is linear in the neighbour count but for a step up
+			// past one for a terminal atom and past four for any atom, so
+			// the cheapest count is one of these
+			for(int degree : {fewest, 1, 4, most}) {
+				if(degree < fewest || degree > most) {
+					continue;
+				}
+				int polarity = polarSums[a] + (degree - degrees[a])*mostPolarity[a];
+				int transfer = transferSums[a] + (heavyBonds - bondSums[a])*leastTransfer[a];
+				int cost = bondsCost(a, heavyBonds, degree) - polarity + transfer + neighbourCost*degree + hydrogenCost*h;
+				cheapestBonds = min(cheapestBonds, cost);
+				best = min(best, costByBonds[a][bonds] + cost);
+			}
+		}
+		return best;
+	}
+
+	/**
+	 * Get a lower bound on the cost of every structure below a node
+	 *
+	 * @param variable the next variable to set
+	 * @return the bound, INT_MAX if no structure can be finished
+	 */
+	int lowerBound(const Variable &variable) const {
+		int openFrom = variable.other < 0 ? 0 : variable.atom;
+		int atomsCost = 0;
+		// The same without octets and formal charges, which the
+		// molecule as a whole bounds better
+		int skeletonCost = 0;
+		for(int a = 0; a < openFrom; a++) {
+			int bonds = bondSums[a] + hydrogenCounts[a];
+			int cost = bondsCost(a, bondSums[a], degrees[a]) - polarSums[a] + transferSums[a] + neighbourCost*degrees[a] + hydrogenCost*hydrogenCounts[a];
+			atomsCost += costByBonds[a][bonds] + cost;
+			skeletonCost += cost;
+		}
+
+		int openCapacity = 0;
+		int openBondingCapacity = 0;
+		for(int a = openFrom; a < atomCount; a++) {
+			openCapacity += capacityLeft(a);
+			if(!terminal[a]) {
+				openBondingCapacity += capacityLeft(a);
+			}
+			int partners;
+			int reach = reachableBonds(a, variable, partners);
+			int cheapest = INT_MAX;
+			int cheapestBonds = INT_MAX;
+			if(variable.other < 0 && a >= variable.atom) {
+				// Its hydrogens aren't set yet either
+				for(int h = 0; h <= min(hydrogensLeft, atoms[a].capacity); h++) {
+					cheapest = min(cheapest, cheapestAtom(a, h, reach, partners, cheapestBonds));
+				}
+			}
+			else {
+				cheapest = cheapestAtom(a, hydrogenCounts[a], reach, partners, cheapestBonds);
+			}
+			if(cheapest == INT_MAX) {
+				return INT_MAX;
+			}
+			atomsCost += cheapest;
+			skeletonCost += cheapestBonds;
+		}
+		if(hydrogensLeft > openCapacity) {
+			return INT_MAX;
+		}
+		// Electrons around the atoms total twice the bond orders between
+		// them plus every electron of the molecule. Every new bond has
+		// at least one end on an atom that isn't terminal
+		int mostBonds = bondTotal + min((openCapacity - hydrogensLeft) / 2, openBondingCapacity);
+		int deficit = max(0, octetTotal - 2*mostBonds - electrons);
+		if(deficit > allowedDeficit) {
+			return INT_MAX;
+		}
+		int deficitCost = DEFICIT_COST * deficit;
+		return max(atomsCost - chargeShift*charge, skeletonCost + max(deficitCost, chargeCost)) + ringBound() - hydrogenCost*hydrogens;
+	}
+
+	/**
+	 * Get a lower bound on the ring strain of every structure below a
+	 * node, less what its atoms are charged per neighbour
+	 *
+	 * @return the bound
+	 */
+	int ringBound() const {
+		// Convex in the number of bonds, so stop once it stops falling
+		int best = INT_MAX;
+		for(int m = bondCount; m <= atomCount*(atomCount - 1)/2; m++) {
+			int cost = max(strain, leastStrain[m]) - 2*neighbourCost*m;
+			if(cost >= best) {
+				break;
+			}
+			best = cost;
+		}
+		return best;
+	}
+
+	/**
+	 * Find every atom reachable from one through the bonds so far
+	 *
+	 * @param start the atom
+	 * @return the set of atoms as a bitset
+	 */
+	uint32_t component(int start) const {
+		uint32_t reached = 1u << start;
+		uint32_t frontier = reached;
+		while(frontier != 0) {
+			uint32_t next = 0;
+			for(int a = 0; a < atomCount; a++) {
+				if(frontier & (1u << a)) {
+					next |= adjacency[a];
+				}
+			}
+			frontier = next & ~reached;
+			reached |= next;
+		}
+		return reached;
+	}
+
+	/**
+	 * Check that every atom is reachable through the bonds
+	 *
+	 * @return true if the atoms form one molecule
+	 */
+	bool connected() const {
+		return component(0) == (1u << atomCount) - 1;
+	}
+
+	/**
+	 * Get the cost of the rings of up to 5 atoms a bond between two
+	 * atoms would close, by following every path between them
+	 *
+	 * @param atom the end of the path so far, starting from one of the atoms
+	 * @param target the other atom
+	 * @param path the atoms on the path, as a bitset
+	 * @param length the number of atoms on the path
+	 * @return the cost
+	 */
+	int closedRings(int atom, int target, uint32_t path, int length) const {
+		int cost = 0;
+		for(int x = 0; x < atomCount; x++) {
+			if(!(adjacency[atom] & (1u << x)) || (path & (1u << x))) {
+				continue;
+			}
+			if(x == target) {
+				cost += length == 4 ? FIVE_RING_COST : SMALL_RING_COST;
+			}
+			else if(length < 4) {
+				cost += closedRings(x, target, path | (1u << x), length + 1);
+			}
+		}
+		return cost;
+	}
+
+	/**
+	 * Give out the lone electrons of a finished skeleton and keep
+	 * it if it's the best so far
+	 * The cost is convex in each atom's lone electrons, so handing
+	 * out pairs one at a time to whichever atom gains the most is
+	 * optimal. Ties go to the more electronegative atom.
+	 */
+	void evaluate() {
+		if(!connected()) {
+			return;
+		}
+		int lone[LEWIS_MAX_HEAVY_ATOMS] = {};
+		int left = electrons - 2*(bondTotal + hydrogens);
+		while(left > 0) {
+			int step = left >= 2 ? 2 : 1;
+			int chosen = -1;
+			int chosenGain = INT_MAX;
+			for(int a = 0; a < atomCount; a++) {
+				int bonds = bondSums[a] + hydrogenCounts[a];
+				if(2*bonds + lone[a] + step > atoms[a].maxElectrons) {
+					continue;
+				}
+				int gain = atomCost(atoms[a], bonds, lone[a] + step) - atomCost(atoms[a], bonds, lone[a]);
+				if(gain < chosenGain || (gain == chosenGain && atoms[a].electronegativity > atoms[chosen].electronegativity)) {
+					chosen = a;
+					chosenGain = gain;
+				}
+			}
+			if(chosen < 0) {
+				return;
+			}
+			lone[chosen] += step;
+			left -= step;
+		}
+
+		int cost = strain;
+		int deficit = 0;
+		for(int a = 0; a < atomCount; a++) {
+			int bonds = bondSums[a] + hydrogenCounts[a];
+			cost += atomCost(atoms[a], bonds, lone[a]) + bondsCost(a, bondSums[a], degrees[a]) - polarSums[a];
+			deficit += max(0, atoms[a].octet - 2*bonds - lone[a]);
+		}
+		if(deficit > allowedDeficit) {
+			return;
+		}
+		if(cost >= bestCost) {
+			cutCost = min(cutCost, cost);
+			return;
+		}
+		bestCost = cost;
+		copy(&orders[0][0], &orders[0][0] + LEWIS_MAX_HEAVY_ATOMS*LEWIS_MAX_HEAVY_ATOMS, &bestOrders[0][0]);
+		copy(hydrogenCounts, hydrogenCounts + atomCount, bestHydrogens);
+		copy(lone, lone + atomCount, bestLone);
+	}
+
+	/**
+	 * Check whether swapping an atom with the one before it would give
+	 * a structure already searched, if its bond to another atom were
+	 * stronger. That's the case when the two are interchangeable, have
+	 * as many hydrogens and bond alike to every atom before that one,
+	 * so bonds to earlier atoms are never stronger than the previous
+	 * atom's.
+	 *
+	 * @param a the earlier atom, whose bond is being set
+	 * @param b the atom
+	 * @return true if the bond can't be stronger than orders[a][b-1]
+	 */
+	bool mirrorsPrevious(int a, int b) const {
+		if(b - 1 <= a || !interchangeable(atoms[b], atoms[b-1]) || hydrogenCounts[b] != hydrogenCounts[b-1]) {
+			return false;
+		}
+		for(int x = 0; x < a; x++) {
+			if(orders[x][b] != orders[x][b-1]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Check whether swapping an atom with the one before it would give
+	 * a structure already searched, if its bond to a later atom were
+	 * stronger than the previous atom's. That's the case when the two
+	 * are interchangeable, have as many hydrogens and bond alike to every
+	 * atom before them and to every atom between them and the later one.
+	 *
+	 * @param a the atom, whose bond is being set
+	 * @param b the later atom
+	 * @return true if the bond can't be stronger than orders[a-1][b]
+	 */
+	bool followsPrevious(int a, int b) const {
+		if(a == 0 || !interchangeable(atoms[a], atoms[a-1]) || hydrogenCounts[a] != hydrogenCounts[a-1]) {
+			return false;
+		}
+		for(int x = 0; x < a - 1; x++) {
+			if(orders[x][a] != orders[x][a-1]) {
+				return false;
+			}
+		}
+		for(int y = a + 1; y < b; y++) {
+			if(orders[a][y] != orders[a-1][y]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Bond two atoms, or take the bond away again
+	 *
+	 * @param a the first atom
+	 * @param b the second atom
+	 * @param order the bond's order, negated to take it away
+	 * @param rings the cost of the rings the bond closes (see closedRings)
+	 */
+	void setOrder(int a, int b, int order, int rings) {
+		bondSums[a] += order;
+		bondSums[b] += order;
+		bondTotal += order;
+		orders[a][b] = orders[b][a] = order > 0 ? order : 0;
+		if(order != 0) {
+			int step = order > 0 ? 1 : -1;
+			adjacency[a] ^= 1u << b;
+			adjacency[b] ^= 1u << a;
+			strain += step*rings;
+			degrees[a] += step;
+			degrees[b] += step;
+			bondCount += step;
+			polarSums[a] += step*polarities[a][b];
+			polarSums[b] += step*polarities[b][a];
+			transferSums[a] += order*transfers[a][b];
+			transferSums[b] += order*transfers[b][a];
+		}
+	}
+
+	/**
+	 * Get the lower bound on the cost below the next node
+	 *
+	 * @param v the index of the variable just set
+	 * @return the bound (see lowerBound), INT_MIN if the next node is a finished structure
+	 */
+	int boundAfter(size_t v) const {
+		return v + 1 < variables.size() ? lowerBound(variables[v + 1]) : INT_MIN;
+	}
+
+	/**
+	 * Add a choice to a list kept cheapest bound first, after any with the same bound
+	 */
+	static void insertByBound(int *values, int *bounds, int &count, int value, int bound) {
+		int slot = count++;
+		for(; slot > 0 && bounds[slot - 1] > bound; slot--) {
+			values[slot] = values[slot - 1];
+			bounds[slot] = bounds[slot - 1];
+		}
+		values[slot] = value;
+		bounds[slot] = bound;
+	}
+
+	/**
+	 * Try every value of a variable and search below each
+	 *
+	 * @param v the index of the variable to set
+	 * @param bound the lower bound on the cost below this node
+	 */
+	void search(size_t v, int bound) {
+		if(++nodes > LEWIS_NODE_LIMIT) {
+			limited = true;
+			return;
+		}
+		if(v == variables.size()) {
+			evaluate();
+			return;
+		}
+
+		const Variable &variable = variables[v];
+		int a = variable.atom;
+		if(bound >= bestCost) {
+			cutCost = min(cutCost, bound);
+			return;
+		}
+		if(variable.other < 0) {
+			// The last atom takes whatever hydrogens are left
+			int most = min(hydrogensLeft, atoms[a].capacity);
+			if(a > 0 && interchangeable(atoms[a], atoms[a-1])) {
+				most = min(most, hydrogenCounts[a-1]);
+			}
+			int least = a == atomCount - 1 ? hydrogensLeft : 0;
+			// Cheapest bound first, ties taking the count nearest an even
+			// share of the hydrogens left first. Bounds tie a lot over
+			// hydrogens, and evenly spread ones are the likeliest to leave
+			// every atom a skeleton that works out, e.g. C6H12O6
+			int even = (2*hydrogensLeft + atomCount - a) / (2*(atomCount - a));
+			int values[2*LEWIS_MAX_BONDS + 1];
+			int bounds[2*LEWIS_MAX_BONDS + 1];
+			int count = 0;
+			for(int i = 0; i <= 2*LEWIS_MAX_BONDS; i++) {
+				// even, even + 1, even - 1, even + 2, ...
+				int h = i % 2 == 0 ? even - i/2 : even + (i + 1)/2;
+				// An atom filled up with hydrogens can't bond to the others
+				if(h < least || h > most || (h == atoms[a].capacity && atomCount > 1)) {
+					continue;
+				}
+				hydrogenCounts[a] = h;
+				hydrogensLeft -= h;
+				insertByBound(values, bounds, count, h, boundAfter(v));
+				hydrogensLeft += h;
+			}
+			for(int i = 0; i < count; i++) {
+				if(bounds[i] >= bestCost) {
+					cutCost = min(cutCost, bounds[i]);
+					break;
+				}
+				hydrogenCounts[a] = values[i];
+				hydrogensLeft -= values[i];
+				search(v + 1, bounds[i]);
+				hydrogensLeft += values[i];
+			}
+			hydrogenCounts[a] = 0;
+			return;
+		}
+
+		// Atom a-1 was just closed. If nothing it's connected to can
+		// take another bond, it's cut off from the rest for good
+		if(variable.other == a + 1 && a > 0) {
+			uint32_t part = component(a-1);
+			if((part >> a) == 0) {
+				return;
+			}
+		}
+		int b = variable.other;
+		int most = bondable[a][b] ? min(LEWIS_MAX_BOND_ORDER, min(capacityLeft(a), capacityLeft(b))) : 0;
+		most = min(most, (electrons - 2*(bondTotal + hydrogens)) / 2);
+		if(mirrorsPrevious(a, b)) {
+			most = min(most, (int)orders[a][b-1]);
+		}
+		if(followsPrevious(a, b)) {
+			most = min(most, (int)orders[a-1][b]);
+		}
+		int rings = most > 0 ? closedRings(a, b, 1u << a, 1) : 0;
+		// Orders 0..most, cheapest bound first so a good structure is
+		// found early. Ties leave the atoms unbonded last
+		int values[LEWIS_MAX_BOND_ORDER + 1];
+		int bounds[LEWIS_MAX_BOND_ORDER + 1];
+		int count = 0;
+		for(int order = 1; order <= most + 1; order++) {
+			int o = order <= most ? order : 0;
+			setOrder(a, b, o, rings);
+			int childBound = boundAfter(v);
+			setOrder(a, b, -o, rings);
+			insertByBound(values, bounds, count, o, childBound);
+		}
+		for(int i = 0; i < count; i++) {
+			if(bounds[i] >= bestCost) {
+				cutCost = min(cutCost, bounds[i]);
+				break;
+			}
+			setOrder(a, b, values[i], rings);
+			search(v + 1, bounds[i]);
+			setOrder(a, b, -values[i], rings);
+		}
+		orders[a][b] = orders[b][a] = 0;
+	}
+};
+
+/**
+ * Describe an element to the solver
+ *
+ * @param e the element
+ * @return the atom's limits
+ */
+static SolverAtom solverAtom(const Element &e) {
+	SolverAtom atom;
+	atom.elementId = e.atomicNumber;
+	atom.valence = e.valenceNumber;
+	atom.electronegativity = e.electronegativity;
+	if(e.periodNumber == 1) {
+		atom.capacity = 1;
+		atom.maxElectrons = 2;
+		atom.octet = 2;
+	}
+	else {
+		// Only period 3 and below can expand their octet
+		atom.capacity = e.periodNumber == 2 ? 4 : LEWIS_MAX_BONDS;
+		atom.maxElectrons = e.periodNumber == 2 ? 8 : 2*LEWIS_MAX_BONDS;
+		atom.octet = e.valenceNumber < 4 ? 0 : 8;
+	}
+	return atom;
+}
+
+/**
+ * Find the Lewis structure of a molecule with any number of
+ * central atoms, e.g. H2O2, N2O4 or C2H6O
+ * Every skeleton of bonds between the non-hydrogen atoms and
+ * every placement of the hydrogens is searched (see LewisSearch)
+ * for the one of lowest cost: missing octet electrons outweigh
+ * everything, then formal charges, bridging electronegative atoms,
+ * crowded atoms, multiple bonds and small rings are weighed against
+ * the polarity of the bonds. Ties keep the first structure found.
+ *
+ * @param formula the composition, in any order
+ * @return the structure, bonded but not placed, or why there is none,
+ * BUILD_ERROR_SEARCH_LIMIT if the search is too large to finish
+ */
+Result<vector<BondedElement>> solveLewisBonds(const Formula &formula) {
+	const BuildError impossible(BUILD_ERROR_NO_LEWIS_STRUCTURE, "Lewis structure not possible");
+	int electrons = -formula.charge;
+	int hydrogens = 0;
+	vector<SolverAtom> atoms;
+	for(const ElementCount &c : formula.counts) {
+		const Element &e = elementTable[c.elementId];
+		electrons += e.valenceNumber * c.count;
+		if(c.elementId == HYDROGEN) {
+			hydrogens += c.count;
+			continue;
+		}
+		if(atoms.size() + c.count > LEWIS_MAX_HEAVY_ATOMS) {
+			return impossible;
+		}
+		atoms.insert(atoms.end(), c.count, solverAtom(e));
+	}
+	// Only hydrogen, e.g. H2
+	if(atoms.empty()) {
+		if(hydrogens > LEWIS_MAX_HEAVY_ATOMS) {
+			return impossible;
+		}
+		atoms.assign(hydrogens, solverAtom(elementTable[HYDROGEN]));
+		hydrogens = 0;
+	}
+	if(atoms.empty() || electrons < 0) {
+		return impossible;
+	}
+
+	LewisSearch search(atoms, hydrogens, electrons, formula.charge);
+	// Each pass only keeps structures below a ceiling, starting at the
+	// bound on the whole search since it's often the cost of the best
+	// structure, so expensive branches are cut from the start. Whatever
+	// a pass finds is the best there is
+	int bound = search.lowerBound(search.variables[0]);
+	int ceiling = bound;
+	long step = LEWIS_CEILING_STEP;
+	while(bound != INT_MAX) {
+		search.bestCost = ceiling + 1;
+		search.cutCost = INT_MAX;
+		search.search(0, bound);
+		if(search.limited || search.bestCost <= ceiling || search.cutCost == INT_MAX) {
+			break;
+		}
+		ceiling = (int)min<long>(INT_MAX - 1, max<long>(search.cutCost, ceiling + step));
+		step *= 2;
+	}
+	if(search.limited) {
+		return BuildError(BUILD_ERROR_SEARCH_LIMIT, "Lewis structure search too large");
+	}
+	if(bound == INT_MAX || search.bestCost > ceiling) {
+		return impossible;
+	}
+
+	int atomCount = atoms.size();
+	vector<BondedElement> structure;
+	structure.reserve(atomCount + hydrogens);
+	for(int a = 0; a < atomCount; a++) {
+		structure.emplace_back(search.bestLone[a], 0, elementTable[atoms[a].elementId]);
+	}
+	for(int a = 0; a < atomCount; a++) {
+		for(int b = a + 1; b < atomCount; b++) {
+			uint8_t order = search.bestOrders[a][b];
+			if(order > 0) {
+				structure[a].bonds.push_back(Bond{structure[b].getUID(), order});
+				structure[b].bonds.push_back(Bond{structure[a].getUID(), order});
+			}
+		}
+	}
+	for(int a = 0; a < atomCount; a++) {
+		for(int h = 0; h < search.bestHydrogens[a]; h++) {
+			structure.emplace_back(0, 0, elementTable[HYDROGEN]);
+			structure[a].bonds.push_back(Bond{structure.back().getUID()});
+			structure.back().bonds.push_back(Bond{structure[a].getUID()});
+		}
+	}
+	for(BondedElement &atom : structure) {
+		int bondSum = atom.totalBondOrder();
+		atom.bondedElectrons = bondSum * 2;
+		atom.numberOfBonds = bondSum;
+	}
+
+	return structure;
+}
+
+/**
+ * Find the Lewis structure of a molecule with any number of
+ * central atoms (see solveLewisBonds) and place it
+ *
+ * @param context the lookup tables to build with
+ * @param formula the composition, in any order
+ * @return the structure, placed, or why there is none
+ */
+Result<vector<BondedElement>> solveLewisStructure(const ModelingContext &context, const Formula &formula) {
+	Result<vector<BondedElement>> solved = solveLewisBonds(formula);
+	if(solved) {
+		placeStructure(solved.value);
+	}
+	return solved;
+}
@@ -19,6 +19,8 @@
 #include "Sphere.h"
 #include "cylinder.h"
 #include "render.h"
+#include "molecule.h"
+#include "conformers.h"
 
 // STD headers
 #include <vector>
@@ -34,6 +36,9 @@ int representation = 1; // 0 = electron, 1 = sphere, 2 = ball and stick
 
 // Local VSEPRModel for the rendering thread
 std::vector<BondedElement> VSEPRModel;
+// Column copy of VSEPRModel iterated by the render loops
+MoleculeStore VSEPRStore;
+unsigned int modelVersion = 0;
 
 // State variables
 float deltaTime = 0.0f;
@@ -42,10 +47,7 @@ bool restrictY = true;
 bool black = true;
 
 // Rendering constants
-const float atomDistance = 3.5f;
-const float electronSpeed = 3;
 const float lineColor[] = {0.2f, 0.2f, 0.2f, 1};
-const float stickSetWidth = 3.0f;
 
 // Definitions of extern variables
 unsigned int sphereVAO;
@@ -151,6 +153,13 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
 	if (glfwGetKey(window, GLFW_KEY_C)) {
 		black = !black;
 	}
+	// Step forwards/backwards through the conformers of the model
+	if (glfwGetKey(window, GLFW_KEY_N)) {
+		stepConformer(1);
+	}
+	if (glfwGetKey(window, GLFW_KEY_B)) {
+		stepConformer(-1);
+	}
 }
 
 /**
@@ -186,8 +195,15 @@ void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
 	}
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+	// model --batch [--smiles] [file] builds every line of the file (or stdin) headlessly
+	if (argc > 1 && std::string(argv[1]) == "--batch") {
+		bool smiles = argc > 2 && std::string(argv[2]) == "--smiles";
+		int fileArg = smiles ? 3 : 2;
+		return batchMain(argc > fileArg ? argv[fileArg] : nullptr, smiles);
+	}
+
 	clicked = false;
 	std::thread VSEPRthread(VSEPRMain);
 
@@ -319,7 +335,7 @@ int main()
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
-        VSEPRModel = mutateModel();
+        pollModel(VSEPRModel, VSEPRStore, modelVersion);
 
 		camera.ProcessKeyboard(window, deltaTime, false);
 
@@ -352,13 +368,13 @@ int main()
 		glActiveTexture(GL_TEXTURE1);
 		glBindTexture(GL_TEXTURE_2D, specMap);
 
-		if (organic || VSEPRModel.size() > 7) {
+		if (VSEPRStore.organic || VSEPRModel.size() > 7) {
 			lightingShader.setMat4(MODEL, model);
 			lightingShader.setMat4(VIEW, view);
 			lightingShader.setMat4(PROJECTION, projection);
 			lightingShader.setVec3(VIEW_POS, camera.Position);
 
-			renderOrganic(VSEPRModel, lightingShader, rotationModel, representation);
+			renderOrganic(VSEPRStore, lightingShader, rotationModel, representation);
 
 			//Swap buffer and poll IO events
 			glfwSwapBuffers(window);
@@ -382,7 +398,7 @@ int main()
 
 		// Draw spheres
 		if (VSEPRModel.size() > 0) {
-			renderSimpleCompound(VSEPRModel, rotationModel, lightingShader, representation);
+			renderSimpleCompound(VSEPRStore, rotationModel, lightingShader, representation);
 		}
 		else {
 			model = glm::mat4();
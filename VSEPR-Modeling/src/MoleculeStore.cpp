@@ -0,0 +1,62 @@
+#include "molecule.h"
+
+using namespace std;
+
+/**
+ * Flatten a list of atoms into columns
+ *
+ * @param structure the compound's structure
+ */
+MoleculeStore::MoleculeStore(const vector<BondedElement> &structure) {
+	size_t n = structure.size();
+	uids.reserve(n);
+	positions.reserve(n);
+	vanDerWaalsPositions.reserve(n);
+	elementIndices.reserve(n);
+	loneElectrons.reserve(n);
+	bondedElectrons.reserve(n);
+	cylinderOffsets.reserve(n + 1);
+
+	BondGraph graph(structure);
+	bondOffsets = std::move(graph.offsets);
+	bondTargets = std::move(graph.targets);
+	bondOrders = std::move(graph.orders);
+
+	size_t totalCylinders = 0;
+	for(const BondedElement &b : structure) {
+		totalCylinders += b.cylinderModels.size();
+	}
+	cylinderModels.reserve(totalCylinders);
+
+	cylinderOffsets.push_back(0);
+	for(const BondedElement &b : structure) {
+		uids.push_back(b.getUID());
+		positions.push_back(b.position);
+		vanDerWaalsPositions.push_back(b.vanDerWaalsPosition);
+		loneElectrons.push_back(b.loneElectrons);
+		bondedElectrons.push_back(b.bondedElectrons);
+
+		elementIndices.push_back(b.elementId);
+
+		cylinderModels.insert(cylinderModels.end(), b.cylinderModels.begin(), b.cylinderModels.end());
+		cylinderOffsets.push_back(cylinderModels.size());
+	}
+}
+
+/**
+ * Empty every column
+ */
+void MoleculeStore::clear() {
+	uids.clear();
+	positions.clear();
+	vanDerWaalsPositions.clear();
+	elementIndices.clear();
+	loneElectrons.clear();
+	bondedElectrons.clear();
+	bondOffsets.clear();
+	bondTargets.clear();
+	bondOrders.clear();
+	cylinderOffsets.clear();
+	cylinderModels.clear();
+	organic = false;
+}
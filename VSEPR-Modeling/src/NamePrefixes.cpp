@@ -0,0 +1,182 @@
+#include <cstdint>
+#include "iupac.h"
+
+using namespace std;
+
+// What a prefix can stand for. One spelling can be several,
+// e.g. "tri" is both a multiplier and the units of "tridec"
+enum PrefixKind : uint8_t {
+	PREFIX_CHAIN,      // A whole chain length: meth, eth ... non, hect
+	PREFIX_UNITS,      // The units of a longer chain: hen, un, do, tri, tetra...
+	PREFIX_TENS,       // The tens of a longer chain: dec, icos, triacont...
+	PREFIX_MULTIPLIER, // Multiplying prefix: di, tri, bis, tetrakis...
+	PREFIX_KINDS
+};
+
+struct PrefixWord {
+	string_view text;
+	PrefixKind kind;
+	uint8_t value;
+};
+
+static constexpr PrefixWord prefixWords[] = {
+	{"meth", PREFIX_CHAIN, 1}, {"eth", PREFIX_CHAIN, 2}, {"prop", PREFIX_CHAIN, 3},
+	{"but", PREFIX_CHAIN, 4}, {"pent", PREFIX_CHAIN, 5}, {"hex", PREFIX_CHAIN, 6},
+	{"hept", PREFIX_CHAIN, 7}, {"oct", PREFIX_CHAIN, 8}, {"non", PREFIX_CHAIN, 9},
+	{"hect", PREFIX_CHAIN, 100},
+
+	{"hen", PREFIX_UNITS, 1}, {"un", PREFIX_UNITS, 1}, {"do", PREFIX_UNITS, 2},
+	{"tri", PREFIX_UNITS, 3}, {"tetra", PREFIX_UNITS, 4}, {"penta", PREFIX_UNITS, 5},
+	{"hexa", PREFIX_UNITS, 6}, {"hepta", PREFIX_UNITS, 7}, {"octa", PREFIX_UNITS, 8},
+	{"nona", PREFIX_UNITS, 9},
+
+	{"dec", PREFIX_TENS, 10}, {"icos", PREFIX_TENS, 20}, {"eicos", PREFIX_TENS, 20},
+	{"triacont", PREFIX_TENS, 30}, {"tetracont", PREFIX_TENS, 40}, {"pentacont", PREFIX_TENS, 50},
+	{"hexacont", PREFIX_TENS, 60}, {"heptacont", PREFIX_TENS, 70}, {"octacont", PREFIX_TENS, 80},
+	{"nonacont", PREFIX_TENS, 90},
+
+	{"di", PREFIX_MULTIPLIER, 2}, {"tri", PREFIX_MULTIPLIER, 3}, {"tetra", PREFIX_MULTIPLIER, 4},
+	{"penta", PREFIX_MULTIPLIER, 5}, {"hexa", PREFIX_MULTIPLIER, 6}, {"hepta", PREFIX_MULTIPLIER, 7},
+	{"octa", PREFIX_MULTIPLIER, 8}, {"nona", PREFIX_MULTIPLIER, 9}, {"deca", PREFIX_MULTIPLIER, 10},
+	{"bis", PREFIX_MULTIPLIER, 2}, {"tris", PREFIX_MULTIPLIER, 3}, {"tetrakis", PREFIX_MULTIPLIER, 4},
+	{"pentakis", PREFIX_MULTIPLIER, 5}, {"hexakis", PREFIX_MULTIPLIER, 6}
+};
+
+/**
+ * Count the trie nodes needed for the vocabulary
+ * One per character is an upper bound, shared prefixes only save nodes
+ *
+ * @return the number of nodes to reserve
+ */
+static constexpr size_t prefixNodeBound() {
+	size_t total = 1;
+	for(const PrefixWord &word : prefixWords) {
+		total += word.text.length();
+	}
+	return total;
+}
+
+/**
+ * Trie over the prefix vocabulary, built at compile time
+ * Node 0 is the root. A child index of 0 means no child, as
+ * the root is never anyone's child. Each node holds the value of
+ * the spelling that ends there for every kind, 0 if there is none.
+ */
+struct PrefixTrie {
+	struct Node {
+		uint8_t next[26] = {};
+		uint8_t values[PREFIX_KINDS] = {};
+	};
+	Node nodes[prefixNodeBound()] = {};
+	size_t size = 1;
+
+	constexpr PrefixTrie() {
+		for(const PrefixWord &word : prefixWords) {
+			size_t node = 0;
+			for(char c : word.text) {
+				uint8_t &child = nodes[node].next[c - 'a'];
+				if(child == 0) {
+					child = size++;
+				}
+				node = child;
+			}
+			nodes[node].values[word.kind] = word.value;
+		}
+	}
+
+	constexpr size_t child(size_t node, char c) const {
+		return (c >= 'a' && c <= 'z') ? nodes[node].next[c - 'a'] : 0;
+	}
+};
+
+static_assert(prefixNodeBound() <= 256, "Prefix trie node indices must fit in a uint8_t");
+
+static constexpr PrefixTrie prefixTrie;
+
+/**
+ * Find the longest prefix of a kind starting at a position
+ *
+ * @param text the text to match in
+ * @param pos where the prefix has to start
+ * @param kind the kind of prefix to look for
+ * @param from the node to start walking from, for prefixes with an elided letter
+ * @param value set to the prefix's value
+ * @return the number of characters matched, 0 if there is no match
+ */
+static constexpr size_t longestPrefix(string_view text, size_t pos, PrefixKind kind, size_t from, int &value) {
+	size_t matched = 0;
+	size_t node = from;
+	for(size_t i = pos; i < text.length(); i++) {
+		node = prefixTrie.child(node, text[i]);
+		if(node == 0) {
+			break;
+		}
+		if(prefixTrie.nodes[node].values[kind] != 0) {
+			matched = i - pos + 1;
+			value = prefixTrie.nodes[node].values[kind];
+		}
+	}
+	return matched;
+}
+
+/**
+ * Read the length of a chain from its stem, walking the trie left to right
+ * A stem is either a simple length (meth ... non, hect) or optional
+ * units followed by tens (dec, undec, tetradec, icos, henicos,
+ * docos, dotriacont...). The "i" of icos is elided after a vowel.
+ *
+ * @param stem the stem, e.g. "pent" or "hexadec"
+ * @return the number of carbons, 0 if the stem isn't a chain length
+ */
+static constexpr int readChainLength(string_view stem) {
+	int value = 0;
+	if(longestPrefix(stem, 0, PREFIX_CHAIN, 0, value) == stem.length() && value != 0) {
+		return value;
+	}
+	if(longestPrefix(stem, 0, PREFIX_TENS, 0, value) == stem.length() && value != 0) {
+		return value;
+	}
+
+	int units = 0;
+	size_t pos = longestPrefix(stem, 0, PREFIX_UNITS, 0, units);
+	int tens = 0;
+	size_t tensLength = longestPrefix(stem, pos, PREFIX_TENS, 0, tens);
+	if(tensLength == 0 && pos > 0 && stem[pos - 1] != 'n') {
+		tensLength = longestPrefix(stem, pos, PREFIX_TENS, prefixTrie.child(0, 'i'), tens);
+	}
+	if(tensLength == 0 || pos + tensLength != stem.length()) {
+		return 0;
+	}
+	return units + tens;
+}
+
+/**
+ * Get the number of carbons a chain length stem stands for
+ *
+ * @param stem the stem, e.g. "meth" or "tetradec"
+ * @return the number of carbons, 0 if the stem isn't a chain length
+ */
+int chainLength(string_view stem) {
+	return readChainLength(stem);
+}
+
+/**
+ * Match a multiplying prefix at the start of a word
+ * The prefix has to leave something behind for the stem
+ *
+ * @param word the word
+ * @param value set to the multiplier's value
+ * @return the length of the prefix, 0 if the word doesn't start with one
+ */
+size_t multiplierPrefix(string_view word, int &value) {
+	size_t length = longestPrefix(word, 0, PREFIX_MULTIPLIER, 0, value);
+	return length < word.length() ? length : 0;
+}
+
+static_assert(readChainLength("meth") == 1 && readChainLength("eth") == 2 && readChainLength("hept") == 7);
+static_assert(readChainLength("dec") == 10 && readChainLength("undec") == 11 && readChainLength("dodec") == 12);
+static_assert(readChainLength("tetradec") == 14 && readChainLength("heptadec") == 17 && readChainLength("nonadec") == 19);
+static_assert(readChainLength("icos") == 20 && readChainLength("henicos") == 21 && readChainLength("docos") == 22);
+static_assert(readChainLength("tricos") == 23 && readChainLength("triacont") == 30 && readChainLength("dotriacont") == 32);
+static_assert(readChainLength("tetratetracont") == 44 && readChainLength("nonanonacont") == 99 && readChainLength("hect") == 100);
+static_assert(readChainLength("") == 0 && readChainLength("tetr") == 0 && readChainLength("methyl") == 0 && readChainLength("cos") == 0);
@@ -0,0 +1,188 @@
+#include <cctype>
+#include <charconv>
+#include "iupac.h"
+
+using namespace std;
+
+static const string_view parentSuffixes[] = {"ane", "ene", "yne"};
+// Must match the groups in the fragment library (see FragmentLibrary.cpp)
+static const string_view groupPrefixes[] = {"fluoro", "chloro", "bromo", "iodo"};
+
+/**
+ * Split one word of a name (the text between separators)
+ * into prefix, stem and suffix tokens
+ * A word can hold several groups when they aren't separated
+ * by a dash, e.g. "methylpropane"
+ *
+ * @param word the word
+ * @param locantCount the number of locants listed just before the word
+ * @param tokens the list to append to
+ * @return false if the word can't be tokenized
+ */
+static bool tokenizeWord(string_view word, int locantCount, pmr::vector<NameToken> &tokens) {
+	while(!word.empty()) {
+		// Only a substituent with as many locants as the multiplier
+		// says takes one, so "pentane" is never read as penta + ne
+		// and "2,3-ditridecyl" keeps the tri in its stem
+		int multiplier = 0;
+		size_t length = locantCount > 1 ? multiplierPrefix(word, multiplier) : 0;
+		if(length > 0 && multiplier == locantCount) {
+			tokens.push_back(NameToken{TOKEN_MULTIPLIER, word.substr(0, length)});
+			word.remove_prefix(length);
+		}
+		locantCount = 0;
+
+		bool group = false;
+		for(string_view prefix : groupPrefixes) {
+			if(word.substr(0, prefix.length()) == prefix) {
+				tokens.push_back(NameToken{TOKEN_GROUP, word.substr(0, prefix.length())});
+				word.remove_prefix(prefix.length());
+				group = true;
+				break;
+			}
+		}
+		if(group) {
+			continue;
+		}
+
+		if(word.substr(0, 5) == "cyclo") {
+			tokens.push_back(NameToken{TOKEN_CYCLO, word.substr(0, 5)});
+			word.remove_prefix(5);
+		}
+
+		size_t yl = word.find("yl");
+		if(yl != string_view::npos && yl > 0) {
+			tokens.push_back(NameToken{TOKEN_STEM, word.substr(0, yl)});
+			tokens.push_back(NameToken{TOKEN_SUBSTITUENT_SUFFIX, word.substr(yl, 2)});
+			word.remove_prefix(yl + 2);
+			continue;
+		}
+
+		for(string_view suffix : parentSuffixes) {
+			if(word.length() > suffix.length() && word.substr(word.length() - suffix.length()) == suffix) {
+				tokens.push_back(NameToken{TOKEN_STEM, word.substr(0, word.length() - suffix.length())});
+				tokens.push_back(NameToken{TOKEN_PARENT_SUFFIX, word.substr(word.length() - suffix.length())});
+				return true;
+			}
+		}
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Tokenize an IUPAC name in a single left to right pass
+ * Tokens are slices of the name, so it must outlive them
+ * The name is expected in lower case (see normalizeName)
+ *
+ * @param name the name, e.g. "3-ethyl-2,2-dimethylpentane"
+ * @param tokens the list to append the tokens to
+ * @return false if the name can't be tokenized
+ */
+bool tokenizeName(string_view name, pmr::vector<NameToken> &tokens) {
+	size_t pos = 0;
+	int locantCount = 0;
+	while(pos < name.length()) {
+		char c = name[pos];
+		if(c == '-' || isspace((unsigned char)c)) {
+			pos++;
+			continue;
+		}
+
+		size_t start = pos;
+		if(isdigit((unsigned char)c)) {
+			locantCount = 1;
+			while(pos < name.length() && (isdigit((unsigned char)name[pos]) || name[pos] == ',')) {
+				if(name[pos] == ',') {
+					locantCount++;
+				}
+				pos++;
+			}
+			tokens.push_back(NameToken{TOKEN_LOCANTS, name.substr(start, pos - start)});
+			continue;
+		}
+
+		while(pos < name.length() && isalpha((unsigned char)name[pos])) {
+			pos++;
+		}
+		if(pos == start || !tokenizeWord(name.substr(start, pos - start), locantCount, tokens)) {
+			return false;
+		}
+		locantCount = 0;
+	}
+	return true;
+}
+
+/**
+ * Assemble tokens into substituent groups and the parent chain
+ * Locant lists are parsed straight out of their slices
+ *
+ * @param tokens the tokens of a name, in order
+ * @param groups the list to append the groups to, parent chain last
+ * @return false if the tokens don't form a valid name
+ */
+bool groupNameTokens(const pmr::vector<NameToken> &tokens, pmr::vector<NameGroup> &groups) {
+	NameGroup current;
+	for(const NameToken &token : tokens) {
+		switch(token.type) {
+			case TOKEN_LOCANTS: {
+				if(current.locantCount > 0 || !current.stem.empty()) {
+					return false;
+				}
+				const char *p = token.text.data();
+				const char *end = p + token.text.length();
+				while(p < end) {
+					if(current.locantCount == MAX_LOCANTS) {
+						return false;
+					}
+					int locant;
+					auto result = from_chars(p, end, locant);
+					if(result.ec != errc() || locant < 1) {
+						return false;
+					}
+					current.locants[current.locantCount++] = locant;
+					p = result.ptr;
+					if(p < end && *p == ',') {
+						p++;
+					}
+				}
+				break;
+			}
+			case TOKEN_MULTIPLIER:
+				current.multiplier = token.text;
+				break;
+			case TOKEN_CYCLO:
+				current.cyclo = true;
+				break;
+			case TOKEN_STEM:
+				current.stem = token.text;
+				break;
+			case TOKEN_GROUP:
+				if(current.locantCount == 0 || current.cyclo || !current.stem.empty() || (!groups.empty() && groups.back().parent)) {
+					return false;
+				}
+				current.stem = token.text;
+				current.functionalGroup = true;
+				groups.push_back(current);
+				current = NameGroup();
+				break;
+			case TOKEN_SUBSTITUENT_SUFFIX:
+				if(current.locantCount == 0 || (!groups.empty() && groups.back().parent)) {
+					return false;
+				}
+				groups.push_back(current);
+				current = NameGroup();
+				break;
+			case TOKEN_PARENT_SUFFIX:
+				if(!groups.empty() && groups.back().parent) {
+					return false;
+				}
+				current.parent = true;
+				groups.push_back(current);
+				current = NameGroup();
+				break;
+		}
+	}
+	// Must end with exactly one parent chain
+	return !groups.empty() && groups.back().parent && current.stem.empty() && current.locantCount == 0;
+}
@@ -120,82 +120,77 @@ void fastRenderCylinder(glm::vec3 color, glm::mat4 transform, glm::mat4 rotation
  * Compounds with single central atoms including
  * polyatomic ions are currently supported
  * 
- * @param structure the compound's structure
+ * @param structure the compound's columns
  * @param rotationModel the camera rotation model
  * @param shader the shader for atoms
  * @param rep which representation to render
  */
-void renderSimpleCompound(std::vector<BondedElement> structure, glm::mat4 rotationModel, Shader shader, int rep) {
+void renderSimpleCompound(const MoleculeStore &structure, glm::mat4 rotationModel, Shader shader, int rep) {
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	int configIndex;
-
-	// Determine VSEPR config
-	if(structure.size() > 2) {
-		configIndex = structure.size() - 2 + (structure[0].loneElectrons/2);
-	}
-	else {
-		configIndex = structure.size() - 2;
-	}
+	const DomainGeometry *geometry = domainGeometry(structure.size() - 1, structure.loneElectrons[0]/2);
 
     if(rep == 0) {
-        for (int i = 0; i < structure.size() + (structure[0].loneElectrons/2); i++) {
+        const Element &central = structure.element(0);
+        int slots = geometry != nullptr ? geometry->domains + 1 : structure.size();
+        for (int i = 0; i < slots; i++) {
             glm::mat4 model;
             // Check if drawing an atom or lone pair
             if(i < structure.size()) {
-                BondedElement b = structure[i];
-                glm::vec3 pos = b.position;
-                if (b.base.name == "hydrogen") {
+                const Element &e = structure.element(i);
+                glm::vec3 pos = structure.positions[i];
+                if (structure.elementIndices[i] == HYDROGEN) {
                     pos /= 0.7;
                 }
                 model *= rotationModel;
                 model = glm::translate(model, pos);
-                model = glm::scale(model, glm::vec3(b.base.atomicRadius > 0 ? structure[i].base.atomicRadius : 0.8f));
-                shader.setVec3("color", b.base.color);
+                model = glm::scale(model, glm::vec3(e.atomicRadius > 0 ? e.atomicRadius : 0.8f));
+                shader.setVec3("color", e.color);
                 shader.setMat4("model", model);
                 sphere.draw();
             }
             else {
-                glm::vec3 lonePairPos = configurations[configIndex][i - 1] * getStickDistance();
+                glm::vec3 lonePairPos = geometry->direction(i - 1) * getStickDistance();
                 model *= rotationModel;
                 model = glm::translate(model, lonePairPos);
-                model = glm::scale(model, glm::vec3(structure[0].base.atomicRadius > 0 ? structure[0].base.atomicRadius : 0.8f));
-                shader.setVec3("color", structure[0].base.color);
+                model = glm::scale(model, glm::vec3(central.atomicRadius > 0 ? central.atomicRadius : 0.8f));
+                shader.setVec3("color", central.color);
                 shader.setMat4("model", model);
                 sphere.drawLines(lineColor);
             }
         }
     }
     if(rep == 1) {
-        for(BondedElement b : structure) {
+        for(size_t i = 0; i < structure.size(); i++) {
+            const Element &e = structure.element(i);
             glm::mat4 model;
-            glm::vec3 pos = b.vanDerWaalsPosition;
             model *= rotationModel;
-            model = glm::translate(model, pos);
-            model = glm::scale(model, glm::vec3(b.base.vanDerWaalsRadius));
+            model = glm::translate(model, structure.vanDerWaalsPositions[i]);
+            model = glm::scale(model, glm::vec3(e.vanDerWaalsRadius));
             shader.setMat4("model", model);
-            shader.setVec3("color", b.base.color);
+            shader.setVec3("color", e.color);
             sphere.draw();
         }
     }
     if(rep == 2) {
-        for(BondedElement b : structure) {
-            for (glm::mat4 m : b.cylinderModels) {
-                fastRenderCylinder(b.base.color, m, rotationModel, shader, false);
+        for(size_t i = 0; i < structure.size(); i++) {
+            const Element &e = structure.element(i);
+            for (uint32_t c = structure.cylinderOffsets[i]; c < structure.cylinderOffsets[i + 1]; c++) {
+                fastRenderCylinder(e.color, structure.cylinderModels[c], rotationModel, shader, false);
             }
             glBindVertexArray(sphereVAO);
             glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
             glm::mat4 model;
             model *= rotationModel;
-            if(b.base.name == "hydrogen") {
-                model = glm::translate(model, b.position);
+            if(structure.elementIndices[i] == HYDROGEN) {
+                model = glm::translate(model, structure.positions[i]);
                 model = glm::scale(model, glm::vec3(0.75f));
             }
             else {
-                model = glm::translate(model, b.position);
+                model = glm::translate(model, structure.positions[i]);
                 model = glm::scale(model, glm::vec3(1.0f)); 
             }
             shader.setMat4("model", model);
-            shader.setVec3("color", b.base.color);
+            shader.setVec3("color", e.color);
             sphere.draw();
         }
     }
@@ -204,12 +199,12 @@ void renderSimpleCompound(std::vector<BondedElement> structure, glm::mat4 rotati
 /**
  * Renders an organic compound (so far only saturated hydrocarbons)
  * 
- * @param structure the compound's structure as a vector of compounds
+ * @param structure the compound's columns
  * @param shader the shader program for atoms
  * @param rotationModel the camera rotation model
  * @param rep which representation to render
  */
-void renderOrganic(std::vector<BondedElement> structure, Shader shader, glm::mat4 rotationModel, int rep) {
+void renderOrganic(const MoleculeStore &structure, Shader shader, glm::mat4 rotationModel, int rep) {
     glm::quat rotationQuat = glm::quat_cast(rotationModel);
     shader.use();
     bool fast = false;
@@ -225,14 +220,14 @@ void renderOrganic(std::vector<BondedElement> structure, Shader shader, glm::mat
         return;
     }
     if(rep == 1) {
-        for(BondedElement b : structure) {
+        for(size_t i = 0; i < structure.size(); i++) {
+            const Element &e = structure.element(i);
             glm::mat4 model;
-            glm::vec3 pos = b.vanDerWaalsPosition;
             model *= rotationModel;
-            model = glm::translate(model, pos);
-            model = glm::scale(model, glm::vec3(b.base.vanDerWaalsRadius));
+            model = glm::translate(model, structure.vanDerWaalsPositions[i]);
+            model = glm::scale(model, glm::vec3(e.vanDerWaalsRadius));
             shader.setMat4("model", model);
-            shader.setVec3("color", b.base.color);
+            shader.setVec3("color", e.color);
             if(fast) {
                 sphere_fast.draw();
             } else {
@@ -241,9 +236,10 @@ void renderOrganic(std::vector<BondedElement> structure, Shader shader, glm::mat
         }
     }
     if(rep == 2) {
-        for(BondedElement b : structure) {
-            for (glm::mat4 m : b.cylinderModels) {
-                fastRenderCylinder(b.base.color, m, rotationModel, shader, fast);
+        for(size_t i = 0; i < structure.size(); i++) {
+            const Element &e = structure.element(i);
+            for (uint32_t c = structure.cylinderOffsets[i]; c < structure.cylinderOffsets[i + 1]; c++) {
+                fastRenderCylinder(e.color, structure.cylinderModels[c], rotationModel, shader, fast);
             }
             if(fast) {
                 glBindVertexArray(fastSphereVAO);
@@ -254,16 +250,16 @@ void renderOrganic(std::vector<BondedElement> structure, Shader shader, glm::mat
             }
             glm::mat4 model;
             model *= rotationModel;
-            if(b.base.name == "hydrogen") {
-                model = glm::translate(model, b.position);
+            if(structure.elementIndices[i] == HYDROGEN) {
+                model = glm::translate(model, structure.positions[i]);
                 model = glm::scale(model, glm::vec3(0.75f));
             }
             else {
-                model = glm::translate(model, b.position);
+                model = glm::translate(model, structure.positions[i]);
                 model = glm::scale(model, glm::vec3(1.0f)); 
             }
             shader.setMat4("model", model);
-            shader.setVec3("color", b.base.color);
+            shader.setVec3("color", e.color);
             if(fast) {
                 sphere_fast.draw();
             } else {
@@ -282,7 +278,7 @@ void renderOrganic(std::vector<BondedElement> structure, Shader shader, glm::mat
  * @param model the compound structure
  * @param rotationModel the camera rotation
  */
-void renderElectrons(Shader program, Shader &atomProgram, std::vector<BondedElement> model, glm::mat4 rotationModel) {
+void renderElectrons(Shader program, Shader &atomProgram, const std::vector<BondedElement> &model, glm::mat4 rotationModel) {
 	program.use();
 	//glBindVertexArray(lightVAO);
 
@@ -296,22 +292,14 @@ void renderElectrons(Shader program, Shader &atomProgram, std::vector<BondedElem
 	if (VSEPRModel.size() > 0)
 	{
 		int numberOfBonds = VSEPRModel[0].bondedElectrons/2;
-		int configIndex;
-		if (VSEPRModel.size() > 2)
-		{
-			configIndex = VSEPRModel.size() - 2 + (VSEPRModel[0].loneElectrons/2);
-		}
-		else
-		{
-			configIndex = 0;
-		}
+		const DomainGeometry *geometry = domainGeometry(VSEPRModel.size() - 1, VSEPRModel[0].loneElectrons/2);
 		int lightIndex = 0;
 		for (int i = 1; i < VSEPRModel.size(); i++)
 		{
 			for (int x = 0; x < VSEPRModel[i].bondedElectrons/2; x++)
 			{
 				lightModel = glm::mat4();
-				glm::vec3 newLightPos = calculateOrbitPosition(VSEPRModel[0], VSEPRModel[i], configIndex, i, x, VSEPRModel[i].bondedElectrons/2, false);
+				glm::vec3 newLightPos = calculateOrbitPosition(VSEPRModel[0], VSEPRModel[i], geometry, i, x, VSEPRModel[i].bondedElectrons/2, false);
 				setPointLightPosition(lightIndex, atomProgram, newLightPos);
 				program.use();
 				lightModel *= rotationModel;
@@ -323,7 +311,7 @@ void renderElectrons(Shader program, Shader &atomProgram, std::vector<BondedElem
 
 				//Draw complimentary
 				lightModel = glm::mat4();
-				newLightPos = calculateOrbitPosition(VSEPRModel[0], VSEPRModel[i], configIndex, i, x, VSEPRModel[i].bondedElectrons/2, true);
+				newLightPos = calculateOrbitPosition(VSEPRModel[0], VSEPRModel[i], geometry, i, x, VSEPRModel[i].bondedElectrons/2, true);
 				setPointLightPosition(lightIndex, atomProgram, newLightPos);
 				program.use();
 				lightModel *= rotationModel;
@@ -1,67 +1,30 @@
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
 #include "VSEPR.h"
+#include "domains.h"
 #include "OpenGLHeaders/shader.h"
 #include "render.h"
 #include "Sphere.h"
 #include "cylinder.h"
 #include "glm/gtc/matrix_transform.hpp"
 
-/**
- * Get the bond distance between two atoms
- * 
- * @param model the compound structure
- * @param index the index of the peripheral atom
- * @param order the bond order
- * @return the bond distance
- */
-float getSphereDistance(std::vector<BondedElement> model, int index, int order) {
-	// Schomaker and Stevenson formula for bond length (not used with current data)
-	// return model[0].base.covalentRadius + model[index].base.covalentRadius - 0.09 * abs(model[0].base.electronegativity - model[index].base.electronegativity);
-
-	// Sum of covalent radii based on bond order
-	return (model[0].base.covalentRadii[order-1] + model[index].base.covalentRadii[order-1])/100;
-}
-
-/**
- * Get the bond distance between two atoms
- * 
- * @param a the first element
- * @param b the second element
- * @param order the bond order
- * @return the bond distance
- */
-float getSphereDistance(BondedElement a, BondedElement b, int order) {
-	return (a.base.covalentRadii[order-1] + b.base.covalentRadii[order-1])/100;
-}
-
-/**
- * Get the atomic distance for ball-and-stick models
- * 
- * @return the distance
- */
-float getStickDistance() {
-	return atomDistance;
-}
+const float electronSpeed = 3;
 
 /**
  * Get the matrix to properly position a cylinder
  * for ball-and-stick models
  * 
- * @param configIndex the VSEPR configuration index
- * @param modelIndex the bond index within the VSEPR config
+ * @param geometry the arrangement of the central atom's domains
+ * @param modelIndex the bond index within the arrangement
  * @param bondOrder a pair describing bond orders
  *                  [0] = total bond order
  *                  [1] = the bond this cylinder is for
  * @param rotationModel the rotation of the system at large
  * @return the final transformation for the described cylinder
  */
-glm::mat4 getCylinderRotation(int configIndex, int modelIndex, std::pair<int, int> bondOrder, glm::mat4 rotationModel) {
-	glm::vec3 target = configurations[configIndex][modelIndex];
-	glm::vec3 direction = glm::vec3(glm::vec4(target, 0.0f));
-	
-	glm::mat4 rotMatrix;
-	rotMatrix = glm::toMat4(RotationBetweenVectors(glm::vec3(0.0f, 1.0f, 0.0f) * atomDistance, direction * atomDistance));
+glm::mat4 getCylinderRotation(const DomainGeometry &geometry, int modelIndex, std::pair<int, int> bondOrder, glm::mat4 rotationModel) {
+	glm::vec3 direction = geometry.direction(modelIndex);
+	glm::mat4 rotMatrix = geometry.cylinder(modelIndex);
 	rotMatrix = getCylinderOffset(bondOrder, rotationModel, direction, rotMatrix);
 
 	return rotMatrix;
@@ -149,16 +112,16 @@ glm::quat RotationBetweenVectors(glm::vec3 start, glm::vec3 dest) {
  * 
  * @param central the central atom of the compound
  * @param bonded the peripheral atom also in the bond
- * @param configIndex the index of the VSEPR configuration
- * @param modelIndex the index of the bond within the VSEPR config
+ * @param geometry the arrangement of the central atom's domains
+ * @param modelIndex the index of the bond within the arrangement
  * @param offset which bond within the total order the elctron belongs to
  * @param offsetTotal the total bond order
  * @param pair whether its the first or second electron in a pair
  * @return the current position of the described electron
 */
-glm::vec3 calculateOrbitPosition(BondedElement central, BondedElement bonded, int configIndex, int modelIndex, int offset, int offsetTotal, bool pair) {
-	float largerAR = central.base.atomicRadius;
-	float smallerAR = bonded.base.atomicRadius;
+glm::vec3 calculateOrbitPosition(const BondedElement &central, const BondedElement &bonded, const DomainGeometry *geometry, int modelIndex, int offset, int offsetTotal, bool pair) {
+	float largerAR = central.base().atomicRadius;
+	float smallerAR = bonded.base().atomicRadius;
 	if(largerAR < smallerAR) {
 		float holdAR = largerAR;
 		largerAR = smallerAR;
@@ -172,10 +135,9 @@ glm::vec3 calculateOrbitPosition(BondedElement central, BondedElement bonded, in
 	float distance = atomDistance;
 	float y = distance * cos((float)(glfwGetTime() - xOffset) * (electronSpeed / 2)) + distance / 2;
 
-	if(modelIndex-1 >= configurations[configIndex].size() || configIndex >= configurations.size()) {
+	if(geometry == nullptr || modelIndex-1 >= geometry->domains) {
 		return glm::vec3(0.0f);
 	}
-	glm::vec3 direction = configurations[configIndex][modelIndex - 1];
 	glm::mat4 transform;
 	glm::vec4 v = glm::vec4(x, y, 0.0f, 0.0f);
 	
@@ -184,7 +146,7 @@ glm::vec3 calculateOrbitPosition(BondedElement central, BondedElement bonded, in
 	}
 	transform = glm::rotate(transform, (PI)/offsetTotal * offset, glm::vec3(0.0f, 1.0f, 0.0f));
 	v = v * transform;
-	transform = glm::toMat4(RotationBetweenVectors(glm::vec3(0.0f, 1.0f, 0.0f) * distance, direction * distance));
+	transform = geometry->cylinder(modelIndex - 1);
 	transform = glm::rotate(transform, 180.0f * (PI/ 180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 	v = v * transform;
 
@@ -226,35 +188,3 @@ void setPointLightPosition(int index, Shader &program, glm::vec3 pos) {
 	program.use();
 	program.setVec3(POINT_LIGHT_LIST(index, POSITION), pos);
 }
-
-/**
- * Check for a unique id in a list
- * 
- * @param id the id to search for
- * @param list the list to parse
- * @return whether a match was found
- */
-bool containsUID(uint32_t id, std::vector<uint32_t> list) {
-    for(uint32_t i : list) {
-        if(i == id) {
-            return true;
-        }
-    }
-    return false;
-}
-
-/**
- * Find an element by id in a group of neigbours
- * 
- * @param key the id of the neighbour element to find
- * @param group the group of neighbours to parse
- * @return the found element or a blank one if no match 
- */
-BondedElement findNeighbour(uint32_t key, std::vector<BondedElement> group) {
-    for(BondedElement b : group) {
-        if(key == b.getUID()) {
-            return b;
-        }
-    }
-    return BondedElement();
-}
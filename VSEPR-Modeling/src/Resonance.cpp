@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include "resonance.h"
+
+using namespace std;
+
+/**
+ * What every search over one structure's contributors shares
+ * Every atom keeps the electrons around it (twice its bond orders
+ * plus its lone electrons), so raising a bond's order takes a lone
+ * pair from each end and the bond orders keep their total.
+ * Contributors must carry as much formal charge in total as the
+ * structure they came from.
+ */
+struct ResonanceProblem {
+	vector<BondEdge> bonds;     // The bonds whose order can change
+	vector<int> shells;         // Electrons around each atom
+	vector<int> valences;
+	vector<int> fixedBonds;     // Bond orders of each atom that can't change
+	vector<uint8_t> closesFirst;  // Whether bond e is the last changeable bond of its first atom
+	vector<uint8_t> closesSecond; // and of its second
+	int fixedCharge = 0;        // Formal charge on atoms with no changeable bonds
+	int targetCharge = 0;
+	int orderTotal = 0;
+};
+
+/**
+ * Depth first search over the orders of the bonds that can change
+ * An atom's formal charge is known once its last changeable bond is
+ * set, so branches are cut as soon as the closed atoms carry more
+ * formal charge than the structure does. Bonds are set in order, so
+ * every contributor is reached once and no two are the same.
+ * Searches can stop at a depth to hand out the subtrees below it.
+ * Each search stops after RESONANCE_MAX_CONTRIBUTORS contributors of
+ * its own, so what it finds doesn't depend on any other search.
+ */
+struct ResonanceSearch {
+	ResonanceProblem &problem;
+	size_t depthLimit;
+	vector<int> bondSums;
+	vector<uint8_t> orders;
+	int charge;
+	int orderSoFar = 0;
+	size_t found = 0;
+
+	ResonanceSearch(ResonanceProblem &problem, size_t depthLimit) : problem(problem), depthLimit(depthLimit), bondSums(problem.fixedBonds), orders(problem.bonds.size(), 0), charge(problem.fixedCharge) {}
+
+	int closedCharge(int atom) const {
+		return abs(problem.valences[atom] - problem.shells[atom] + bondSums[atom]);
+	}
+
+	/**
+	 * Give the next bond an order if that can still lead to a contributor
+	 *
+	 * @param e the index of the bond
+	 * @param order its order
+	 * @return false, with nothing changed, if no contributor has it
+	 */
+	bool apply(size_t e, int order) {
+		const BondEdge &bond = problem.bonds[e];
+		size_t left = problem.bonds.size() - e - 1;
+		if(2*(bondSums[bond.a] + order) > problem.shells[bond.a] || 2*(bondSums[bond.b] + order) > problem.shells[bond.b]) {
+			return false;
+		}
+		if(orderSoFar + order + (int)left > problem.orderTotal || orderSoFar + order + 3*(int)left < problem.orderTotal) {
+			return false;
+		}
+		bondSums[bond.a] += order;
+		bondSums[bond.b] += order;
+		int closed = (problem.closesFirst[e] ? closedCharge(bond.a) : 0) + (problem.closesSecond[e] ? closedCharge(bond.b) : 0);
+		if(charge + closed > problem.targetCharge) {
+			bondSums[bond.a] -= order;
+			bondSums[bond.b] -= order;
+			return false;
+		}
+		charge += closed;
+		orderSoFar += order;
+		orders[e] = order;
+		return true;
+	}
+
+	void undo(size_t e) {
+		const BondEdge &bond = problem.bonds[e];
+		int closed = (problem.closesFirst[e] ? closedCharge(bond.a) : 0) + (problem.closesSecond[e] ? closedCharge(bond.b) : 0);
+		charge -= closed;
+		orderSoFar -= orders[e];
+		bondSums[bond.a] -= orders[e];
+		bondSums[bond.b] -= orders[e];
+		orders[e] = 0;
+	}
+
+	/**
+	 * Collect every contributor, or every subtree at the depth limit,
+	 * below a node
+	 *
+	 * @param e the index of the next bond to set
+	 * @param out where to add the bond orders found
+	 */
+	void search(size_t e, vector<vector<uint8_t>> &out) {
+		if(found >= RESONANCE_MAX_CONTRIBUTORS) {
+			return;
+		}
+		if(e == depthLimit) {
+			if(e < problem.bonds.size()) {
+				out.emplace_back(orders.begin(), orders.begin() + e);
+			}
+			else if(charge == problem.targetCharge) {
+				out.push_back(orders);
+				found++;
+			}
+			return;
+		}
+		for(int order = 1; order <= 3; order++) {
+			if(apply(e, order)) {
+				search(e + 1, out);
+				undo(e);
+			}
+		}
+	}
+};
+
+/**
+ * Find every resonance contributor of a structure: each way of
+ * placing its bonds and lone pairs on the same skeleton that keeps
+ * every atom's electron count and the total formal charge
+ * Only bonds between atoms that can take a bond beyond a single bond
+ * to each neighbour are searched. Large systems are split into
+ * subtrees that a pool of threads takes from a shared queue, and the
+ * results are put back together in the order one thread would find them.
+ * Only the first RESONANCE_MAX_CONTRIBUTORS in that order are kept, so
+ * the set is the same for any number of threads.
+ *
+ * @param structure the compound's structure, bonds and lone electrons filled in
+ * @param threads the number of threads to search on, 0 for one per core
+ * @return the bonds that can change and their orders in each contributor
+ */
+ResonanceSet enumerateResonance(const vector<BondedElement> &structure, unsigned int threads) {
+	BondGraph graph(structure);
+	size_t n = graph.size();
+	ResonanceProblem problem;
+	problem.shells.resize(n);
+	problem.valences.resize(n);
+	problem.fixedBonds.resize(n);
+	vector<uint8_t> flexible(n);
+	for(size_t i = 0; i < n; i++) {
+		int bondSum = 0;
+		for(uint32_t k = 0; k < graph.degree(i); k++) {
+			bondSum += graph.order(i, k);
+		}
+		problem.shells[i] = structure[i].loneElectrons + 2*bondSum;
+		problem.valences[i] = structure[i].base().valenceNumber;
+		problem.fixedBonds[i] = bondSum;
+		flexible[i] = problem.shells[i] / 2 > (int)graph.degree(i);
+		problem.targetCharge += abs(problem.valences[i] - problem.shells[i] + bondSum);
+	}
+
+	vector<int> lastBond(n, -1);
+	for(const BondEdge &edge : graph.edges) {
+		if(flexible[edge.a] && flexible[edge.b]) {
+			lastBond[edge.a] = lastBond[edge.b] = problem.bonds.size();
+			problem.fixedBonds[edge.a] -= edge.order;
+			problem.fixedBonds[edge.b] -= edge.order;
+			problem.orderTotal += edge.order;
+			problem.bonds.push_back(edge);
+		}
+	}
+	for(size_t i = 0; i < n; i++) {
+		if(lastBond[i] < 0) {
+			problem.fixedCharge += abs(problem.valences[i] - problem.shells[i] + problem.fixedBonds[i]);
+		}
+	}
+	for(size_t e = 0; e < problem.bonds.size(); e++) {
+		problem.closesFirst.push_back(lastBond[problem.bonds[e].a] == (int)e);
+		problem.closesSecond.push_back(lastBond[problem.bonds[e].b] == (int)e);
+	}
+
+	ResonanceSet result;
+	size_t bondCount = problem.bonds.size();
+	if(threads == 0) {
+		threads = max(1u, thread::hardware_concurrency());
+	}
+	if(bondCount < RESONANCE_PARALLEL_MIN_BONDS || threads == 1) {
+		ResonanceSearch search(problem, bondCount);
+		search.search(0, result.contributors);
+		result.bonds = std::move(problem.bonds);
+		return result;
+	}
+
+	// Go deep enough that every thread has several subtrees to take
+	vector<vector<uint8_t>> tasks(1);
+	size_t depth = 0;
+	while(tasks.size() < threads * RESONANCE_TASKS_PER_THREAD && depth < bondCount) {
+		depth++;
+		tasks.clear();
+		ResonanceSearch search(problem, depth);
+		search.search(0, tasks);
+	}
+
+	// Once the finished tasks at the front hold enough contributors,
+	// the tasks after them can't add any that are kept
+	vector<vector<vector<uint8_t>>> found(tasks.size());
+	vector<uint8_t> finished(tasks.size(), 0);
+	size_t finishedFront = 0;
+	size_t frontContributors = 0;
+	mutex frontLock;
+	atomic<size_t> cutoff(tasks.size());
+	atomic<size_t> next(0);
+	auto worker = [&]() {
+		for(size_t t = next++; t < tasks.size() && t < cutoff.load(); t = next++) {
+			ResonanceSearch search(problem, bondCount);
+			for(size_t e = 0; e < tasks[t].size(); e++) {
+				search.apply(e, tasks[t][e]);
+			}
+			search.search(tasks[t].size(), found[t]);
+
+			lock_guard<mutex> lock(frontLock);
+			finished[t] = 1;
+			while(finishedFront < tasks.size() && finished[finishedFront]) {
+				frontContributors += found[finishedFront++].size();
+			}
+			if(frontContributors >= RESONANCE_MAX_CONTRIBUTORS && finishedFront < cutoff.load()) {
+				cutoff.store(finishedFront);
+			}
+		}
+	};
+
+	unsigned int poolSize = min<size_t>(threads, tasks.size());
+	vector<thread> pool;
+	pool.reserve(poolSize);
+	for(unsigned int t = 1; t < poolSize; t++) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for(thread &t : pool) {
+		t.join();
+	}
+
+	for(vector<vector<uint8_t>> &taskContributors : found) {
+		for(vector<uint8_t> &orders : taskContributors) {
+			if(result.contributors.size() == RESONANCE_MAX_CONTRIBUTORS) {
+				break;
+			}
+			result.contributors.push_back(std::move(orders));
+		}
+	}
+	result.bonds = std::move(problem.bonds);
+	return result;
+}
+
+/**
+ * Average the orders of bonds that differ between resonance
+ * contributors, e.g. each N-O bond of NO3- becomes 4/3
+ * Those bonds are flagged as resonance and get their average order,
+ * which generateCylinders draws instead of the structure's own order.
+ * The structure's orders and lone electrons are left as they are.
+ *
+ * @param structure the compound's structure, updated in place
+ * @param threads the number of threads to search on, 0 for one per core
+ * @return the number of contributors
+ */
+size_t averageResonance(vector<BondedElement> &structure, unsigned int threads) {
+	ResonanceSet set = enumerateResonance(structure, threads);
+	size_t count = set.contributors.size();
+	if(count < 2) {
+		return count;
+	}
+	for(size_t e = 0; e < set.bonds.size(); e++) {
+		const BondEdge &edge = set.bonds[e];
+		int sum = 0;
+		bool varies = false;
+		for(const vector<uint8_t> &orders : set.contributors) {
+			sum += orders[e];
+			varies = varies || orders[e] != set.contributors[0][e];
+		}
+		if(!varies) {
+			continue;
+		}
+		float average = (float)sum / count;
+		BondedElement &a = structure[edge.a];
+		BondedElement &b = structure[edge.b];
+		for(Bond &bond : a.bonds) {
+			if(bond.uid == b.getUID()) {
+				bond.resonance = true;
+				bond.averageOrder = average;
+			}
+		}
+		for(Bond &bond : b.bonds) {
+			if(bond.uid == a.getUID()) {
+				bond.resonance = true;
+				bond.averageOrder = average;
+			}
+		}
+	}
+	return count;
+}
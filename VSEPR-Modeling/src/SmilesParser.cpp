@@ -0,0 +1,575 @@
+#include <cctype>
+#include <cstdlib>
+#include "smiles.h"
+#include "molecule.h"
+#include "context.h"
+
+using namespace std;
+
+// Ring closure labels are 0-9, or %10-%99
+#define SMILES_RING_LABELS 100
+// Give up on assigning double bonds to an aromatic system after this many tries
+#define KEKULE_STEP_LIMIT (1 << 20)
+
+/**
+ * Make a build error pointing at a position in a SMILES string
+ *
+ * @param message what's wrong
+ * @param pos the index of the offending character
+ * @return the error
+ */
+static BuildError smilesError(const char *message, size_t pos) {
+	return BuildError(BUILD_ERROR_SMILES_SYNTAX, "SMILES error: " + string(message) + " at position " + to_string(pos + 1));
+}
+
+/**
+ * Check whether a line of input is a SMILES string
+ *
+ * @param input the line
+ * @return true if it starts with SMILES_PREFIX
+ */
+bool isSmilesInput(const string &input) {
+	return input.compare(0, sizeof(SMILES_PREFIX) - 1, SMILES_PREFIX) == 0;
+}
+
+/**
+ * Add an atom to a molecule, bonding it to the previous atom
+ *
+ * @param molecule the molecule being read
+ * @param elementId the atom's element
+ * @param annotation the atom's charge, hydrogens and aromaticity
+ * @param previous the atom to bond to, -1 for none
+ * @param order the order of the bond, 0 if none was written
+ * @param aromatic whether an aromatic bond (':') was written
+ * @return the new atom's index
+ */
+static int addSmilesAtom(SmilesMolecule &molecule, int elementId, const SmilesAtom &annotation, int previous, int order, bool aromatic) {
+	molecule.atoms.emplace_back(0, 0, elementTable[elementId]);
+	molecule.annotations.push_back(annotation);
+	int index = molecule.atoms.size() - 1;
+	if(previous >= 0) {
+		BondedElement &a = molecule.atoms[previous];
+		BondedElement &b = molecule.atoms[index];
+		// Unwritten bonds between aromatic atoms are aromatic
+		bool resonance = aromatic || (order == 0 && annotation.aromatic && molecule.annotations[previous].aromatic);
+		uint8_t bondOrder = order == 0 ? 1 : order;
+		a.bonds.push_back(Bond{b.getUID(), bondOrder, resonance});
+		b.bonds.push_back(Bond{a.getUID(), bondOrder, resonance});
+	}
+	return index;
+}
+
+/**
+ * Read the contents of a bracket atom, e.g. [NH4+] or [13C@@H]
+ *
+ * @param text the SMILES string
+ * @param pos the index just past the '[', moved past the ']'
+ * @param elementId set to the atom's element
+ * @param annotation set to the atom's charge, hydrogens and aromaticity
+ * @return the error if the atom can't be read
+ */
+static BuildError readBracketAtom(string_view text, size_t &pos, int &elementId, SmilesAtom &annotation) {
+	size_t start = pos;
+	// Isotopes don't change the structure
+	while(pos < text.length() && isdigit((unsigned char)text[pos])) {
+		pos++;
+	}
+	if(pos >= text.length()) {
+		return smilesError("unclosed bracket atom", start - 1);
+	}
+
+	char symbol[2] = {(char)toupper((unsigned char)text[pos]), 0};
+	annotation.aromatic = islower((unsigned char)text[pos]);
+	if(!isalpha((unsigned char)text[pos])) {
+		return smilesError("expected an element symbol", pos);
+	}
+	elementId = -1;
+	if(pos + 1 < text.length() && islower((unsigned char)text[pos + 1])) {
+		symbol[1] = text[pos + 1];
+		elementId = findElementId(string_view(symbol, 2));
+		if(elementId > 0 && annotation.aromatic && symbol[0] != 'S' && symbol[0] != 'A' && symbol[0] != 'T') {
+			// Only se, as and te are two letter aromatic symbols
+			elementId = -1;
+		}
+		if(elementId > 0) {
+			pos++;
+		}
+	}
+	if(elementId <= 0) {
+		elementId = findElementId(string_view(symbol, 1));
+	}
+	if(elementId <= 0) {
+		return smilesError("unknown element", pos);
+	}
+	pos++;
+
+	// Chirality doesn't change the bonding, skip it (@, @@, @TH1, @OH12...)
+	bool chiral = false;
+	while(pos < text.length() && text[pos] == '@') {
+		chiral = true;
+		pos++;
+	}
+	if(chiral && pos + 2 < text.length() && isupper((unsigned char)text[pos]) && isupper((unsigned char)text[pos + 1]) && isdigit((unsigned char)text[pos + 2])) {
+		pos += 2;
+		while(pos < text.length() && isdigit((unsigned char)text[pos])) {
+			pos++;
+		}
+	}
+
+	annotation.hydrogens = 0;
+	if(pos < text.length() && text[pos] == 'H') {
+		annotation.hydrogens = 1;
+		pos++;
+		if(pos < text.length() && isdigit((unsigned char)text[pos])) {
+			annotation.hydrogens = text[pos++] - '0';
+		}
+	}
+
+	if(pos < text.length() && (text[pos] == '+' || text[pos] == '-')) {
+		char sign = text[pos++];
+		int charge = 1;
+		if(pos < text.length() && isdigit((unsigned char)text[pos])) {
+			charge = 0;
+			while(pos < text.length() && isdigit((unsigned char)text[pos])) {
+				charge = charge * 10 + (text[pos++] - '0');
+				if(charge > 15) {
+					return smilesError("charge out of range", pos - 1);
+				}
+			}
+		}
+		else {
+			while(pos < text.length() && text[pos] == sign) {
+				charge++;
+				pos++;
+			}
+		}
+		annotation.charge = sign == '+' ? charge : -charge;
+	}
+
+	// Atom classes are only labels
+	if(pos < text.length() && text[pos] == ':') {
+		pos++;
+		while(pos < text.length() && isdigit((unsigned char)text[pos])) {
+			pos++;
+		}
+	}
+
+	if(pos >= text.length() || text[pos] != ']') {
+		return smilesError("unclosed bracket atom", start - 1);
+	}
+	pos++;
+	return BuildError();
+}
+
+/**
+ * Read a SMILES string into atoms and bonds in a single pass
+ * Handles the organic subset, bracket atoms (isotopes, chirality,
+ * hydrogen counts, charges and classes), bond orders, branches,
+ * ring closures and disconnected parts ('.'). Isotopes, chirality
+ * and bond directions are read but don't change the structure.
+ * Reading stops at the first whitespace.
+ *
+ * @param text the SMILES string, e.g. "CC(=O)O"
+ * @param molecule the molecule to add the atoms to
+ * @return an error naming the position of the first mistake, if any
+ */
+BuildError parseSmiles(string_view text, SmilesMolecule &molecule) {
+	struct RingBond {
+		int atom = -1;
+		int order;
+		bool aromatic;
+	};
+	RingBond rings[SMILES_RING_LABELS];
+	int openRings = 0;
+	vector<int> branches;
+
+	molecule.atoms.reserve(molecule.atoms.size() + text.length());
+	molecule.annotations.reserve(molecule.annotations.size() + text.length());
+
+	int previous = -1;
+	int order = 0;
+	bool aromatic = false;
+	size_t pos = 0;
+	while(pos < text.length()) {
+		char c = text[pos];
+		if(isspace((unsigned char)c)) {
+			break;
+		}
+
+		int bondOrder = 0;
+		switch(c) {
+			case '-': case '/': case '\\':
+				bondOrder = 1;
+				break;
+			case ':':
+				bondOrder = 1;
+				aromatic = true;
+				break;
+			case '=':
+				bondOrder = 2;
+				break;
+			case '#':
+				bondOrder = 3;
+				break;
+			case '$':
+				bondOrder = 4;
+				break;
+		}
+		if(bondOrder != 0) {
+			if(previous < 0 || order != 0) {
+				return smilesError("unexpected bond", pos);
+			}
+			order = bondOrder;
+			pos++;
+			continue;
+		}
+
+		if(c == '(') {
+			if(previous < 0 || order != 0) {
+				return smilesError("unexpected branch", pos);
+			}
+			branches.push_back(previous);
+			pos++;
+			continue;
+		}
+		if(c == ')') {
+			if(branches.empty() || order != 0) {
+				return smilesError("unexpected ')'", pos);
+			}
+			previous = branches.back();
+			branches.pop_back();
+			pos++;
+			continue;
+		}
+		if(c == '.') {
+			if(previous < 0 || order != 0 || !branches.empty()) {
+				return smilesError("unexpected '.'", pos);
+			}
+			previous = -1;
+			pos++;
+			continue;
+		}
+
+		if(isdigit((unsigned char)c) || c == '%') {
+			if(previous < 0) {
+				return smilesError("ring closure without an atom", pos);
+			}
+			int label;
+			if(c == '%') {
+				if(pos + 2 >= text.length() || !isdigit((unsigned char)text[pos + 1]) || !isdigit((unsigned char)text[pos + 2])) {
+					return smilesError("expected two digits after '%'", pos);
+				}
+				label = (text[pos + 1] - '0') * 10 + (text[pos + 2] - '0');
+				pos += 3;
+			}
+			else {
+				label = c - '0';
+				pos++;
+			}
+
+			RingBond &ring = rings[label];
+			if(ring.atom < 0) {
+				ring.atom = previous;
+				ring.order = order;
+				ring.aromatic = aromatic;
+				openRings++;
+			}
+			else {
+				if(ring.order != 0 && order != 0 && ring.order != order) {
+					return smilesError("ring bond orders don't match", pos - 1);
+				}
+				BondedElement &a = molecule.atoms[ring.atom];
+				BondedElement &b = molecule.atoms[previous];
+				if(ring.atom == previous || a.bondOrder(b.getUID()) != 0) {
+					return smilesError("ring closes onto a bonded atom", pos - 1);
+				}
+				int ringOrder = ring.order != 0 ? ring.order : order;
+				bool resonance = ring.aromatic || aromatic || (ringOrder == 0 && molecule.annotations[ring.atom].aromatic && molecule.annotations[previous].aromatic);
+				uint8_t bondOrder = ringOrder == 0 ? 1 : ringOrder;
+				a.bonds.push_back(Bond{b.getUID(), bondOrder, resonance});
+				b.bonds.push_back(Bond{a.getUID(), bondOrder, resonance});
+				ring.atom = -1;
+				openRings--;
+			}
+			order = 0;
+			aromatic = false;
+			continue;
+		}
+
+		int elementId = -1;
+		SmilesAtom annotation;
+		size_t atomStart = pos;
+		if(c == '[') {
+			pos++;
+			if(BuildError error = readBracketAtom(text, pos, elementId, annotation)) {
+				return error;
+			}
+		}
+		else {
+			// Organic subset: B C N O P S F Cl Br I and aromatic b c n o p s
+			char next = pos + 1 < text.length() ? text[pos + 1] : 0;
+			switch(c) {
+				case 'B': elementId = next == 'r' ? BROMINE : 5; break;
+				case 'C': elementId = next == 'l' ? CHLORINE : CARBON; break;
+				case 'N': elementId = 7; break;
+				case 'O': elementId = 8; break;
+				case 'P': elementId = 15; break;
+				case 'S': elementId = 16; break;
+				case 'F': elementId = 9; break;
+				case 'I': elementId = 53; break;
+				case 'b': elementId = 5; annotation.aromatic = true; break;
+				case 'c': elementId = CARBON; annotation.aromatic = true; break;
+				case 'n': elementId = 7; annotation.aromatic = true; break;
+				case 'o': elementId = 8; annotation.aromatic = true; break;
+				case 'p': elementId = 15; annotation.aromatic = true; break;
+				case 's': elementId = 16; annotation.aromatic = true; break;
+				default: return smilesError("unexpected character", pos);
+			}
+			pos += (elementId == BROMINE || elementId == CHLORINE) ? 2 : 1;
+		}
+		if(elementTable[elementId].name.empty()) {
+			return smilesError("no data for element", atomStart);
+		}
+
+		previous = addSmilesAtom(molecule, elementId, annotation, previous, order, aromatic);
+		order = 0;
+		aromatic = false;
+	}
+
+	if(molecule.atoms.empty()) {
+		return smilesError("no atoms", 0);
+	}
+	if(order != 0) {
+		return smilesError("bond without a second atom", pos - 1);
+	}
+	if(!branches.empty()) {
+		return smilesError("unclosed branch", pos - 1);
+	}
+	if(openRings > 0) {
+		return smilesError("unclosed ring", pos - 1);
+	}
+	return BuildError();
+}
+
+/**
+ * Get the normal valences of an organic subset element
+ *
+ * @param elementId the element
+ * @param count set to the number of valences
+ * @return the valences, lowest first
+ */
+static const int *normalValences(int elementId, int &count) {
+	static const int boron[] = {3}, carbon[] = {4}, nitrogen[] = {3, 5}, oxygen[] = {2};
+	static const int phosphorus[] = {3, 5}, sulfur[] = {2, 4, 6}, halogen[] = {1};
+	switch(elementId) {
+		case 5: count = 1; return boron;
+		case CARBON: count = 1; return carbon;
+		case 7: count = 2; return nitrogen;
+		case 8: count = 1; return oxygen;
+		case 15: count = 2; return phosphorus;
+		case 16: count = 3; return sulfur;
+		default: count = 1; return halogen;
+	}
+}
+
+/**
+ * Get the number of bonds a charged atom normally forms
+ * e.g. N+ forms 4, O- forms 1, C+ and C- form 3
+ *
+ * @param e the element
+ * @param charge the atom's charge
+ * @return the number of bonds
+ */
+static int bondCapacity(const Element &e, int charge) {
+	if(e.periodNumber == 1) {
+		return 1 - abs(charge);
+	}
+	if(e.valenceNumber >= 5) {
+		return 8 - e.valenceNumber + charge;
+	}
+	if(e.valenceNumber == 4) {
+		return 4 - abs(charge);
+	}
+	return e.valenceNumber - charge;
+}
+
+/**
+ * Pair up the aromatic atoms that still need a double bond,
+ * backtracking when a choice leaves an atom without a partner
+ *
+ * @param graph the molecule's bonds
+ * @param molecule the molecule
+ * @param needsDouble which atoms need a double bond
+ * @param partner each atom's double bond partner, -1 for none
+ * @param from the first atom that might still be unpaired
+ * @param steps the number of pairings tried so far
+ * @return true if every atom that needs a double bond got one
+ */
+static bool pairAromaticAtoms(const BondGraph &graph, const SmilesMolecule &molecule, const vector<uint8_t> &needsDouble, vector<int> &partner, size_t from, int &steps) {
+	size_t atom = from;
+	while(atom < needsDouble.size() && (!needsDouble[atom] || partner[atom] >= 0)) {
+		atom++;
+	}
+	if(atom == needsDouble.size()) {
+		return true;
+	}
+
+	const vector<Bond> &bonds = molecule.atoms[atom].bonds;
+	for(uint32_t n = 0; n < graph.degree(atom); n++) {
+		uint32_t other = graph.neighboursBegin(atom)[n];
+		if(!bonds[n].resonance || !needsDouble[other] || partner[other] >= 0) {
+			continue;
+		}
+		if(++steps > KEKULE_STEP_LIMIT) {
+			return false;
+		}
+		partner[atom] = other;
+		partner[other] = atom;
+		if(pairAromaticAtoms(graph, molecule, needsDouble, partner, atom + 1, steps)) {
+			return true;
+		}
+		partner[atom] = -1;
+		partner[other] = -1;
+	}
+	return false;
+}
+
+/**
+ * Set the order of the bond between two atoms on both ends
+ *
+ * @param a the first atom
+ * @param b the second atom
+ * @param order the new order
+ */
+static void setBondOrder(BondedElement &a, BondedElement &b, uint8_t order) {
+	for(Bond &bond : a.bonds) {
+		if(bond.uid == b.getUID()) {
+			bond.order = order;
+		}
+	}
+	for(Bond &bond : b.bonds) {
+		if(bond.uid == a.getUID()) {
+			bond.order = order;
+		}
+	}
+}
+
+/**
+ * Finish a molecule read by parseSmiles
+ * Works out the implicit hydrogens of organic subset atoms,
+ * gives aromatic systems a Kekulé structure (their bonds stay
+ * flagged as resonance), adds the hydrogens as atoms and fills in
+ * every atom's electron counts.
+ *
+ * @param molecule the molecule, updated in place
+ * @return the error if an atom ends up overbonded or the
+ *         aromatic bonds can't be assigned
+ */
+BuildError fillImplicitHydrogens(SmilesMolecule &molecule) {
+	vector<BondedElement> &atoms = molecule.atoms;
+	vector<SmilesAtom> &annotations = molecule.annotations;
+	size_t heavyAtoms = atoms.size();
+
+	vector<uint8_t> needsDouble(heavyAtoms, 0);
+	bool anyAromatic = false;
+	int hydrogens = 0;
+	for(size_t i = 0; i < heavyAtoms; i++) {
+		SmilesAtom &annotation = annotations[i];
+		int bondSum = atoms[i].totalBondOrder();
+		if(annotation.hydrogens < 0) {
+			int count;
+			const int *valences = normalValences(atoms[i].elementId, count);
+			annotation.hydrogens = 0;
+			if(annotation.aromatic && valences[0] >= bondSum + 1) {
+				needsDouble[i] = 1;
+				annotation.hydrogens = valences[0] - bondSum - 1;
+			}
+			else {
+				for(int v = 0; v < count; v++) {
+					if(valences[v] >= bondSum) {
+						annotation.hydrogens = valences[v] - bondSum;
+						break;
+					}
+				}
+			}
+		}
+		else if(annotation.aromatic) {
+			needsDouble[i] = bondCapacity(atoms[i].base(), annotation.charge) - bondSum - annotation.hydrogens >= 1;
+		}
+		anyAromatic = anyAromatic || needsDouble[i];
+		hydrogens += annotation.hydrogens;
+	}
+
+	if(anyAromatic) {
+		BondGraph graph(atoms);
+		vector<int> partner(heavyAtoms, -1);
+		int steps = 0;
+		if(!pairAromaticAtoms(graph, molecule, needsDouble, partner, 0, steps)) {
+			return BuildError(BUILD_ERROR_AROMATIC, "SMILES error: can't assign the aromatic bonds");
+		}
+		for(size_t i = 0; i < heavyAtoms; i++) {
+			if(partner[i] > (int)i) {
+				setBondOrder(atoms[i], atoms[partner[i]], 2);
+			}
+		}
+	}
+
+	atoms.reserve(heavyAtoms + hydrogens);
+	annotations.reserve(heavyAtoms + hydrogens);
+	const Element &hydrogen = elementTable[HYDROGEN];
+	SmilesAtom hydrogenAnnotation;
+	hydrogenAnnotation.hydrogens = 0;
+	for(size_t i = 0; i < heavyAtoms; i++) {
+		for(int h = 0; h < annotations[i].hydrogens; h++) {
+			atoms.emplace_back(0, 0, hydrogen);
+			annotations.push_back(hydrogenAnnotation);
+			atoms[i].bonds.push_back(Bond{atoms.back().getUID()});
+			atoms.back().bonds.push_back(Bond{atoms[i].getUID()});
+		}
+	}
+
+	for(size_t i = 0; i < atoms.size(); i++) {
+		BondedElement &atom = atoms[i];
+		int bondSum = atom.totalBondOrder();
+		atom.bondedElectrons = bondSum * 2;
+		atom.loneElectrons = atom.base().valenceNumber - annotations[i].charge - bondSum;
+		atom.numberOfBonds = bondSum;
+		if(atom.loneElectrons < 0) {
+			return BuildError(BUILD_ERROR_OVERBONDED, "SMILES error: " + atom.base().name + " overbonded");
+		}
+	}
+	return BuildError();
+}
+
+/**
+ * Read the atoms and bonds of a SMILES string, hydrogens included,
+ * without placing them
+ *
+ * @param smiles the SMILES string, without SMILES_PREFIX
+ * @return the bonded atoms, or why they can't be built
+ */
+Result<vector<BondedElement>> readSmilesBonds(string_view smiles) {
+	SmilesMolecule molecule;
+	if(BuildError error = parseSmiles(smiles, molecule)) {
+		return error;
+	}
+	if(BuildError error = fillImplicitHydrogens(molecule)) {
+		return error;
+	}
+	return std::move(molecule.atoms);
+}
+
+/**
+ * Build a structure from a SMILES string
+ *
+ * @param context the lookup tables to build with
+ * @param smiles the SMILES string, without SMILES_PREFIX
+ * @return a list of atoms representing the structure, or why it can't be built
+ */
+Result<vector<BondedElement>> interpretSmiles(const ModelingContext &context, string_view smiles) {
+	Result<vector<BondedElement>> bonded = readSmilesBonds(smiles);
+	if(bonded) {
+		placeStructure(bonded.value);
+	}
+	return bonded;
+}
@@ -0,0 +1,209 @@
+#include "cache.h"
+#include "context.h"
+#include "smiles.h"
+
+using namespace std;
+
+/**
+ * Build the canonical key for a parsed formula
+ * Each element is written as atomic number and count with the
+ * charge appended, e.g. SO4 2- -> "f: 16 8*4 q-2"
+ *
+ * @param comp the composition of the formula, central atom first
+ * @return the key
+ */
+string StructureCache::formulaKey(const Formula &comp) {
+	string key = "f:";
+	for(const ElementCount &c : comp.counts) {
+		key += ' ' + to_string(c.elementId);
+		if(c.count > 1) {
+			key += '*' + to_string(c.count);
+		}
+	}
+	if(comp.charge != 0) {
+		key += " q" + to_string(comp.charge);
+	}
+	return key;
+}
+
+/**
+ * Get the structure for a line of input, building it only if
+ * it isn't already cached
+ * On a miss the input is only bonded at first. If the same molecule
+ * is already cached under another input (by canonical key, confirmed
+ * by matching the bond graphs) the key is pointed at that entry, and
+ * placing, resonance and relaxation are skipped.
+ * The build runs outside the lock, so other threads can keep
+ * hitting the cache while a slow structure is built
+ *
+ * @param context the lookup tables to build with
+ * @param input the formula or name
+ * @return the shared result (not null)
+ */
+StructureCache::Entry StructureCache::build(const ModelingContext &context, const string &input) {
+	// Trivial names share the entry of the input they stand for
+	string resolved;
+	string_view common = findCommonName(input);
+	const string &line = common.empty() ? input : resolved.assign(common.data(), common.size());
+
+	string key;
+	Formula comp;
+	string name;
+	bool smiles = isSmilesInput(line);
+	if(smiles) {
+		key = "s:" + line.substr(sizeof(SMILES_PREFIX) - 1);
+	}
+	else if(isOrganicName(line)) {
+		name = normalizeName(line);
+		key = "n:" + name;
+	}
+	else {
+		comp = readFormula(line);
+		if(comp.empty()) {
+			return make_shared<const BuildResult>();
+		}
+		key = formulaKey(comp);
+	}
+
+	Entry cached = find(key);
+	if(cached) {
+		hitCount.fetch_add(1, memory_order_relaxed);
+		return cached;
+	}
+	missCount.fetch_add(1, memory_order_relaxed);
+
+	BuildResult bonded;
+	if(smiles) {
+		bonded = bondFromSmiles(string_view(key).substr(2));
+	}
+	else {
+		bonded = name.empty() ? bondFromFormula(context, comp) : bondFromName(context, name);
+	}
+	if(bonded.error || bonded.structure.empty()) {
+		return make_shared<const BuildResult>(std::move(bonded));
+	}
+
+	CanonicalGraph molecule = canonicalGraph(bonded.structure);
+	Entry same = findMolecule(key, molecule);
+	if(same) {
+		return same;
+	}
+	finishBuild(bonded, relax);
+	return insert(key, std::move(molecule), make_shared<const BuildResult>(std::move(bonded)));
+}
+
+/**
+ * Get the number of cached structures
+ *
+ * @return the entry count
+ */
+size_t StructureCache::size() {
+	lock_guard<mutex> lock(accessMutex);
+	return entries.size();
+}
+
+/**
+ * Look up a key and mark it as most recently used
+ *
+ * @param key the canonical input
+ * @return the cached entry, null if there isn't one
+ */
+StructureCache::Entry StructureCache::find(const string &key) {
+	lock_guard<mutex> lock(accessMutex);
+	auto it = index.find(key);
+	if(it == index.end()) {
+		return nullptr;
+	}
+	entries.splice(entries.begin(), entries, it->second);
+	return it->second->second;
+}
+
+/**
+ * Point a key at the entry already cached for the same molecule,
+ * if there is one
+ *
+ * @param key the canonical input
+ * @param molecule the structure's canonical graph
+ * @return the entry now cached for the key, null if the molecule isn't cached
+ */
+StructureCache::Entry StructureCache::findMolecule(const string &key, const CanonicalGraph &molecule) {
+	lock_guard<mutex> lock(accessMutex);
+	auto existing = index.find(key);
+	if(existing != index.end()) {
+		// Another thread built it at the same time
+		return existing->second->second;
+	}
+	auto known = molecules.find(molecule.key);
+	if(known == molecules.end()) {
+		return nullptr;
+	}
+	Entry same = known->second.entry.lock();
+	if(same && !sameMolecule(known->second.graph, molecule)) {
+		// Another molecule with the same key
+		return nullptr;
+	}
+	if(same) {
+		sharedCount.fetch_add(1, memory_order_relaxed);
+		link(key, same);
+	}
+	return same;
+}
+
+/**
+ * Add an entry, evicting the least recently used ones
+ * if the cache is full
+ * If the same molecule was cached under another input while
+ * this one was being built the key is pointed at that entry instead
+ *
+ * @param key the canonical input
+ * @param molecule the structure's canonical graph
+ * @param entry the finished build
+ * @return the entry now cached for the key
+ */
+StructureCache::Entry StructureCache::insert(const string &key, CanonicalGraph &&molecule, const Entry &entry) {
+	lock_guard<mutex> lock(accessMutex);
+	auto existing = index.find(key);
+	if(existing != index.end()) {
+		// Another thread built it at the same time
+		return existing->second->second;
+	}
+
+	Entry stored = entry;
+	KnownMolecule &known = molecules[molecule.key];
+	Entry same = known.entry.lock();
+	if(!same) {
+		known.graph = std::move(molecule);
+		known.entry = entry;
+	}
+	else if(sameMolecule(known.graph, molecule)) {
+		stored = same;
+		sharedCount.fetch_add(1, memory_order_relaxed);
+	}
+	// Otherwise another molecule has the key, and this one isn't indexed
+	link(key, stored);
+	return stored;
+}
+
+/**
+ * Cache an entry under a key as the most recently used, evicting
+ * the least recently used ones if the cache is full
+ * The lock must be held.
+ *
+ * @param key the canonical input
+ * @param entry the entry
+ */
+void StructureCache::link(const string &key, const Entry &entry) {
+	entries.emplace_front(key, entry);
+	index[key] = entries.begin();
+	while(entries.size() > capacity) {
+		index.erase(entries.back().first);
+		entries.pop_back();
+	}
+
+	// Forget molecules whose entries have all been evicted
+	if(molecules.size() > 2 * capacity) {
+		for(auto it = molecules.begin(); it != molecules.end();) {
+			it = it->second.entry.expired() ? molecules.erase(it) : next(it);
+		}
+	}
+}
@@ -0,0 +1,130 @@
+#include <cstdlib>
+#include "structure.h"
+
+using namespace std;
+
+/**
+ * Start keeping the totals of a structure
+ * The only pass over the structure is this one
+ *
+ * @param atoms the structure, bonded or not
+ */
+StructureState::StructureState(vector<BondedElement> &atoms) : atoms(atoms) {
+	electrons = countElectrons(atoms);
+	formalCharge = getTotalFormalCharge(atoms);
+}
+
+/**
+ * Take an atom's share out of the totals, before it changes
+ *
+ * @param atom the atom
+ */
+void StructureState::forget(const BondedElement &atom) {
+	electrons -= atom.loneElectrons + atom.bondedElectrons / 2;
+	formalCharge -= abs(getFormalCharge(atom));
+}
+
+/**
+ * Put an atom's share back into the totals, after it changed
+ *
+ * @param atom the atom
+ */
+void StructureState::count(const BondedElement &atom) {
+	electrons += atom.loneElectrons + atom.bondedElectrons / 2;
+	formalCharge += abs(getFormalCharge(atom));
+}
+
+/**
+ * Append an atom to the structure
+ * Not logged, atoms stay once they're added
+ *
+ * @param atom the atom
+ */
+void StructureState::add(BondedElement atom) {
+	atoms.push_back(std::move(atom));
+	count(atoms.back());
+}
+
+/**
+ * Bond two atoms, each giving one lone electron (see bondSafe)
+ * The bond is made and logged even if it fails, so it can be undone
+ *
+ * @param a the index of the first atom
+ * @param b the index of the second atom
+ * @return the error if either atom ends up overbonded
+ */
+BuildError StructureState::bond(size_t a, size_t b) {
+	forget(atoms[a]);
+	forget(atoms[b]);
+	BuildError error = bondSafe(atoms[a], atoms[b]);
+	count(atoms[a]);
+	count(atoms[b]);
+	log.push_back(Change{Change::BOND, (uint32_t)a, (uint32_t)b, 0});
+	return error;
+}
+
+/**
+ * Turn a lone pair of the donor into a bond to the receiver (see ::shiftBond)
+ * The bond is made and logged even if it fails, so it can be undone
+ *
+ * @param receiver the index of the atom being bonded to the donor
+ * @param donor the index of the atom losing the lone pair
+ * @return whether the two atoms still have a valid # of electrons
+ */
+bool StructureState::shiftBond(size_t receiver, size_t donor) {
+	forget(atoms[receiver]);
+	forget(atoms[donor]);
+	bool valid = ::shiftBond(atoms[receiver], atoms[donor]);
+	count(atoms[receiver]);
+	count(atoms[donor]);
+	log.push_back(Change{Change::SHIFT_BOND, (uint32_t)receiver, (uint32_t)donor, 0});
+	return valid;
+}
+
+/**
+ * Give an atom lone electrons, or take them away
+ *
+ * @param atom the index of the atom
+ * @param delta the number of electrons to add
+ */
+void StructureState::addLoneElectrons(size_t atom, int delta) {
+	forget(atoms[atom]);
+	atoms[atom].loneElectrons += delta;
+	count(atoms[atom]);
+	log.push_back(Change{Change::LONE, (uint32_t)atom, 0, delta});
+}
+
+/**
+ * Reverse every change made since a mark, newest first
+ *
+ * @param mark the log size returned by mark()
+ */
+void StructureState::undo(size_t mark) {
+	while(log.size() > mark) {
+		Change change = log.back();
+		log.pop_back();
+		BondedElement &a = atoms[change.a];
+		forget(a);
+		if(change.kind == Change::LONE) {
+			a.loneElectrons -= change.delta;
+			count(a);
+			continue;
+		}
+
+		BondedElement &b = atoms[change.b];
+		forget(b);
+		if(change.kind == Change::SHIFT_BOND) {
+			undoShiftBond(a, b);
+		}
+		else {
+			a.removeBond(b.getUID());
+			b.removeBond(a.getUID());
+			a.bondedElectrons -= 2;
+			b.bondedElectrons -= 2;
+			a.loneElectrons++;
+			b.loneElectrons++;
+		}
+		count(a);
+		count(b);
+	}
+}
@@ -2,176 +2,117 @@
 #include <vector>
 #include <algorithm>
 #include <string>
+#include <cctype>
+#include <thread>
 #include "VSEPR.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/quaternion.hpp"
 #include "glm/gtx/quaternion.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "data.h"
-#include "render.h"
-
-std::vector<std::vector<glm::vec3>> configurations;
-uint32_t BondedElement::maxUID = 0;
+#include "geometry.h"
+#include "domains.h"
+#include "resonance.h"
+#include "molecule.h"
+#include "allocation.h"
+#include "arena.h"
+#include "context.h"
+#include "fragments.h"
+#include "formula.h"
+#include "iupac.h"
+#include "smiles.h"
+#include "structure.h"
+#include "forcefield.h"
+#include "conformers.h"
+
+std::atomic<uint32_t> BondedElement::maxUID(0);
+std::atomic<uint64_t> CopyCounter::copies(0);
 
 using namespace std;
-map<string, Element> elements;
-std::vector<glm::vec3> tetrahedron;
-std::map<std::string, int> numberTerms;
-
-/**
- * Find the elements in a chemical formula
- * 
- * @param formulaFull the chemical formula as a string
- * @return a list of the contained elements
- */
-vector<Element> readFormula(string formulaFull) {
-	string formula;
-	int charge = 0;
-	char sign = ' ';
-	bool space = false;
-	for(int i = 0; i < formulaFull.length(); i++) {
-		if(formulaFull[i] == ' ') {
-			space = true;
-		}
-		else {
-			if (!space) {
-				formula += formulaFull[i];
-			}
-			if (space) {
-				if (isdigit(formulaFull[i]) && formulaFull[i] != '-' && formulaFull[i] != '+') {
-					charge = formulaFull[i] - '0';
-				}
-				else if(formulaFull[i] != ' ') {
-					sign = formulaFull[i];
-				}
-			}
-		} 
-	}
-	if(sign == '-') {
-		charge = -charge;
-	}
-
-	if (formula.length() < 1)
-		return vector<Element>();
-
-	vector<Element> comp;
-	string symbol = "";
-	symbol += formula[0];
-
-	for (int i = 1; i < formula.length(); i++) {
-		if (isdigit(formula[i])) {
-			Element e = searchElements(symbol);
-			if (e.atomicNumber != -1) {
-				for (int x = 0; x < formula[i] - '0'; x++) {
-					comp.push_back(e);
-				}
-			}
-			else {
-				return vector<Element>();
-			}
-			symbol = "";
-		}
-		else if (islower(formula[i])) {
-			symbol += formula[i];
-		}
-		else {
-			Element e = searchElements(symbol);
-			if (e.atomicNumber != -1) {
-				comp.push_back(e);
-			}
-			else {
-				return vector<Element>();
-			}
-			symbol = ""; symbol += formula[i];
-		}
-	}
-	Element e = searchElements(symbol);
-	if (e.atomicNumber != -1) {
-		comp.push_back(e);
-	}
-	if(charge != 0) {
-		comp.push_back(Element(-1, -charge, -1, ""));
-	}
-
-	if(comp.size() > 0) {
-		return comp;
-	}
-	else {
-		return vector<Element>();
-	}
-}
 
 /**
  * Create double/triple bonds until if necessary
  * 
- * @param structure the chemical structure
- * @return the updated structure with higher order bonds
+ * @param state the chemical structure, updated in place with higher order bonds
+ * @param eTotal the number of valence electrons the structure should have
+ * @return the error if a bond can't be made
  */
-vector<BondedElement> rebond(vector<BondedElement> structure, int eTotal) {
+static BuildError rebond(StructureState &state, int eTotal) {
+	vector<BondedElement> &structure = state.atoms;
 	for (int i = 1; i < structure.size(); i++)
 	{
 		if (structure[i].loneElectrons < 1)
 			continue;
-		structure[0].loneElectrons--;
-		structure[i].loneElectrons--;
-		bondSafe(structure[i], structure[0]);
-		if (countElectrons(structure) == eTotal || structure[0].loneElectrons < 1)
+		state.addLoneElectrons(0, -1);
+		state.addLoneElectrons(i, -1);
+		if(BuildError error = state.bond(i, 0)) {
+			return error;
+		}
+		if (state.electrons == eTotal || structure[0].loneElectrons < 1)
 			break;
 	}
-	return structure;
+	return BuildError();
 }
 
 /**
  * Predicts the positions of atoms in a simple
  * covalent compound using periodic table data
  * 
- * @param structure the compound's structure
- * @return the structure with updated position information
+ * @param structure the compound's structure, updated in place with position information
  */
-vector<BondedElement> positionSimpleAtoms(vector<BondedElement> structure) {
-	int configIndex = configIndex = structure.size() - 2;
-	if (structure.size() > 2) {
-		configIndex += structure[0].loneElectrons / 2;
-	}
-
+void positionSimpleAtoms(vector<BondedElement> &structure) {
 	structure[0].position = glm::vec3(0);
 	structure[0].vanDerWaalsPosition = glm::vec3(0);
-	BondedElement center = structure[0];
+	const BondedElement &center = structure[0];
+	const DomainGeometry *geometry = domainGeometry(structure.size() - 1, center.loneElectrons / 2);
+	if(geometry == nullptr) {
+		return;
+	}
 
 	for(int i = 1; i < structure.size(); i++) {
-		glm::vec3 dir = glm::normalize(configurations[configIndex][i - 1]);
+		glm::vec3 dir = geometry->direction(i - 1);
 
-		int bondOrder = findInstances(structure[i].neighbours, structure[i].neighbours[0]);
+		int bondOrder = structure[i].bonds[0].order;
 		structure[i].vanDerWaalsPosition = dir * getSphereDistance(structure[i], center, bondOrder);
 		structure[i].position = dir * getStickDistance();
-		if(structure[i].base.name == "hydrogen") {
+		if(structure[i].elementId == HYDROGEN) {
 			structure[i].position *= 0.7;
 		}
 	}
-
-	return structure;
 }
 
 /**
  * Predict the lewis structure of a compound given
  * a list of atoms that compose it
  * 
- * @param formula the list of atoms
- * @return the final compound structure
+ * @param context the lookup tables to build with
+ * @param formula the composition, the first element's first atom is central
+ * @return the final compound structure, or why there is none
  */
-vector<BondedElement> constructLewisStructure(vector<Element> formula) {
-	int eTotal = 0;
-	for(int i = 0; i < formula.size(); i++) {
-		eTotal += formula[i].valenceNumber;
+Result<vector<BondedElement>> constructLewisStructure(const ModelingContext &context, const Formula &formula) {
+	if(formula.empty()) {
+		return BuildError(BUILD_ERROR_NO_LEWIS_STRUCTURE, "Lewis structure not possible");
+	}
+	const Element &central = elementTable[formula.counts[0].elementId];
+	int eTotal = -formula.charge;
+	for(const ElementCount &c : formula.counts) {
+		eTotal += elementTable[c.elementId].valenceNumber * c.count;
 	}
 
 	// Bond central to peripheral once
+	// Atoms are only expanded from the composition here, as they're bonded
 	vector<BondedElement> lewisStructure;
-	lewisStructure.push_back(BondedElement(formula[0].valenceNumber, 0, formula[0]));
-	for (int i = 1; i < formula.size(); i++) {
-		if(formula[i].name != "") {
-			lewisStructure.push_back(BondedElement(formula[i].valenceNumber, 0, formula[i]));
-			bondSafe(lewisStructure[0], lewisStructure.back()); // One bond between central and outer is necessary
+	lewisStructure.reserve(formula.atomCount());
+	StructureState state(lewisStructure);
+	state.add(BondedElement(central.valenceNumber, 0, central));
+	for (int i = 0; i < formula.counts.size(); i++) {
+		const Element &e = elementTable[formula.counts[i].elementId];
+		for(uint32_t n = i == 0 ? 1 : 0; n < formula.counts[i].count; n++) {
+			state.add(BondedElement(e.valenceNumber, 0, e));
+			// One bond between central and outer is necessary
+			if(BuildError error = state.bond(0, lewisStructure.size() - 1)) {
+				return error;
+			}
 		}
 	}
 
@@ -179,92 +120,103 @@ vector<BondedElement> constructLewisStructure(vector<Element> formula) {
 	for (int i = 0; i < lewisStructure.size(); i++) {
 		int missingElectrons = checkStability(lewisStructure[i]);
 		if (missingElectrons >= 0) {
-			lewisStructure[i].loneElectrons += missingElectrons;
+			state.addLoneElectrons(i, missingElectrons);
 		}
-		else if(formula[0].periodNumber < 3) {
+		else if(central.periodNumber < 3) {
 			string errorMessage = "Bond error: ";
-			errorMessage += lewisStructure[i].base.name + " cannot be bonded";
-			throw errorMessage.c_str();
+			errorMessage += lewisStructure[i].base().name + " cannot be bonded";
+			return BuildError(BUILD_ERROR_UNBONDABLE, std::move(errorMessage));
 		}
 	}
 
-	if (countElectrons(lewisStructure) > eTotal) {
-		lewisStructure = rebond(lewisStructure, eTotal);
-		if(countElectrons(lewisStructure) > eTotal) {
-			lewisStructure = rebond(lewisStructure, eTotal);
+	if (state.electrons > eTotal) {
+		BuildError error = rebond(state, eTotal);
+		if(!error && state.electrons > eTotal) {
+			error = rebond(state, eTotal);
+		}
+		if(error) {
+			return error;
 		}
 	}
-	int excess = countElectrons(lewisStructure) - eTotal;
-	if(excess > 0 && lewisStructure[0].base.periodNumber >= 3) {
-		lewisStructure[0].loneElectrons += excess;
+	int excess = state.electrons - eTotal;
+	if(excess > 0 && lewisStructure[0].base().periodNumber >= 3) {
+		state.addLoneElectrons(0, excess);
 	}
 
-	if ((checkStability(lewisStructure[0]) != 0 && lewisStructure[0].base.periodNumber < 3) || countElectrons(lewisStructure) != eTotal) {
-		return vector<BondedElement>();
+	if ((checkStability(lewisStructure[0]) != 0 && lewisStructure[0].base().periodNumber < 3) || state.electrons != eTotal) {
+		return BuildError(BUILD_ERROR_NO_LEWIS_STRUCTURE, "Lewis structure not possible");
 	}
 
-	for(int i = 0; i < lewisStructure.size(); i++) {
-		if(getFormalCharge(lewisStructure[i]) != 0) {
-			lewisStructure = optimizeFormalCharge(lewisStructure);
-			break;
-		} 
+	if(state.formalCharge != 0) {
+		state.commit();
+		optimizeFormalCharge(state);
 	}
 
-	lewisStructure = positionSimpleAtoms(lewisStructure);
-	lewisStructure = generateCylinders(lewisStructure);
+	positionSimpleAtoms(lewisStructure);
+	averageResonance(lewisStructure);
+	generateCylinders(lewisStructure);
 	return lewisStructure;
 }
 
 /**
  * Test different variations of bonding to minimize
  * the total formal charge on the structure
+ * Each trial bond is made in place and undone if it
+ * doesn't lower the charge, so the structure is never copied
+ * or rescanned
  * 
- * @param structure the original structure
- * @return the optimized structure
+ * @param state the structure to optimize in place
  */
-vector<BondedElement> optimizeFormalCharge(vector<BondedElement> structure) {
-	vector<BondedElement> returnVector = structure;
-	int totalCharge = getTotalFormalCharge(structure);
+void optimizeFormalCharge(StructureState &state) {
+	vector<BondedElement> &structure = state.atoms;
 	for(int x = 0; x < 2; x++) {
 		for(int i = structure.size() - 1; i > 1; i--) {
-			if(structure[0].base.periodNumber >= 3 && structure[i].loneElectrons > 0) {
-				if(!shiftBond(structure[0], structure[i])) {
-					structure = returnVector;
+			if(structure[0].base().periodNumber >= 3 && structure[i].loneElectrons > 0) {
+				int totalCharge = state.formalCharge;
+				size_t mark = state.mark();
+				if(!state.shiftBond(0, i) || state.formalCharge >= totalCharge) {
+					state.undo(mark);
 					continue;
 				}
-
-				int newTotal = getTotalFormalCharge(structure);
-				if(newTotal < totalCharge) {
-					totalCharge = newTotal;
-					returnVector = structure;
-				}
-				else {
-					structure = returnVector;
-				}
+				state.commit();
 			}
 		}
 	}
+}
 
-	return returnVector;
+/**
+ * Minimize the total formal charge of a finished structure
+ * (see optimizeFormalCharge(StructureState &))
+ * 
+ * @param structure the structure to optimize in place
+ */
+void optimizeFormalCharge(vector<BondedElement> &structure) {
+	StructureState state(structure);
+	optimizeFormalCharge(state);
 }
 
 /**
  * Predict the positions of each atom in a substituent
  * of a compound that has already been bonded
  * 
+ * The substituent is updated in place and emptied if
+ * it can't be positioned
+ * 
  * @param structure the structure of the substituent
  * @param cyclo whether the substituent is a cyclo group
- * @return the substituent with predicted positions
+ * @param arena the request's memory arena for scratch space
  */
-Substituent positionAtoms(Substituent structure, bool cyclo) {
+void positionAtoms(Substituent &structure, bool cyclo, std::pmr::memory_resource *arena) {
 	if(structure.components.size() < 1 || (cyclo && structure.components.size() < 3)) {
-		return Substituent();
+		structure.components.clear();
+		return;
 	}
 
 	// Position cyclo group in a circle
 	if(cyclo) {
 		// Generate positions along a unit circle
-		vector<glm::vec3> positions;
+		std::pmr::vector<glm::vec3> positions(arena);
+		positions.reserve(structure.components.size());
 		float angleInterval = (2*PI)/structure.components.size();
 		for(int i = 0; i < structure.components.size(); i++) {
 			float angle = angleInterval * i;
@@ -274,7 +226,7 @@ Substituent positionAtoms(Substituent structure, bool cyclo) {
 		// Adjust the circle's radius for number of atoms
 		float adjMagnitude = glm::length(positions[0]-positions[1]);
 		float multiplier = 1/adjMagnitude;
-		int adjBondOrder = findInstances(structure.components[0].neighbours, structure.components[0].neighbours[0]);
+		int adjBondOrder = structure.components[0].bonds[0].order;
 		float multiplier_v = getSphereDistance(structure.components[0], structure.components[1], adjBondOrder)/adjMagnitude;
 
 		// Scale and apply positions
@@ -285,24 +237,26 @@ Substituent positionAtoms(Substituent structure, bool cyclo) {
 			glm::vec3 secondaryAxis = glm::cross(positions[i], glm::vec3(0.0f, 1.0f, 0.0f));
 			structure.components[i].rotation = glm::rotate(rotation, PI/2, secondaryAxis);
 		}
-		return structure;
+		return;
 	}
 	
 	// Position atoms in a straight hydrocarbon chain
+	BondGraph graph(structure.components.data(), structure.components.size());
 	structure.components[0].position = glm::vec3(0.0f);
 	structure.components[0].vanDerWaalsPosition = glm::vec3(0.0f);
 	structure.components[0].rotation = glm::toMat4(glm::angleAxis(PI, glm::vec3(1.0f, 0.0f, 0.0f)));
 	for(int i = 1; i < structure.components.size(); i++) {
-		glm::vec3 offset = glm::vec3(tetrahedron[0].x, structure.components[i].id % 2 == 1 ? tetrahedron[0].y : -tetrahedron[0].y, 0);
+		glm::vec3 tetrahedral = domainGeometry(4, 0)->direction(0);
+		glm::vec3 offset = glm::vec3(tetrahedral.x, structure.components[i].id % 2 == 1 ? tetrahedral.y : -tetrahedral.y, 0);
 		//Regular position
 		structure.components[i].position = structure.components[i-1].position;
 		structure.components[i].position += offset*getStickDistance();
 
 		//VanDerWaals position
 		structure.components[i].vanDerWaalsPosition = structure.components[i-1].vanDerWaalsPosition;
-		int bondOrder = findInstances(structure.components[i].neighbours, structure.components[i].neighbours[0]);
-		BondedElement neighbour = findNeighbour(structure.components[i].neighbours[0], structure.components);
-		structure.components[i].vanDerWaalsPosition += offset * getSphereDistance(structure.components[i], neighbour, bondOrder);
+		const Bond &previous = structure.components[i].bonds[0];
+		const BondedElement &neighbour = structure.components[graph.find(previous.uid)];
+		structure.components[i].vanDerWaalsPosition += offset * getSphereDistance(structure.components[i], neighbour, previous.order);
 
 		if(i == structure.components.size()-1) {
 			structure.components[i].rotation *= glm::toMat4(glm::angleAxis(PI, glm::vec3(0.0f, 1.0f, 0.0f)));
@@ -312,132 +266,41 @@ Substituent positionAtoms(Substituent structure, bool cyclo) {
 		}
 	}
 
-	return structure;
 }
 
 /**
- * Construct a group of substituents of an organic compound
- * given its name and position on the base chain
- * All substituents on a given base atom will be calculated here
+ * Add hydrogens to a substituent to satisfy all carbons
+ * The substituent is updated in place
  * 
- * @param name the name of substituent
- * @param place the position on the base chain
- * @return a list of the substituents
+ * @param structure the substituent to fill
+ * @return the error if a carbon is overbonded or has no geometry for its bonds
  */
-vector<Substituent> interpretSubstituent(string name, string place) {
-	std::vector<int> attachPoints;
-	string num = "";
-
-	for(int i = 0; i < place.length(); i++) {
-		if(place[i]==',') {
-			attachPoints.push_back(stoi(num));
-			num = "";
-		}
-		else {
-			num+=place[i];
-		}
-	}
-	attachPoints.push_back(stoi(num));
-
-	int carbonNum = findNumberTerm(name);
-
-	Substituent newSub;
-	Element carbon = elements["C"];
-	for(int i = 0; i < carbonNum; i++) {
-		BondedElement newCarbon = BondedElement(4, 0, carbon);
-		newCarbon.id = i+1;
-		if(i > 0) {
-			bondSafe(newCarbon, newSub.components[i-1]);
-		}
-		newSub.components.push_back(newCarbon);
-	}
-
-	if(checkStringComponent(name, "cyclo")) {
-		bondSafe(newSub.components[0], newSub.components[newSub.components.size()-1]);
-		newSub = positionAtoms(newSub, true);
-	}
-	else {
-		newSub = positionAtoms(newSub, false);
-	}
-
-	string suffix = name.substr(name.length()-4, 3);
-	if(suffix == "ane" || suffix == "ene" || suffix == "yne") {
-		newSub.connectionPoint = -1;
-		return {newSub};
-	}
-	else {
-		vector<Substituent> allSubs;
-		newSub.connectionPoint = attachPoints[0];
-		allSubs.push_back(newSub);
-		for(int i = 1; i < attachPoints.size(); i++) {
-			newSub.connectionPoint = attachPoints[i];
-			allSubs.push_back(newSub.duplicate());
-		}
-		return allSubs;
-	}
-}
+BuildError fillInHydrogens(Substituent &structure) {
+	const Element &rawHydrogen = elementTable[HYDROGEN];
+	int numberOfCarbons = structure.components.size();
 
-/**
- * Construct all the constituents in an organic compound
- * 
- * @param in the name of the compound
- * @return a list of substituents
- */
-vector<Substituent> findSubstituents(string in) {
-	transform(in.begin(), in.end(), in.begin(), ::tolower); //Make string lowercase
-	
-	std::vector<string> splitIn;
-	string current = "";
-	for(int i = 0; i < in.length(); i++) {
-		if(i < in.length()-2) { //Check for groups without dash separation
-			if(in[i] == 'y' && in[i+1] == 'l' && in[i+2] != '-') {
-				current += 'y';
-				current += 'l';
-				splitIn.push_back(current);
-				current = "";
-				i += 2;
-			}
-		}
-		if(in[i]=='-') {
-			splitIn.push_back(current);
-			current = "";
-		}
-		else {
-			current+=in[i];
-		}
+	// Reserve up front so references to carbons stay valid while hydrogens are added
+	int numberOfHydrogens = 0;
+	for(int c = 0; c < numberOfCarbons; c++) {
+		numberOfHydrogens += max(0, structure.components[c].numberOfBonds - structure.components[c].totalBondOrder());
 	}
-	splitIn.push_back(current);
+	structure.components.reserve(numberOfCarbons + numberOfHydrogens);
 
-	vector<Substituent> newSubGroup;
-	vector<Substituent> returnVec;
-	for(int i = splitIn.size()-2; i > 0; i--) {
-		if(checkForDigits(splitIn[i])) {
+	for(int c = 0; c < numberOfCarbons; c++) {
+		BondedElement &carbon = structure.components[c];
+		int startingBonds = carbon.totalBondOrder();
+		if(startingBonds >= carbon.numberOfBonds) {
 			continue;
 		}
-		newSubGroup = interpretSubstituent(splitIn[i], splitIn[i-1]);
-		returnVec.insert(returnVec.end(), newSubGroup.begin(), newSubGroup.end());
-	}
-	newSubGroup = interpretSubstituent(splitIn.back(), "-1");
-	returnVec.insert(returnVec.end(), newSubGroup.begin(), newSubGroup.end());
-	return returnVec;
-}
-
-/**
- * Add hydrogens to a substituent to satisfy all carbons
- * 
- * @param structure the substituent to fill
- * @return the filled hydrogen
- */
-Substituent fillInHydrogens(Substituent structure) {
-	Element rawHydrogen = elements["H"];
-	int numberOfCarbons = structure.components.size();
-	for(int c = 0; c < numberOfCarbons; c++) {
-		BondedElement carbon = structure.components[c];
-		for(int i = carbon.neighbours.size(); i < carbon.numberOfBonds; i++) {
+		const DomainGeometry *geometry = domainGeometry(carbon.numberOfBonds, 0);
+		if(geometry == nullptr) {
+			return BuildError(BUILD_ERROR_UNBONDABLE, "Bond error: " + carbon.base().name + " cannot be bonded");
+		}
+		for(int i = startingBonds; i < carbon.numberOfBonds; i++) {
 			BondedElement hydrogen = BondedElement(1, 0, rawHydrogen);
 			//Regular position
 			hydrogen.position = carbon.position;
-			glm::vec3 offset = configurations[carbon.numberOfBonds-1][i];
+			glm::vec3 offset = geometry->direction(i);
 			offset = glm::vec3(glm::vec4(offset, 0.0f) * carbon.rotation);
 			hydrogen.position += offset*getStickDistance() * 0.7f;
 			if(c == 0 && structure.connectionPoint > 0) {
@@ -451,25 +314,28 @@ Substituent fillInHydrogens(Substituent structure) {
 				hydrogen.vanDerWaalsPosition.x = -hydrogen.vanDerWaalsPosition.x;
 			}
 
-			bondSafe(hydrogen, structure.components[c]);
-			structure.components.push_back(hydrogen);
+			if(BuildError error = bondSafe(hydrogen, carbon)) {
+				return error;
+			}
+			structure.components.push_back(std::move(hydrogen));
 		}
 	}
-	return structure;
+	return BuildError();
 }
 
 /**
  * Rotate all atoms in a substituent to align
  * with the atom in the base structure
  * 
+ * The substituent is updated in place
+ * 
  * @param structure the substituent to rotate
  * @param dir the direction to rotate towards
  * @param parent the base atom
- * @return the rotated substituent 
  */
-Substituent rotateSubstituent(Substituent structure, glm::vec3 dir, BondedElement parent) {
+void rotateSubstituent(Substituent &structure, glm::vec3 dir, const BondedElement &parent) {
 	if(structure.components.size() < 1) {
-		return Substituent();
+		return;
 	}
 
 	glm::vec3 right = glm::vec3(1.0f, 0.0f, 0.0f);
@@ -482,7 +348,7 @@ Substituent rotateSubstituent(Substituent structure, glm::vec3 dir, BondedElemen
 	rotation = glm::rotate(rotation, PI, glm::vec3(right));
 	rotation = glm::rotate(rotation, angle, axis);
 
-	float vanDerWaalsOffset = getSphereDistance(structure.components[0], parent, findInstances(structure.components[0].neighbours, parent.getUID()));
+	float vanDerWaalsOffset = getSphereDistance(structure.components[0], parent, structure.components[0].bondOrder(parent.getUID()));
 
 	for(int i = 0; i < structure.components.size(); i++) {
 		structure.components[i].position = glm::vec3(glm::vec4(structure.components[i].position, 0.0f) * rotation);
@@ -490,37 +356,138 @@ Substituent rotateSubstituent(Substituent structure, glm::vec3 dir, BondedElemen
 		structure.components[i].position += dir * getStickDistance();
 
 		structure.components[i].vanDerWaalsPosition = glm::vec3(glm::vec4(structure.components[i].vanDerWaalsPosition, 0.0f) * rotation);
-		structure.components[i].vanDerWaalsPosition += parent.vanDerWaalsPosition;findInstances(structure.components[i].neighbours, parent.getUID());
+		structure.components[i].vanDerWaalsPosition += parent.vanDerWaalsPosition;
 		structure.components[i].vanDerWaalsPosition += dir * vanDerWaalsOffset;
 	}
 
-	return structure;
+}
+
+/**
+ * Get the template a group of a name is built from
+ * Chains longer than the library holds are built into storage
+ *
+ * @param context the lookup tables to build with
+ * @param group the substituent's stem and locants, or the parent chain
+ * @param storage where to build a template that isn't prebuilt
+ * @return the template, or why the group can't be built
+ */
+static Result<const FragmentTemplate *> groupTemplate(const ModelingContext &context, const NameGroup &group, FragmentTemplate &storage) {
+	if(group.functionalGroup) {
+		const FragmentTemplate *fragment = context.fragments.group(group.stem);
+		if(fragment == nullptr) {
+			return BuildError(BUILD_ERROR_FUNCTIONAL_GROUP, "Name error: " + string(group.stem) + " is not a functional group");
+		}
+		return fragment;
+	}
+
+	int carbonNum = chainLength(group.stem);
+	if(carbonNum < 1 || (group.cyclo && carbonNum < 3)) {
+		return BuildError(BUILD_ERROR_CHAIN_LENGTH, "Name error: " + string(group.stem) + " is not a chain length");
+	}
+	const FragmentTemplate *fragment = context.fragments.chain(carbonNum, group.cyclo, !group.parent);
+	if(fragment != nullptr) {
+		return fragment;
+	}
+	Result<FragmentTemplate> built = buildChainTemplate(carbonNum, group.cyclo, !group.parent);
+	if(!built) {
+		return built.error;
+	}
+	storage = std::move(built.value);
+	return &storage;
 }
 
 /**
  * Predict the structure of an organic compound
+ * Every group is copied out of a prebuilt template, so only the
+ * bonds between the substituents and the parent chain are made
+ * here. Scratch data for the build lives in a per-request arena
+ * that is released when the function returns
  * 
+ * @param context the lookup tables to build with
  * @param in the name of the compound
- * @return a list of atoms representing the structure
+ * @return a list of atoms representing the structure, or why it can't be built
  */
-vector<BondedElement> interpretOrganic(string in) {
-	vector<Substituent> subs = findSubstituents(in);
-	Substituent central = subs.back();
-	subs.pop_back();
-	if(subs.size() > 0) {
-		for (int i = 0; i < subs.size(); i++)
-		{
-			bondSafe(subs[i].components[0], central.components[subs[i].connectionPoint - 1]);
-			subs[i] = fillInHydrogens(subs[i]);
+Result<vector<BondedElement>> interpretOrganic(const ModelingContext &context, const string &in) {
+	// The tokenizer expects lower case names
+	string_view name = in;
+	string lowered;
+	if(any_of(in.begin(), in.end(), [](char c) { return isupper((unsigned char)c); })) {
+		lowered = normalizeName(in);
+		name = lowered;
+	}
+
+	BuildArena arena;
+	std::pmr::vector<NameToken> tokens(arena.get());
+	std::pmr::vector<NameGroup> groups(arena.get());
+	tokens.reserve(16);
+	groups.reserve(8);
+	if(!tokenizeName(name, tokens) || !groupNameTokens(tokens, groups)) {
+		return BuildError(BUILD_ERROR_NAME, "Name error: " + string(name) + " not recognized");
+	}
+
+	FragmentTemplate parentStorage;
+	Result<const FragmentTemplate *> parentTemplate = groupTemplate(context, groups.back(), parentStorage);
+	if(!parentTemplate) {
+		return parentTemplate.error;
+	}
+	const FragmentTemplate &parent = *parentTemplate.value;
+	int parentCarbons = 0;
+	while(parentCarbons < parent.atoms.size() && parent.atoms[parentCarbons].elementId != HYDROGEN) {
+		parentCarbons++;
+	}
+
+	// Substituents are placed last group to first, each taking
+	// the place of one of its parent carbon's hydrogens
+	std::pmr::vector<Substituent> subs(arena.get());
+	std::pmr::vector<int> subSlots(arena.get());
+	std::pmr::vector<uint8_t> removedHydrogens(parent.atoms.size(), 0, arena.get());
+	for(int g = groups.size()-2; g >= 0; g--) {
+		FragmentTemplate storage;
+		Result<const FragmentTemplate *> groupFragment = groupTemplate(context, groups[g], storage);
+		if(!groupFragment) {
+			return groupFragment.error;
+		}
+		const FragmentTemplate &fragment = *groupFragment.value;
+		for(int l = 0; l < groups[g].locantCount; l++) {
+			int locant = groups[g].locants[l];
+			if(locant > parentCarbons) {
+				return BuildError(BUILD_ERROR_LOCANT, "Name error: no carbon " + to_string(locant) + " in the parent chain");
+			}
+			if(++removedHydrogens[locant-1] > parent.hydrogenCount(locant-1)) {
+				return BuildError(BUILD_ERROR_OVERBONDED, "Bond error: " + elementTable[CARBON].name + " overbonded");
+			}
+			subs.push_back(fragment.instantiate(arena.get()));
+			subs.back().connectionPoint = locant;
+			subSlots.push_back(fragment.heavyDegree(0));
 		}
 	}
-	central = fillInHydrogens(central);
+	Substituent central = parent.instantiate(arena.get(), removedHydrogens.data());
+
+	// Each connection goes before the hydrogens, in the slot
+	// the dropped hydrogen had
+	std::pmr::vector<uint8_t> attached(parentCarbons, 0, arena.get());
 	for(int i = 0; i < subs.size(); i++) {
-		vector<uint32_t>::iterator pos = find(central.components[subs[i].connectionPoint - 1].neighbours.begin(), central.components[subs[i].connectionPoint - 1].neighbours.end(), subs[i].components[0].getUID());
-		int index = distance(central.components[subs[i].connectionPoint - 1].neighbours.begin(), pos);
-		if (index < configurations[central.components[subs[i].connectionPoint - 1].numberOfBonds-1].size()) {
-			glm::vec3 dir = glm::vec3(glm::vec4(configurations[central.components[subs[i].connectionPoint - 1].numberOfBonds-1][index], 0.0f)*central.components[subs[i].connectionPoint - 1].rotation);
-			subs[i] = rotateSubstituent(subs[i], dir, central.components[subs[i].connectionPoint - 1]);
+		int anchorIndex = subs[i].connectionPoint - 1;
+		BondedElement &anchor = central.components[anchorIndex];
+		BondedElement &first = subs[i].components[0];
+		if(BuildError error = bondSafe(first, anchor)) {
+			return error;
+		}
+		rotate(first.bonds.begin() + subSlots[i], first.bonds.end() - 1, first.bonds.end());
+		int anchorSlot = parent.heavyDegree(anchorIndex) + attached[anchorIndex]++;
+		rotate(anchor.bonds.begin() + anchorSlot, anchor.bonds.end() - 1, anchor.bonds.end());
+	}
+
+	for(int i = 0; i < subs.size(); i++) {
+		const BondedElement &anchor = central.components[subs[i].connectionPoint - 1];
+		const vector<Bond> &anchorBonds = anchor.bonds;
+		uint32_t subUID = subs[i].components[0].getUID();
+		auto pos = find_if(anchorBonds.begin(), anchorBonds.end(), [subUID](const Bond &b) { return b.uid == subUID; });
+		int index = distance(anchorBonds.begin(), pos);
+		const DomainGeometry *geometry = domainGeometry(anchor.numberOfBonds, 0);
+		if (geometry != nullptr && index < geometry->domains) {
+			glm::vec3 dir = glm::vec3(glm::vec4(geometry->direction(index), 0.0f)*anchor.rotation);
+			rotateSubstituent(subs[i], dir, anchor);
 		}
 	}
 
@@ -531,16 +498,276 @@ vector<BondedElement> interpretOrganic(string in) {
 	}
 	returnVec.reserve(reserveNum + central.components.size());
 	for(int i = 0; i < subs.size(); i++) {
-		returnVec.insert(returnVec.end(), subs[i].components.begin(), subs[i].components.end());
+		returnVec.insert(returnVec.end(), make_move_iterator(subs[i].components.begin()), make_move_iterator(subs[i].components.end()));
 	}
-	returnVec.insert(returnVec.end(), central.components.begin(), central.components.end());
-	// returnVec = centerPositions(returnVec);
-	returnVec = averageCenterPositions(returnVec);
-	returnVec = generateCylinders(returnVec);
+	returnVec.insert(returnVec.end(), make_move_iterator(central.components.begin()), make_move_iterator(central.components.end()));
+	averageCenterPositions(returnVec);
+	generateCylinders(returnVec);
 
 	return returnVec;
 }
 
+/**
+ * Load the periodic table and set up the lookup
+ * tables needed to build structures
+ * Throws if the periodic table data can't be read
+ * 
+ * @return the filled in context
+ */
+static ModelingContext createModelingContext() {
+	ModelingContext context;
+	parseCSV(DATA_TABLE_PATH);
+
+	buildFragmentLibrary(context);
+	return context;
+}
+
+const ModelingContext &defaultContext() {
+	// Initialization of a function-local static runs once even with
+	// several threads calling, and is retried if it throws
+	static const ModelingContext context = createModelingContext();
+	return context;
+}
+
+/**
+ * Check whether a line of input names an organic compound
+ * rather than giving a chemical formula
+ * 
+ * @param input the formula or name
+ * @return true for organic names
+ */
+bool isOrganicName(const string &input) {
+	return checkStringComponent(input, "ane") || checkStringComponent(input, "ene") || checkStringComponent(input, "yne");
+}
+
+/**
+ * Normalize an organic name so that spellings that build
+ * the same compound compare equal (lower case, no whitespace)
+ * 
+ * @param name the name as typed
+ * @return the normalized name
+ */
+string normalizeName(const string &name) {
+	string normalized;
+	normalized.reserve(name.length());
+	for(char c : name) {
+		if(!isspace((unsigned char)c)) {
+			normalized += tolower((unsigned char)c);
+		}
+	}
+	return normalized;
+}
+
+/**
+ * Bond the structure of an organic compound
+ * Names are assembled from placed templates, so the result is
+ * placed already but not relaxed
+ * 
+ * @param context the lookup tables to build with
+ * @param name the normalized name of the compound
+ * @return the structure, or an error message if it can't be built
+ */
+BuildResult bondFromName(const ModelingContext &context, const string &name) {
+	BuildResult result;
+	result.organic = true;
+	Result<vector<BondedElement>> built = interpretOrganic(context, name);
+	result.structure = std::move(built.value);
+	result.error = std::move(built.error);
+	return result;
+}
+
+/**
+ * Bond the structure of a simple covalent compound
+ * Formulas with one central atom, written first, are bonded (and
+ * placed) around it; anything else (e.g. H2O2 or C2H6O) is left to
+ * the skeleton search, which only bonds it
+ * 
+ * @param context the lookup tables to build with
+ * @param comp the composition of the compound
+ * @return the structure, or an error message if it can't be built
+ */
+BuildResult bondFromFormula(const ModelingContext &context, const Formula &comp) {
+	BuildResult result;
+	Result<vector<BondedElement>> built = constructLewisStructure(context, comp);
+	if(!built) {
+		// No single central atom works, search every skeleton instead
+		Result<vector<BondedElement>> solved = solveLewisBonds(comp);
+		if(!solved) {
+			result.error = std::move(solved.error);
+			return result;
+		}
+		result.structure = std::move(solved.value);
+		result.organic = true;
+		result.placed = false;
+		return result;
+	}
+	result.structure = std::move(built.value);
+
+	for(int i = 0; i < result.structure.size(); i++) {
+		if(getFormalCharge(result.structure[i]) != 0) {
+			optimizeFormalCharge(result.structure);
+			break;
+		} 
+	}
+	return result;
+}
+
+/**
+ * Bond the structure of a SMILES string, without placing it
+ * 
+ * @param smiles the SMILES string, without SMILES_PREFIX
+ * @return the structure, or an error message if it can't be built
+ */
+BuildResult bondFromSmiles(string_view smiles) {
+	BuildResult result;
+	result.organic = true;
+	result.placed = false;
+	Result<vector<BondedElement>> built = readSmilesBonds(smiles);
+	result.structure = std::move(built.value);
+	result.error = std::move(built.error);
+	return result;
+}
+
+/**
+ * Finish a bonded structure: place it if it isn't already (see
+ * placeStructure) and relax the geometry of organic structures
+ * (see relaxStructure). Simple compounds aren't relaxed, their
+ * VSEPR arrangement is already exact.
+ * 
+ * @param result the build, updated in place
+ * @param relax whether the caller wants relaxed positions
+ * @param threads the threads resonance is enumerated on, 0 for one per core
+ */
+void finishBuild(BuildResult &result, bool relax, unsigned int threads) {
+	if(result.error || result.structure.empty()) {
+		return;
+	}
+	if(!result.placed) {
+		placeStructure(result.structure, threads);
+		result.placed = true;
+	}
+	if(relax && result.organic) {
+		relaxStructure(result.structure);
+	}
+}
+
+/**
+ * Build the structure of an organic compound
+ * 
+ * @param context the lookup tables to build with
+ * @param name the normalized name of the compound
+ * @param relax whether to relax the template geometry with the force field
+ * @param threads the threads resonance is enumerated on, 0 for one per core
+ * @return the structure, or an error message if it can't be built
+ */
+BuildResult buildFromName(const ModelingContext &context, const string &name, bool relax, unsigned int threads) {
+	BuildResult result = bondFromName(context, name);
+	finishBuild(result, relax, threads);
+	return result;
+}
+
+/**
+ * Build the structure of a simple covalent compound (see bondFromFormula)
+ * 
+ * @param context the lookup tables to build with
+ * @param comp the composition of the compound
+ * @param relax whether to relax the geometry the skeleton search gives
+ * @param threads the threads resonance is enumerated on, 0 for one per core
+ * @return the structure, or an error message if it can't be built
+ */
+BuildResult buildFromFormula(const ModelingContext &context, const Formula &comp, bool relax, unsigned int threads) {
+	BuildResult result = bondFromFormula(context, comp);
+	finishBuild(result, relax, threads);
+	return result;
+}
+
+/**
+ * Build a structure from a SMILES string
+ * 
+ * @param smiles the SMILES string, without SMILES_PREFIX
+ * @param relax whether to relax the embedded geometry with the force field
+ * @param threads the threads resonance is enumerated on, 0 for one per core
+ * @return the structure, or an error message if it can't be built
+ */
+BuildResult buildFromSmiles(string_view smiles, bool relax, unsigned int threads) {
+	BuildResult result = bondFromSmiles(smiles);
+	finishBuild(result, relax, threads);
+	return result;
+}
+
+/**
+ * Build the structure for one line of input, either a
+ * chemical formula, a SMILES string (see SMILES_PREFIX),
+ * the name of an organic compound or a trivial name
+ * listed in commonNames.def
+ * Errors are reported through the result instead of thrown
+ * 
+ * @param context the lookup tables to build with
+ * @param input the formula or name
+ * @param relax whether organic structures get relaxed positions rather than
+ *        template ones (callers that only need the bonds can skip it)
+ * @param threads the threads resonance is enumerated on, 0 for one per core.
+ *        Batch workers keep to their own thread, the interactive build takes every core
+ * @return the structure, or an error message if it can't be built
+ *         (both are empty if the input isn't a formula)
+ */
+BuildResult buildFromInput(const ModelingContext &context, const string &input, bool relax, unsigned int threads) {
+	// Trivial names resolve to the input they stand for without any parsing
+	string resolved;
+	string_view common = findCommonName(input);
+	const string &line = common.empty() ? input : resolved.assign(common.data(), common.size());
+
+	if (isSmilesInput(line)) {
+		return buildFromSmiles(string_view(line).substr(sizeof(SMILES_PREFIX) - 1), relax, threads);
+	}
+	if (isOrganicName(line)) {
+		return buildFromName(context, normalizeName(line), relax, threads);
+	}
+
+	Formula comp = readFormula(line);
+	if(comp.empty()) {
+		return BuildResult();
+	}
+	return buildFromFormula(context, comp, relax, threads);
+}
+
+/**
+ * Format the per-atom table printed for a finished structure
+ * (atomic number, valence electrons, bonding/lone pairs, formal charge)
+ * 
+ * @param structure the compound's structure
+ * @return the table, one line per atom after the header
+ */
+string formatStructureTable(const vector<BondedElement> &structure) {
+	int longestName = 0;
+	for(int i = 0; i < structure.size(); i++) {
+		if(structure[i].base().name.length() > longestName) {
+			longestName = structure[i].base().name.length();
+		}
+	}
+
+	string table = string(longestName + 2, ' ');
+	table += "| AN | VN | BP | LP | FC |\n";
+	char row[256];
+	for (int i = 0; i < structure.size(); i++) {
+		const Element &e = structure[i].base();
+		int formalCharge = getFormalCharge(structure[i]);
+		int rName = longestName + 2 - e.name.length();
+		int rAN = e.atomicNumber < 10 ? 3 : e.atomicNumber < 100 ? 2 : 1;
+		char sign = formalCharge < 0 ? '-' : '+';
+		table += e.name;
+		table.append(rName, ' ');
+		if(formalCharge != 0) {
+			snprintf(row, sizeof(row), "|%d%s|%d   |%d   |%d   |%c%d  |\n", e.atomicNumber, string(rAN, ' ').c_str(), e.valenceNumber, structure[i].bondedElectrons/2, structure[i].loneElectrons/2, sign, abs(formalCharge));
+		}
+		else {
+			snprintf(row, sizeof(row), "|%d%s|%d   |%d   |%d   |%d   |\n", e.atomicNumber, string(rAN, ' ').c_str(), e.valenceNumber, structure[i].bondedElectrons/2, structure[i].loneElectrons/2, abs(formalCharge));
+		}
+		table += row;
+	}
+	return table;
+}
+
 /**
  * The main function for predicting structures
  * Runs in a seperate thread from main
@@ -548,10 +775,9 @@ vector<BondedElement> interpretOrganic(string in) {
  * @return nothing because of while(1)
  */
 vector<BondedElement> VSEPRMain() {
-	setUpMap();
-
+	const ModelingContext *context;
 	try {
-		parseCSV(DATA_TABLE_PATH);
+		context = &defaultContext();
 	}
 	catch(const std::exception& err) {
 		std::cerr << err.what() << '\n';
@@ -559,127 +785,55 @@ vector<BondedElement> VSEPRMain() {
 	}
 	cout << "Periodic table data loaded" << endl << endl;
 
-	tetrahedron = {glm::vec3(1, 0, -1 / sqrt(2)), glm::vec3(-1, 0, -1 / sqrt(2)), glm::vec3(0, 1, 1 / sqrt(2)), glm::vec3(0, -1, 1 / sqrt(2))};
-	glm::quat shift = glm::angleAxis((float)(PI/2), glm::vec3(1.0f, 0.0f, 0.0f));
-	for(int i = 0; i < tetrahedron.size(); i++) {
-		glm::vec4 temp = glm::vec4(tetrahedron[i], 1.0f);
-		tetrahedron[i] = glm::normalize(glm::vec3(temp * shift));
-	} 
-
 	string inFormula;
-	configurations = {
-		std::vector<glm::vec3>{glm::vec3(1, 0, 0)},
-		std::vector<glm::vec3>{glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0)},
-		std::vector<glm::vec3>{glm::vec3(COS_30, -SIN_30, 0), glm::vec3(-COS_30, -SIN_30, 0), glm::vec3(0, 1, 0)},
-		tetrahedron,
-		std::vector<glm::vec3>{glm::vec3(0, 0, -1), glm::vec3(-COS_30, 0, SIN_30), glm::vec3(0, -1, 0), glm::vec3(COS_30, 0, SIN_30), glm::vec3(0, 1, 0)},
-		std::vector<glm::vec3>{glm::vec3(SIN_45, 0, -SIN_45), glm::vec3(SIN_45, 0, SIN_45), glm::vec3(-SIN_45, 0, SIN_45), glm::vec3(-SIN_45, 0, -SIN_45), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0)},
+	// Conformer search of the shown model, stopped before the model is replaced
+	thread search;
+	atomic<bool> cancelSearch(false);
+	auto stopSearch = [&]() {
+		if(search.joinable()) {
+			cancelSearch = true;
+			search.join();
+			cancelSearch = false;
+		}
 	};
 
 	while (1) {
 		getline(cin, inFormula);
-		vector<BondedElement> structure;
-		if (checkStringComponent(inFormula, "ane") || checkStringComponent(inFormula, "ene") || checkStringComponent(inFormula, "yne")) {
-			organic = true;
-			try	{
-				structure = interpretOrganic(inFormula);
-			}
-			catch(const char* errMsg) {
-				cout << errMsg << endl;
-				continue;
-			}
-			int longestName = 0;
-			for(int i = 0; i < structure.size(); i++) {
-				if(structure[i].base.name.length() > longestName) {
-					longestName = structure[i].base.name.length();
-				}
-			}
-			printf("%s", string(longestName + 2, ' ').c_str());
-			printf("| AN | VN | BP | LP | FC |\n");
-			for (int i = 0; i < structure.size(); i++) {
-				Element e = structure[i].base;
-				int formalCharge = getFormalCharge(structure[i]);
-				int rName = longestName + 2 - structure[i].base.name.length();
-				int rAN = e.atomicNumber < 10 ? 3 : e.atomicNumber < 100 ? 2 : 1;
-				char sign = formalCharge < 0 ? '-' : '+';
-				if(formalCharge != 0) {
-					printf("%s%s|%d%s|%d   |%d   |%d   |%c%d  |\n",
-						structure[i].base.name.c_str(),
-						string(rName, ' ').c_str(),
-						e.atomicNumber,
-						string(rAN, ' ').c_str(),
-						e.valenceNumber,
-						structure[i].bondedElectrons/2,
-						structure[i].loneElectrons/2,
-						sign,
-						abs(formalCharge));
-				}
-				else {
-					printf("%s%s|%d%s|%d   |%d   |%d   |%d   |\n",
-						structure[i].base.name.c_str(),
-						string(rName, ' ').c_str(),
-						e.atomicNumber,
-						string(rAN, ' ').c_str(),
-						e.valenceNumber,
-						structure[i].bondedElectrons/2,
-						structure[i].loneElectrons/2,
-						abs(formalCharge));
-				}
-			}
-			mutateModel(structure);
+#ifdef VSEPR_ALLOCATION_REPORT
+		AllocationScope allocations;
+#endif
+		// The viewer owns the machine, so large resonance searches use every core
+		BuildResult result = buildFromInput(*context, inFormula, true, 0);
+#ifdef VSEPR_ALLOCATION_REPORT
+		uint64_t requestAllocations = allocations.count();
+#endif
+		if(result.error) {
+			cout << result.error.message << endl;
 			continue;
 		}
-
-		vector<Element> comp;
-		if(inFormula == "H2O")
-			comp = readFormula("OH2");
-		else
-			comp = readFormula(inFormula);
-		if(comp.size() < 1) {
-			continue;
-		}
-
-		try {
-			structure = constructLewisStructure(comp);
-		}
-		catch(const char *errMsg) {
-			cout << errMsg << endl;
+		if(result.structure.empty() && !result.organic) {
 			continue;
 		}
 
-		if (structure.size() < 1) {
-			cout << "Lewis structure not possible" << endl;
+		fputs(formatStructureTable(result.structure).c_str(), stdout);
+#ifdef VSEPR_ALLOCATION_REPORT
+		printf("Heap allocations: %llu\n", (unsigned long long)requestAllocations);
+#endif
+		stopSearch();
+		if(!result.organic || result.structure.size() > CONFORMER_MAX_ATOMS) {
+			mutateModel(std::move(result.structure), result.organic);
 			continue;
 		}
-
-		for(int i = 0; i < structure.size(); i++) {
-			if(getFormalCharge(structure[i]) != 0) {
-				structure = optimizeFormalCharge(structure);
-				break;
-			} 
-		}
-		mutateModel(structure);
-		int longestName = 0;
-		for(int i = 0; i < structure.size(); i++) {
-			if(structure[i].base.name.length() > longestName) {
-				longestName = structure[i].base.name.length();
-			}
-		}
-		printf("%s", string(longestName + 2, ' ').c_str());
-		printf("| AN | VN | BP | LP | FC |\n");
-		for (int i = 0; i < structure.size(); i++) {
-			Element e = structure[i].base;
-			int formalCharge = getFormalCharge(structure[i]);
-			int rName = longestName + 2 - structure[i].base.name.length();
-			int rAN = e.atomicNumber < 10 ? 3 : e.atomicNumber < 100 ? 2 : 1;
-			char sign = formalCharge < 0 ? '-' : '+';
-			if(formalCharge != 0) {
-				printf("%s%s|%d%s|%d   |%d   |%d   |%c%d  |\n", structure[i].base.name.c_str(), string(rName, ' ').c_str(), e.atomicNumber, string(rAN, ' ').c_str(), e.valenceNumber, structure[i].bondedElectrons/2, structure[i].loneElectrons/2, sign, abs(formalCharge));
-			}
-			else {
-				printf("%s%s|%d%s|%d   |%d   |%d   |%d   |\n", structure[i].base.name.c_str(), string(rName, ' ').c_str(), e.atomicNumber, string(rAN, ' ').c_str(), e.valenceNumber, structure[i].bondedElectrons/2, structure[i].loneElectrons/2, abs(formalCharge));
+		// Show the relaxed structure straight away, conformers stream in behind it
+		// while the next line of input is read
+		vector<BondedElement> structure = result.structure;
+		mutateModel(std::move(result.structure), result.organic);
+		search = thread([&cancelSearch](vector<BondedElement> structure) {
+			vector<Conformer> conformers = generateConformers(structure, 0, CONFORMER_LIMIT, publishConformers, &cancelSearch);
+			if(conformers.size() > 1 && !cancelSearch) {
+				cout << conformers.size() << " conformers found, N/B to step through them" << endl;
 			}
-		}
+		}, std::move(structure));
 	}
 
 	return vector<BondedElement>();
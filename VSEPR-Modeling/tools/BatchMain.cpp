@@ -0,0 +1,13 @@
+#include <string>
+#include "VSEPR.h"
+
+/**
+ * Headless entry point, equivalent to model --batch [--smiles] [file]
+ * Links against the core library only, so it runs on
+ * machines without OpenGL or a display
+ */
+int main(int argc, char *argv[]) {
+	bool smiles = argc > 1 && std::string(argv[1]) == "--smiles";
+	int fileArg = smiles ? 2 : 1;
+	return batchMain(argc > fileArg ? argv[fileArg] : nullptr, smiles);
+}
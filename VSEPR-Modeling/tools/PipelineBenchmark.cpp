@@ -0,0 +1,230 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include "VSEPR.h"
+#include "context.h"
+#include "formula.h"
+#include "smiles.h"
+#include "forcefield.h"
+#include "conformers.h"
+
+using namespace std;
+
+/**
+ * Count the bonds between atoms of two elements
+ *
+ * @param structure the bonded atoms
+ * @param a the atomic number of one end
+ * @param b the atomic number of the other end
+ * @return the number of bonds, whatever their order
+ */
+static int countBonds(const vector<BondedElement> &structure, int a, int b) {
+	unordered_map<uint32_t, int> elements;
+	for(const BondedElement &atom : structure) {
+		elements[atom.getUID()] = atom.base().atomicNumber;
+	}
+	int count = 0;
+	for(const BondedElement &atom : structure) {
+		if(atom.base().atomicNumber != a) {
+			continue;
+		}
+		for(const Bond &bond : atom.bonds) {
+			count += elements[bond.uid] == b;
+		}
+	}
+	return a == b ? count / 2 : count;
+}
+
+/**
+ * Get the largest formal charge, either sign, on any atom of an element
+ *
+ * @param structure the bonded atoms
+ * @param element the atomic number
+ * @return the size of the charge
+ */
+static int mostCharge(const vector<BondedElement> &structure, int element) {
+	int most = 0;
+	for(const BondedElement &atom : structure) {
+		if(atom.base().atomicNumber == element) {
+			most = max(most, abs(getFormalCharge(atom)));
+		}
+	}
+	return most;
+}
+
+/**
+ * Check that a structure has a molecular formula, counting its
+ * atoms by element and adding up their formal charges
+ *
+ * @param structure the bonded atoms
+ * @param formula the expected formula, e.g. "SO4 2-"
+ * @return true if every count and the charge match
+ */
+static bool hasFormula(const vector<BondedElement> &structure, const string &formula) {
+	Formula expected = readFormula(formula);
+	map<int, int> counts;
+	for(const ElementCount &c : expected.counts) {
+		counts[c.elementId] += c.count;
+	}
+	int charge = 0;
+	for(const BondedElement &atom : structure) {
+		counts[atom.base().atomicNumber]--;
+		charge += getFormalCharge(atom);
+	}
+	for(const auto &count : counts) {
+		if(count.second != 0) {
+			return false;
+		}
+	}
+	return charge == expected.charge;
+}
+
+/**
+ * Build a fixed set of structures repeatedly and report
+ * how many atom copies and how much time each build takes
+ * Must be run from the directory containing the periodic table data
+ */
+int main(int argc, char *argv[]) {
+	int iterations = argc > 1 ? stoi(argv[1]) : 1000;
+
+	const ModelingContext *context;
+	try {
+		context = &defaultContext();
+	}
+	catch(const std::exception &err) {
+		cerr << err.what() << endl;
+		return 1;
+	}
+
+	vector<string> formulas = {"OH2", "CO2", "NH3", "SO4 2-", "PCl5", "SF6", "XeF4"};
+	vector<string> multiCentre = {"H2O2", "C2H6O", "N2O4", "N2O5", "C8H18"};
+	vector<string> names = {"hexane", "2-methylpropane", "1,2-dimethylcyclopropane", "3-ethyl-2,2-dimethylpentane", "decane"};
+	vector<string> smiles = {"CCO", "CC(=O)Oc1ccccc1C(=O)O", "CN1C=NC2=C1C(=O)N(C(=O)N2C)C", "c1ccc2ccccc2c1", "OC[C@H]1OC(O)[C@H](O)[C@@H](O)[C@@H]1O"};
+
+	printf("%-30s| copies/build | us/build |\n", "input");
+	for(int pass = 0; pass < 4; pass++) {
+		vector<string> &inputs = pass == 0 ? formulas : pass == 1 ? names : pass == 2 ? smiles : multiCentre;
+		for(const string &in : inputs) {
+			uint64_t startCopies = BondedElement::copyCount();
+			auto start = chrono::steady_clock::now();
+			size_t atoms = 0;
+			for(int i = 0; i < iterations; i++) {
+				Result<vector<BondedElement>> structure = pass == 0 ? constructLewisStructure(*context, readFormula(in))
+				                                        : pass == 1 ? interpretOrganic(*context, in)
+				                                        : pass == 2 ? interpretSmiles(*context, in)
+				                                        : solveLewisStructure(*context, readFormula(in));
+				atoms += structure.value.size();
+			}
+			auto end = chrono::steady_clock::now();
+			double copies = (double)(BondedElement::copyCount() - startCopies) / iterations;
+			double micros = chrono::duration<double, micro>(end - start).count() / iterations;
+			printf("%-30s|%13.1f |%9.2f |\n", in.c_str(), copies, micros);
+			if(atoms == 0) {
+				cerr << "Failed to build " << in << endl;
+			}
+		}
+	}
+
+	// Parsing alone, without hydrogens or geometry
+	size_t characters = 0;
+	auto start = chrono::steady_clock::now();
+	for(int i = 0; i < iterations; i++) {
+		for(const string &in : smiles) {
+			SmilesMolecule molecule;
+			if(BuildError error = parseSmiles(in, molecule)) {
+				cerr << error.message << endl;
+				return 1;
+			}
+			characters += in.length();
+		}
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	printf("SMILES parsing: %.2f million characters/s\n", characters / seconds / 1e6);
+
+	// Relaxing a long chain, once since it's much slower than building it
+	Result<vector<BondedElement>> chain = interpretSmiles(*context, string(333, 'C'));
+	auto relaxStart = chrono::steady_clock::now();
+	relaxStructure(chain.value);
+	double relaxMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - relaxStart).count();
+	printf("Relaxing %zu atoms: %.1f ms\n", chain.value.size(), relaxMillis);
+
+	// Conformer search over a flexible chain, on one thread and on every core
+	Result<vector<BondedElement>> octane = interpretSmiles(*context, "CCCCCCCC");
+	relaxStructure(octane.value);
+	unsigned int cores = max(1u, thread::hardware_concurrency());
+	for(unsigned int threads : {1u, cores}) {
+		auto conformerStart = chrono::steady_clock::now();
+		vector<Conformer> conformers = generateConformers(octane.value, threads);
+		double conformerMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - conformerStart).count();
+		printf("Conformers of octane on %u threads: %zu in %.1f ms\n", threads, conformers.size(), conformerMillis);
+		if(cores == 1) {
+			break;
+		}
+	}
+
+	// Rejecting an input should cost no more than building one
+	vector<string> invalid = {"BH5", "5-methylpropane", "1,1,1,1,1-pentamethylmethane", "smiles:C(C)(C)(C)(C)C", "smiles:CC(=O"};
+	printf("\n%-30s| us/reject | reason\n", "invalid input");
+	for(const string &in : invalid) {
+		BuildErrorCode code = BUILD_OK;
+		auto rejectStart = chrono::steady_clock::now();
+		for(int i = 0; i < iterations; i++) {
+			code = buildFromInput(*context, in).error.code;
+		}
+		double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - rejectStart).count() / iterations;
+		printf("%-30s|%10.2f | %s\n", in.c_str(), micros, buildErrorName(code));
+	}
+
+	// Structures the skeleton search has got wrong before
+	struct LewisCheck {
+		string formula;
+		string expected;
+		function<bool(const vector<BondedElement> &)> holds;
+	};
+	vector<LewisCheck> checks = {
+		{"N2O4", "O2N-NO2", [](const vector<BondedElement> &s) { return countBonds(s, 7, 7) == 1; }},
+		{"C6H6", "a ring", [](const vector<BondedElement> &s) { return countBonds(s, CARBON, CARBON) == 6; }},
+		{"S8", "an uncharged ring", [](const vector<BondedElement> &s) { return countBonds(s, 16, 16) == 8 && mostCharge(s, 16) == 0; }},
+		{"P4O10", "a P4O6 cage with four P=O", [](const vector<BondedElement> &s) { return countBonds(s, 15, 15) == 0 && countBonds(s, 15, 8) == 16; }},
+		{"C6H12O6", "six uncharged hydroxyl groups", [](const vector<BondedElement> &s) { return countBonds(s, CARBON, 8) == 6 && countBonds(s, 8, HYDROGEN) == 6 && mostCharge(s, 8) == 0; }},
+		{"ClO4 -", "an uncharged chlorine atom", [](const vector<BondedElement> &s) { return mostCharge(s, 17) == 0; }},
+	};
+	int failures = 0;
+	printf("\n%-30s| us/solve | expected\n", "skeleton search");
+	for(const LewisCheck &check : checks) {
+		auto solveStart = chrono::steady_clock::now();
+		Result<vector<BondedElement>> solved = solveLewisBonds(readFormula(check.formula));
+		double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - solveStart).count();
+		bool passed = solved && check.holds(solved.value);
+		printf("%-30s|%9.0f | %s%s\n", check.formula.c_str(), micros, check.expected.c_str(), passed ? "" : " FAILED");
+		if(solved.error) {
+			cerr << check.formula << ": " << buildErrorName(solved.error.code) << endl;
+		}
+		failures += !passed;
+	}
+
+	// Every common name must build the compound it names
+	struct NameCheck {
+		const char *name;
+		const char *formula;
+	};
+	const NameCheck commonNames[] = {
+#define COMMON_NAME(name, input, formula) {name, formula},
+#include "commonNames.def"
+#undef COMMON_NAME
+	};
+	for(const NameCheck &check : commonNames) {
+		BuildResult built = buildFromInput(*context, check.name, false);
+		if(built.error || !hasFormula(built.structure, check.formula)) {
+			printf("Common name %s doesn't build %s\n", check.name, check.formula);
+			failures++;
+		}
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include "spatial.h"
+
+using namespace std;
+
+// Atoms per A^3, about that of a liquid hydrocarbon
+#define BENCHMARK_DENSITY 0.1
+// Pair cutoff (A), about a van der Waals cutoff
+#define BENCHMARK_RADIUS 5.0f
+// Largest set the brute force loop runs over in full, larger ones are timed on a sample
+#define BENCHMARK_BRUTE_FORCE_LIMIT 20000
+#define BENCHMARK_BRUTE_FORCE_SAMPLE 1000
+// How far (A) each atom moves between a build and an update
+#define BENCHMARK_STEP 0.2f
+
+/**
+ * Get the milliseconds since a time
+ *
+ * @param start the time
+ * @return the milliseconds elapsed
+ */
+static double millisSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Time the cell list against an all-pairs loop for finding every
+ * pair of points within a cutoff, for 1k to 1M (or argv[1]) random
+ * points at liquid density
+ * All-pairs times past BENCHMARK_BRUTE_FORCE_LIMIT points are
+ * estimated from a sample of rows and marked with ~
+ */
+int main(int argc, char *argv[]) {
+	size_t largest = argc > 1 ? stoul(argv[1]) : 1000000;
+	mt19937 random(1);
+
+	printf("%9s | build ms | update ms | moved | pairs ms |     pairs | all-pairs ms\n", "points");
+	for(size_t count = 1000; count <= largest; count *= 10) {
+		float side = (float)cbrt(count / BENCHMARK_DENSITY);
+		uniform_real_distribution<float> place(0.0f, side);
+		vector<glm::vec3> points(count);
+		for(glm::vec3 &p : points) {
+			p = glm::vec3(place(random), place(random), place(random));
+		}
+
+		CellList cells;
+		auto start = chrono::steady_clock::now();
+		cells.build(points.data(), count, BENCHMARK_RADIUS);
+		double buildMillis = millisSince(start);
+
+		uniform_real_distribution<float> step(-BENCHMARK_STEP, BENCHMARK_STEP);
+		for(glm::vec3 &p : points) {
+			p += glm::vec3(step(random), step(random), step(random));
+		}
+		start = chrono::steady_clock::now();
+		size_t moved = cells.update(points.data());
+		double updateMillis = millisSince(start);
+
+		size_t pairs = 0;
+		start = chrono::steady_clock::now();
+		cells.forEachPair(BENCHMARK_RADIUS, [&pairs](uint32_t, uint32_t, float) {
+			pairs++;
+		});
+		double pairMillis = millisSince(start);
+
+		// Every point against every later one, or a sample of rows scaled up
+		bool sampled = count > BENCHMARK_BRUTE_FORCE_LIMIT;
+		size_t rows = sampled ? BENCHMARK_BRUTE_FORCE_SAMPLE : count;
+		size_t brutePairs = 0;
+		float radius2 = BENCHMARK_RADIUS * BENCHMARK_RADIUS;
+		start = chrono::steady_clock::now();
+		for(size_t r = 0; r < rows; r++) {
+			size_t i = sampled ? random() % count : r;
+			for(size_t j = sampled ? 0 : i + 1; j < count; j++) {
+				glm::vec3 d = points[j] - points[i];
+				if(j != i && glm::dot(d, d) <= radius2) {
+					brutePairs++;
+				}
+			}
+		}
+		double bruteMillis = millisSince(start);
+		if(sampled) {
+			bruteMillis *= (double)count / (2 * rows);
+		}
+		else if(brutePairs != pairs) {
+			fprintf(stderr, "Cell list found %zu pairs, all-pairs found %zu\n", pairs, brutePairs);
+			return 1;
+		}
+
+		printf("%9zu |%9.2f |%10.2f |%6zu |%9.2f |%10zu |%s%11.1f\n", count, buildMillis, updateMillis, moved, pairMillis, pairs, sampled ? " ~" : "  ", bruteMillis);
+	}
+	return 0;
+}